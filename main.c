@@ -59,13 +59,14 @@
 #include "nrf_sdh.h"
 #include "nrf_sdh_soc.h"
 #include "nrf_sdh_ble.h"
+#include "nrf_soc.h"
 #include "nrf_ble_gatt.h"
 #include "app_timer.h"
 #include "ble_nus.h"
 #include "app_uart.h"
 #include "app_util_platform.h"
 #include "bsp_btn_ble.h"
-#include "nrf_delay.h"
+#include "app_scheduler.h"
 
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
@@ -74,6 +75,8 @@
 #include "mem_manager.h"
 #include "mqttsn_client.h"
 #include "mqttsn_packet_internal.h"
+#include "mqttsn_transport_ble.h"
+#include "mqttsn_telemetry.h"
 
 
 #define APP_BLE_CONN_CFG_TAG            1                                           /**< A tag identifying the SoftDevice BLE configuration. */
@@ -101,11 +104,17 @@
 #define UART_TX_BUF_SIZE                256                                         /**< UART TX buffer size. */
 #define UART_RX_BUF_SIZE                256                                         /**< UART RX buffer size. */
 
+#define SCHED_MAX_EVENT_DATA_SIZE       MAX(APP_TIMER_SCHED_EVENT_DATA_SIZE, MQTTSN_SCHED_EVENT_DATA_SIZE) /**< Maximum size of scheduler events. */
+#define SCHED_QUEUE_SIZE                8                                           /**< Maximum number of events in the scheduler queue. */
+
+#define PUBLISH_INTERVAL                APP_TIMER_TICKS(10000)                      /**< Interval between publications or gateway searches (10 seconds). */
+
 static volatile bool connected_to_forwarder = false;
 
 BLE_NUS_DEF(m_nus);                                                                 /**< BLE NUS service instance. */
 NRF_BLE_GATT_DEF(m_gatt);                                                           /**< GATT module instance. */
 BLE_ADVERTISING_DEF(m_advertising);                                                 /**< Advertising module instance. */
+APP_TIMER_DEF(m_publish_timer_id);                                                  /**< Publication timer. */
 
 static uint16_t   m_conn_handle          = BLE_CONN_HANDLE_INVALID;                 /**< Handle of the current connection. */
 static uint16_t   m_ble_nus_max_data_len = BLE_GATT_ATT_MTU_DEFAULT - 3;            /**< Maximum length of data (in bytes) that can be transmitted to the peer by the Nordic UART service module. */
@@ -143,18 +152,55 @@ static mqttsn_topic_t       m_topic            =                            /**<
 };
 
 
+static const mqttsn_telemetry_field_t  m_sample_fields[] =                  /**< Fields of the published sample: sequence number, die temperature in degrees Celsius. */
+{
+    { .type = MQTTSN_TELEMETRY_FIELD_UVARINT },
+    { .type = MQTTSN_TELEMETRY_FIELD_FIXED16, .frac_bits = 2 },
+};
+
+static const mqttsn_telemetry_schema_t m_sample_schema =                    /**< Layout of the published sample. */
+{
+    .p_fields  = m_sample_fields,
+    .field_cnt = ARRAY_SIZE(m_sample_fields),
+};
+
+static mqttsn_telemetry_deadband_t     m_temp_deadband =                    /**< Die temperature is published when it changes by more than 0.5 degrees, or every 5 minutes. */
+{
+    .deadband       = 2,
+    .max_suppressed = 30,
+};
+
+
 // Function to publish data through MQTT-SN
 void publish_data() {
-    static uint8_t test_data = 0;
-    uint8_t test_data_buf[10];
-    sprintf(test_data_buf, "Data: %d", test_data);
-    uint8_t buf[strlen(test_data_buf)];
+    static uint32_t          sequence = 0;
+    int32_t                  temp     = 0;
+    uint8_t                  buf[2 * MQTTSN_TELEMETRY_FIELD_MAX_LENGTH];
+    mqttsn_telemetry_value_t values[ARRAY_SIZE(m_sample_fields)];
+
+    // Die temperature is reported in 0.25 degree steps.
+    (void)sd_temp_get(&temp);
+
+    // Suppressed samples show up as gaps in the sequence numbers.
+    if (!mqttsn_telemetry_deadband_check(&m_temp_deadband, temp))
+    {
+        sequence++;
+        return;
+    }
 
-    uint8_t thread_led_toggle_cmd[] = "m";
+    values[0].u = sequence;
+    values[1].f = temp * 0.25f;
 
-    memcpy(buf, test_data_buf, strlen(test_data_buf));
-    mqttsn_client_publish(&m_client, m_topic.topic_id, (const uint8_t *)&thread_led_toggle_cmd, sizeof(thread_led_toggle_cmd), &m_msg_id);
-    test_data++;
+    uint16_t len = mqttsn_telemetry_encode(&m_sample_schema, values, buf, sizeof(buf));
+    if (len != 0)
+    {
+        uint32_t err_code = mqttsn_client_publish_append(&m_client, m_topic.topic_id, buf, len);
+        if (err_code != NRF_SUCCESS)
+        {
+            NRF_LOG_ERROR("Sample %d has not been published. Error: 0x%x\r\n", sequence, err_code);
+        }
+    }
+    sequence++;
 }
 
 // Function to subscribe to data over MQTT-SN
@@ -255,21 +301,18 @@ static void subscribed_callback(mqttsn_event_t * p_event)
 }
 
 /**@brief Processes PUBLISH message from a gateway.
+ *
+ * @details The payload is binary and not NUL-terminated. It is valid until this function returns.
  *
  * @param[in] p_event Pointer to MQTT-SN event.
  */
 static void received_callback(mqttsn_event_t * p_event)
 {
-    const char * c_payload = p_event->event_data.published.p_payload;
-    char * payload;
-    payload = nrf_malloc(sizeof(char) * strlen(c_payload));
-    strcpy(payload, c_payload);
-
-    NRF_LOG_INFO("MQTT-SN event: Data received on topic with ID '%d': %s.\r\n",
-                  p_event->event_data.published.packet.topic.topic_id,
-                  (uint32_t)payload);
-    nrf_free(payload);
-
+    NRF_LOG_INFO("MQTT-SN event: %d bytes received on topic with ID '%d'.\r\n",
+                  p_event->event_data.published.packet.len,
+                  p_event->event_data.published.packet.topic.topic_id);
+    NRF_LOG_HEXDUMP_INFO(p_event->event_data.published.p_payload,
+                         p_event->event_data.published.packet.len);
 }
 
 
@@ -312,6 +355,10 @@ void mqttsn_evt_handler(mqttsn_client_t * p_client, mqttsn_event_t * p_event)
             NRF_LOG_INFO("MQTT-SN event: Client has successfully published content.\r\n");
             break;
 
+        case MQTTSN_EVENT_GATEWAY_SWITCHED:
+            NRF_LOG_INFO("MQTT-SN event: Client has switched to gateway %d.\r\n", p_event->event_data.connected.gateway_id);
+            break;
+
         case MQTTSN_EVENT_TIMEOUT:
             NRF_LOG_INFO("MQTT-SN event: Retransmission retries limit has been reached.\r\n");
             timeout_callback(p_event);
@@ -333,9 +380,65 @@ void mqttsn_evt_handler(mqttsn_client_t * p_client, mqttsn_event_t * p_event)
     }
 }
 
+/**@brief Initializes the MQTT-SN client.
+ *
+ * @details The published topic is added before the first connection, so that samples taken
+ *          before it has been registered are queued by the client under its topic ID.
+ */
 static void mqttsn_init(void)
 {
     mqttsn_client_init(&m_client, MQTTSN_DEFAULT_CLIENT_PORT, &mqttsn_evt_handler, NULL);
+
+    uint32_t err_code = mqttsn_client_topic_add(&m_client,
+                                                m_topic.p_topic_name,
+                                                strlen(m_topic_name),
+                                                &m_topic.topic_id);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Publishes data, and searches for a gateway while the client is not connected.
+ *
+ * @details Runs in thread mode from the scheduler queue. Samples taken while the link to the
+ *          forwarder or the gateway is down are queued by the client and sent after reconnecting.
+ */
+static void publish_process(void * p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+
+    publish_data();
+
+    if (!connected_to_forwarder)
+    {
+        return;
+    }
+
+    if ((m_client.client_state == MQTTSN_CLIENT_SEARCHING_GATEWAY) ||
+        (m_client.client_state == MQTTSN_CLIENT_DISCONNECTED))
+    {
+        mqttsn_client_search_gateway(&m_client);
+    }
+}
+
+/**@brief Handles the publication timer expiry by queueing the publication for thread mode.
+ */
+static void publish_timeout_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    // A full queue only skips one publication.
+    (void)app_sched_event_put(NULL, 0, publish_process);
+}
+
+/**@brief Function for initializing the publication timer.
+ */
+static void publish_timer_init(void)
+{
+    uint32_t err_code = app_timer_create(&m_publish_timer_id, APP_TIMER_MODE_REPEATED, publish_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_start(m_publish_timer_id, PUBLISH_INTERVAL, NULL);
+    APP_ERROR_CHECK(err_code);
 }
 
 
@@ -653,6 +756,7 @@ void gatt_evt_handler(nrf_ble_gatt_t * p_gatt, nrf_ble_gatt_evt_t const * p_evt)
     {
         m_ble_nus_max_data_len = p_evt->params.att_mtu_effective - OPCODE_LENGTH - HANDLE_LENGTH;
         NRF_LOG_INFO("Data len is set to 0x%X(%d)", m_ble_nus_max_data_len, m_ble_nus_max_data_len);
+        (void)mqttsn_client_mtu_set(&m_client, m_ble_nus_max_data_len);
     }
     NRF_LOG_DEBUG("ATT MTU exchange completed. central 0x%x peripheral 0x%x",
                   p_gatt->att_mtu_desired_central,
@@ -869,6 +973,8 @@ int main(void)
     err_code = app_timer_init();
     APP_ERROR_CHECK(err_code);
 
+    APP_SCHED_INIT(SCHED_MAX_EVENT_DATA_SIZE, SCHED_QUEUE_SIZE);
+
     uart_init();
     log_init();
 
@@ -890,26 +996,14 @@ int main(void)
     APP_ERROR_CHECK(err_code);
     client_options_set();
     mqttsn_init();
-
-    bool once = true;
+    publish_timer_init();
 
     // Enter main loop.
     for (;;)
     {
-        if(connected_to_forwarder) {
-            if( (m_client.client_state == MQTTSN_CLIENT_SEARCHING_GATEWAY) ||
-                (m_client.client_state == MQTTSN_CLIENT_DISCONNECTED))
-            {
-                mqttsn_client_search_gateway(&m_client);
-            }
-            else
-            {
-                publish_data();
-            }
-            nrf_delay_ms(10000);
-        }
-        else
-            power_manage();
+        app_sched_execute();
+        (void)mqttsn_client_process(&m_client);
+        power_manage();
     }
 }
 
@@ -116,7 +116,7 @@ int MQTTSNDeserialize_gwinfo(unsigned char* gatewayid, unsigned short* gatewayad
 	*gatewayid = readChar(&curdata);
 
 	*gatewayaddress_len = enddata - curdata;
-	*gatewayaddress = (gatewayaddress_len > 0) ? curdata : NULL;
+	*gatewayaddress = (*gatewayaddress_len > 0) ? curdata : NULL;
 
 	rc = 1;
 exit:
@@ -18,9 +18,27 @@
 #define STACKTRACE_H_
 
 #include <stdio.h>
+#include "mqttsn_profile.h"
+
+/* Paho's own stack tracing is not ported, so tracing is compiled out unless PAHO_STACKTRACE is
+ * defined. Defining MQTTSN_PROFILE_ENABLED to 1 counts cycles per function instead. */
+#if !defined(PAHO_STACKTRACE) && !defined(NOSTACKTRACE)
 #define NOSTACKTRACE 1
+#endif
 
-#if defined(NOSTACKTRACE)
+#if MQTTSN_PROFILE_ENABLED
+#define FUNC_ENTRY MQTTSN_PROFILE_ENTRY
+#define FUNC_ENTRY_NOLOG MQTTSN_PROFILE_ENTRY
+#define FUNC_ENTRY_MED MQTTSN_PROFILE_ENTRY
+#define FUNC_ENTRY_MAX MQTTSN_PROFILE_ENTRY
+#define FUNC_EXIT MQTTSN_PROFILE_EXIT
+#define FUNC_EXIT_NOLOG MQTTSN_PROFILE_EXIT
+#define FUNC_EXIT_MED MQTTSN_PROFILE_EXIT
+#define FUNC_EXIT_MAX MQTTSN_PROFILE_EXIT
+#define FUNC_EXIT_RC(x) MQTTSN_PROFILE_EXIT
+#define FUNC_EXIT_MED_RC(x) MQTTSN_PROFILE_EXIT
+#define FUNC_EXIT_MAX_RC(x) MQTTSN_PROFILE_EXIT
+#elif defined(NOSTACKTRACE)
 #define FUNC_ENTRY
 #define FUNC_ENTRY_NOLOG
 #define FUNC_ENTRY_MED
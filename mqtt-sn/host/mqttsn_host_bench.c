@@ -0,0 +1,875 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/**@file mqttsn_host_bench.c
+ *
+ * @brief Microbenchmark of the Paho MQTT-SN serializers and deserializers.
+ *
+ * @details Reports the time per call of every public MQTTSNSerialize_* and MQTTSNDeserialize_*
+ *          function, over topic names of 1 to 64 bytes and payloads of 0 to 1024 bytes, so that
+ *          both the one-byte and the three-byte Length forms are measured. Each frame is checked
+ *          to deserialize before it is timed, and the program fails if one does not.
+ *
+ *          The messages handled by the inline codec of mqttsn_codec.h are then measured with both
+ *          Paho and the codec, in nanoseconds and, on x86, time stamp counter ticks per call. The
+ *          codec is checked to encode the same bytes and to decode the same fields as Paho. The
+ *          client sends PUBLISH payloads as a separate segment, so the PUBLISH header encoder is
+ *          compared with Paho serializing the whole message.
+ *
+ *          Usage: mqttsn_host_bench [--quick]
+ *
+ *          --quick shortens each measurement to check the suite rather than to measure it.
+ */
+
+#include "MQTTSNPacket.h"
+#include "mqttsn_codec.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_TICKS_AVAILABLE 1
+#else
+#define BENCH_TICKS_AVAILABLE 0
+#endif
+
+/**@brief Largest frame measured: a 1024-byte payload in a three-byte Length form PUBLISH. */
+#define BENCH_BUF_LENGTH     1100
+
+/**@brief Time spent measuring a single case, in nanoseconds. */
+#define BENCH_TIME_NS        20000000ULL
+
+/**@brief Time spent measuring a single case with --quick, in nanoseconds. */
+#define BENCH_QUICK_TIME_NS  200000ULL
+
+/**@brief Fields decoded by a measured call, compared between Paho and the codec. */
+typedef struct bench_decoded_t
+{
+    uint16_t        topic_id;   /**< Topic ID. */
+    uint16_t        packet_id;  /**< Packet ID. */
+    uint8_t         qos;        /**< QoS of PUBLISH and SUBACK. */
+    uint8_t         rc;         /**< Return code of acknowledgements. */
+    const uint8_t * p_data;     /**< Payload or topic name. */
+    uint16_t        data_len;   /**< Length of the payload or topic name. */
+} bench_decoded_t;
+
+/**@brief Arguments of a measured call. */
+typedef struct bench_arg_t
+{
+    uint16_t      size;                         /**< Topic name or payload length of the case. */
+    unsigned char buf[BENCH_BUF_LENGTH];        /**< Serialized frame. */
+    int           len;                          /**< Length of the serialized frame. */
+    unsigned char payload[1024];                /**< Payload or topic name data. */
+    int           rc;                           /**< Value returned by the last call. */
+    bench_decoded_t decoded;                    /**< Fields decoded by the last call. */
+} bench_arg_t;
+
+/**@brief Measured call. Returns the value returned by the measured function. */
+typedef int (*bench_op_t)(bench_arg_t * p_arg);
+
+/**@brief Benchmark case. */
+typedef struct bench_case_t
+{
+    const char * p_name;    /**< Name of the measured function. */
+    bench_op_t   serialize; /**< Call serializing the frame into the argument buffer. */
+    bench_op_t   op;        /**< Measured call. Equal to serialize for serializers. */
+    uint16_t     sizes[6];  /**< Topic name or payload lengths measured, terminated by UINT16_MAX. */
+} bench_case_t;
+
+/**@brief Comparison of a call between Paho and the inline codec. */
+typedef struct codec_case_t
+{
+    const char * p_name;    /**< Name of the compared operation. */
+    bench_op_t   serialize; /**< Call serializing the frame decoded, NULL for encoders. */
+    bench_op_t   paho;      /**< Call through Paho. */
+    bench_op_t   codec;     /**< Call through the inline codec. */
+    bool         header;    /**< The codec encodes the header only, the payload is sent separately. */
+    uint16_t     sizes[6];  /**< Topic name or payload lengths measured, terminated by UINT16_MAX. */
+} codec_case_t;
+
+/**@brief Defeats dead code elimination of measured calls. */
+static volatile int m_sink;
+
+static uint64_t now_ns(void)
+{
+    struct timespec now;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+static MQTTSNString string_get(bench_arg_t * p_arg)
+{
+    MQTTSNString string = MQTTSNString_initializer;
+
+    string.lenstring.data = (char *)p_arg->payload;
+    string.lenstring.len  = p_arg->size;
+
+    return string;
+}
+
+static MQTTSN_topicid topic_long_get(bench_arg_t * p_arg)
+{
+    MQTTSN_topicid topic = { .type = MQTTSN_TOPIC_TYPE_NORMAL };
+
+    topic.data.long_.name = (char *)p_arg->payload;
+    topic.data.long_.len  = p_arg->size;
+
+    return topic;
+}
+
+/***************************************************************************************************
+ * @section CONNECT
+ **************************************************************************************************/
+
+static int connect_ser(bench_arg_t * p_arg)
+{
+    MQTTSNPacket_connectData options = MQTTSNPacket_connectData_initializer;
+
+    options.clientID = string_get(p_arg);
+
+    return p_arg->len = MQTTSNSerialize_connect(p_arg->buf, sizeof(p_arg->buf), &options);
+}
+
+static int connect_des(bench_arg_t * p_arg)
+{
+    MQTTSNPacket_connectData options = MQTTSNPacket_connectData_initializer;
+
+    return MQTTSNDeserialize_connect(&options, p_arg->buf, p_arg->len);
+}
+
+static int connack_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_connack(p_arg->buf, sizeof(p_arg->buf), 0);
+}
+
+static int connack_des(bench_arg_t * p_arg)
+{
+    int rc;
+
+    return MQTTSNDeserialize_connack(&rc, p_arg->buf, p_arg->len);
+}
+
+static int disconnect_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_disconnect(p_arg->buf, sizeof(p_arg->buf), 60);
+}
+
+static int disconnect_des(bench_arg_t * p_arg)
+{
+    int duration;
+
+    return MQTTSNDeserialize_disconnect(&duration, p_arg->buf, p_arg->len);
+}
+
+static int pingreq_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_pingreq(p_arg->buf, sizeof(p_arg->buf), string_get(p_arg));
+}
+
+static int pingreq_des(bench_arg_t * p_arg)
+{
+    MQTTSNString client_id = MQTTSNString_initializer;
+
+    return MQTTSNDeserialize_pingreq(&client_id, p_arg->buf, p_arg->len);
+}
+
+static int pingresp_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_pingresp(p_arg->buf, sizeof(p_arg->buf));
+}
+
+static int pingresp_des(bench_arg_t * p_arg)
+{
+    return MQTTSNDeserialize_pingresp(p_arg->buf, p_arg->len);
+}
+
+/***************************************************************************************************
+ * @section WILL
+ **************************************************************************************************/
+
+static int willtopic_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_willtopic(p_arg->buf, sizeof(p_arg->buf), 1, 0, string_get(p_arg));
+}
+
+static int willtopic_des(bench_arg_t * p_arg)
+{
+    int           qos;
+    unsigned char retain;
+    MQTTSNString  topic = MQTTSNString_initializer;
+
+    return MQTTSNDeserialize_willtopic(&qos, &retain, &topic, p_arg->buf, p_arg->len);
+}
+
+static int willtopicupd_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_willtopicupd(p_arg->buf, sizeof(p_arg->buf), 1, 0, string_get(p_arg));
+}
+
+static int willtopicupd_des(bench_arg_t * p_arg)
+{
+    int           qos;
+    unsigned char retain;
+    MQTTSNString  topic = MQTTSNString_initializer;
+
+    return MQTTSNDeserialize_willtopicupd(&qos, &retain, &topic, p_arg->buf, p_arg->len);
+}
+
+static int willtopicreq_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_willtopicreq(p_arg->buf, sizeof(p_arg->buf));
+}
+
+static int willtopicreq_des(bench_arg_t * p_arg)
+{
+    return MQTTSNDeserialize_willtopicreq(p_arg->buf, p_arg->len);
+}
+
+static int willtopicresp_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_willtopicresp(p_arg->buf, sizeof(p_arg->buf), 0);
+}
+
+static int willtopicresp_des(bench_arg_t * p_arg)
+{
+    int rc;
+
+    return MQTTSNDeserialize_willtopicresp(&rc, p_arg->buf, p_arg->len);
+}
+
+static int willmsg_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_willmsg(p_arg->buf, sizeof(p_arg->buf), string_get(p_arg));
+}
+
+static int willmsg_des(bench_arg_t * p_arg)
+{
+    MQTTSNString msg = MQTTSNString_initializer;
+
+    return MQTTSNDeserialize_willmsg(&msg, p_arg->buf, p_arg->len);
+}
+
+static int willmsgupd_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_willmsgupd(p_arg->buf, sizeof(p_arg->buf), string_get(p_arg));
+}
+
+static int willmsgupd_des(bench_arg_t * p_arg)
+{
+    MQTTSNString msg = MQTTSNString_initializer;
+
+    return MQTTSNDeserialize_willmsgupd(&msg, p_arg->buf, p_arg->len);
+}
+
+static int willmsgreq_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_willmsgreq(p_arg->buf, sizeof(p_arg->buf));
+}
+
+static int willmsgreq_des(bench_arg_t * p_arg)
+{
+    return MQTTSNDeserialize_willmsgreq(p_arg->buf, p_arg->len);
+}
+
+static int willmsgresp_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_willmsgresp(p_arg->buf, sizeof(p_arg->buf), 0);
+}
+
+static int willmsgresp_des(bench_arg_t * p_arg)
+{
+    int rc;
+
+    return MQTTSNDeserialize_willmsgresp(&rc, p_arg->buf, p_arg->len);
+}
+
+/***************************************************************************************************
+ * @section PUBLISH
+ **************************************************************************************************/
+
+static int publish_ser(bench_arg_t * p_arg)
+{
+    MQTTSN_topicid topic = { .type = MQTTSN_TOPIC_TYPE_NORMAL, .data.id = 5 };
+
+    return p_arg->len = MQTTSNSerialize_publish(p_arg->buf, sizeof(p_arg->buf), 0, 1, 0, 1, topic,
+                                                p_arg->payload, p_arg->size);
+}
+
+static int publish_des(bench_arg_t * p_arg)
+{
+    unsigned char    dup;
+    int              qos;
+    unsigned char    retained;
+    unsigned short   packet_id;
+    MQTTSN_topicid   topic;
+    unsigned char  * p_payload;
+    int              payload_len;
+
+    int              rc;
+
+    rc = MQTTSNDeserialize_publish(&dup, &qos, &retained, &packet_id, &topic, &p_payload, &payload_len,
+                                   p_arg->buf, p_arg->len);
+
+    p_arg->decoded.topic_id  = topic.data.id;
+    p_arg->decoded.packet_id = packet_id;
+    p_arg->decoded.qos       = (uint8_t)qos;
+    p_arg->decoded.p_data    = p_payload;
+    p_arg->decoded.data_len  = (uint16_t)payload_len;
+
+    return rc;
+}
+
+static int puback_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_puback(p_arg->buf, sizeof(p_arg->buf), 5, 1, MQTTSN_RC_ACCEPTED);
+}
+
+static int puback_des(bench_arg_t * p_arg)
+{
+    unsigned short topic_id;
+    unsigned short packet_id;
+    unsigned char  rc;
+
+    int            ret;
+
+    ret = MQTTSNDeserialize_puback(&topic_id, &packet_id, &rc, p_arg->buf, p_arg->len);
+
+    p_arg->decoded.topic_id  = topic_id;
+    p_arg->decoded.packet_id = packet_id;
+    p_arg->decoded.rc        = rc;
+
+    return ret;
+}
+
+static int pubrec_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_pubrec(p_arg->buf, sizeof(p_arg->buf), 1);
+}
+
+static int pubrel_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_pubrel(p_arg->buf, sizeof(p_arg->buf), 1);
+}
+
+static int pubcomp_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_pubcomp(p_arg->buf, sizeof(p_arg->buf), 1);
+}
+
+static int ack_des(bench_arg_t * p_arg)
+{
+    unsigned char  type;
+    unsigned short packet_id;
+
+    return MQTTSNDeserialize_ack(&type, &packet_id, p_arg->buf, p_arg->len);
+}
+
+static int register_ser(bench_arg_t * p_arg)
+{
+    MQTTSNString name = string_get(p_arg);
+
+    return p_arg->len = MQTTSNSerialize_register(p_arg->buf, sizeof(p_arg->buf), 0, 1, &name);
+}
+
+static int register_des(bench_arg_t * p_arg)
+{
+    unsigned short topic_id;
+    unsigned short packet_id;
+    MQTTSNString   name = MQTTSNString_initializer;
+
+    int            rc;
+
+    rc = MQTTSNDeserialize_register(&topic_id, &packet_id, &name, p_arg->buf, p_arg->len);
+
+    p_arg->decoded.topic_id  = topic_id;
+    p_arg->decoded.packet_id = packet_id;
+    p_arg->decoded.p_data    = (const uint8_t *)name.lenstring.data;
+    p_arg->decoded.data_len  = (uint16_t)name.lenstring.len;
+
+    return rc;
+}
+
+static int regack_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_regack(p_arg->buf, sizeof(p_arg->buf), 5, 1, MQTTSN_RC_ACCEPTED);
+}
+
+static int regack_des(bench_arg_t * p_arg)
+{
+    unsigned short topic_id;
+    unsigned short packet_id;
+    unsigned char  rc;
+
+    int            ret;
+
+    ret = MQTTSNDeserialize_regack(&topic_id, &packet_id, &rc, p_arg->buf, p_arg->len);
+
+    p_arg->decoded.topic_id  = topic_id;
+    p_arg->decoded.packet_id = packet_id;
+    p_arg->decoded.rc        = rc;
+
+    return ret;
+}
+
+/***************************************************************************************************
+ * @section SUBSCRIBE
+ **************************************************************************************************/
+
+static int subscribe_ser(bench_arg_t * p_arg)
+{
+    MQTTSN_topicid topic = topic_long_get(p_arg);
+
+    return p_arg->len = MQTTSNSerialize_subscribe(p_arg->buf, sizeof(p_arg->buf), 0, 1, 1, &topic);
+}
+
+static int subscribe_des(bench_arg_t * p_arg)
+{
+    unsigned char  dup;
+    int            qos;
+    unsigned short packet_id;
+    MQTTSN_topicid topic;
+
+    return MQTTSNDeserialize_subscribe(&dup, &qos, &packet_id, &topic, p_arg->buf, p_arg->len);
+}
+
+static int suback_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_suback(p_arg->buf, sizeof(p_arg->buf), 1, 5, 1, MQTTSN_RC_ACCEPTED);
+}
+
+static int suback_des(bench_arg_t * p_arg)
+{
+    int            qos;
+    unsigned short topic_id;
+    unsigned short packet_id;
+    unsigned char  rc;
+
+    int            ret;
+
+    ret = MQTTSNDeserialize_suback(&qos, &topic_id, &packet_id, &rc, p_arg->buf, p_arg->len);
+
+    p_arg->decoded.topic_id  = topic_id;
+    p_arg->decoded.packet_id = packet_id;
+    p_arg->decoded.qos       = (uint8_t)qos;
+    p_arg->decoded.rc        = rc;
+
+    return ret;
+}
+
+static int unsubscribe_ser(bench_arg_t * p_arg)
+{
+    MQTTSN_topicid topic = topic_long_get(p_arg);
+
+    return p_arg->len = MQTTSNSerialize_unsubscribe(p_arg->buf, sizeof(p_arg->buf), 1, &topic);
+}
+
+static int unsubscribe_des(bench_arg_t * p_arg)
+{
+    unsigned short packet_id;
+    MQTTSN_topicid topic;
+
+    return MQTTSNDeserialize_unsubscribe(&packet_id, &topic, p_arg->buf, p_arg->len);
+}
+
+static int unsuback_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_unsuback(p_arg->buf, sizeof(p_arg->buf), 1);
+}
+
+static int unsuback_des(bench_arg_t * p_arg)
+{
+    unsigned short packet_id;
+
+    return MQTTSNDeserialize_unsuback(&packet_id, p_arg->buf, p_arg->len);
+}
+
+/***************************************************************************************************
+ * @section SEARCH
+ **************************************************************************************************/
+
+static int advertise_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_advertise(p_arg->buf, sizeof(p_arg->buf), 1, 900);
+}
+
+static int advertise_des(bench_arg_t * p_arg)
+{
+    unsigned char  gateway_id;
+    unsigned short duration;
+
+    return MQTTSNDeserialize_advertise(&gateway_id, &duration, p_arg->buf, p_arg->len);
+}
+
+static int searchgw_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_searchgw(p_arg->buf, sizeof(p_arg->buf), 1);
+}
+
+static int searchgw_des(bench_arg_t * p_arg)
+{
+    unsigned char radius;
+
+    return MQTTSNDeserialize_searchgw(&radius, p_arg->buf, p_arg->len);
+}
+
+static int gwinfo_ser(bench_arg_t * p_arg)
+{
+    return p_arg->len = MQTTSNSerialize_gwinfo(p_arg->buf, sizeof(p_arg->buf), 1, p_arg->size, p_arg->payload);
+}
+
+static int gwinfo_des(bench_arg_t * p_arg)
+{
+    unsigned char    gateway_id;
+    unsigned short   addr_len;
+    unsigned char  * p_addr;
+
+    return MQTTSNDeserialize_gwinfo(&gateway_id, &addr_len, &p_addr, p_arg->buf, p_arg->len);
+}
+
+/***************************************************************************************************
+ * @section CASES
+ **************************************************************************************************/
+
+/***************************************************************************************************
+ * @section Inline codec
+ **************************************************************************************************/
+
+/**@brief QoS 1 PUBLISH flags, as serialized by publish_ser. */
+#define CODEC_PUBLISH_FLAGS  (1 << MQTTSN_FLAG_QOS_POS)
+
+static int codec_publish_enc(bench_arg_t * p_arg)
+{
+    return p_arg->len = mqttsn_codec_publish_encode(p_arg->buf, sizeof(p_arg->buf), CODEC_PUBLISH_FLAGS, 5, 1,
+                                                    p_arg->payload, p_arg->size);
+}
+
+static int codec_publish_header_enc(bench_arg_t * p_arg)
+{
+    return p_arg->len = mqttsn_codec_publish_header_encode(p_arg->buf, sizeof(p_arg->buf), CODEC_PUBLISH_FLAGS,
+                                                           5, 1, p_arg->size);
+}
+
+static int codec_publish_dec(bench_arg_t * p_arg)
+{
+    uint8_t flags = 0;
+    bool    ok;
+
+    ok = mqttsn_codec_publish_decode(p_arg->buf, (uint16_t)p_arg->len, &flags, &p_arg->decoded.topic_id,
+                                     &p_arg->decoded.packet_id, &p_arg->decoded.p_data,
+                                     &p_arg->decoded.data_len);
+
+    p_arg->decoded.qos = (flags & MQTTSN_FLAG_QOS_MASK) >> MQTTSN_FLAG_QOS_POS;
+
+    return ok;
+}
+
+static int codec_puback_enc(bench_arg_t * p_arg)
+{
+    return p_arg->len = mqttsn_codec_ack_encode(p_arg->buf, sizeof(p_arg->buf), MQTTSN_PUBACK, 5, 1,
+                                                MQTTSN_RC_ACCEPTED);
+}
+
+static int codec_puback_dec(bench_arg_t * p_arg)
+{
+    return mqttsn_codec_ack_decode(p_arg->buf, (uint16_t)p_arg->len, MQTTSN_PUBACK, &p_arg->decoded.topic_id,
+                                   &p_arg->decoded.packet_id, &p_arg->decoded.rc);
+}
+
+static int codec_regack_enc(bench_arg_t * p_arg)
+{
+    return p_arg->len = mqttsn_codec_ack_encode(p_arg->buf, sizeof(p_arg->buf), MQTTSN_REGACK, 5, 1,
+                                                MQTTSN_RC_ACCEPTED);
+}
+
+static int codec_regack_dec(bench_arg_t * p_arg)
+{
+    return mqttsn_codec_ack_decode(p_arg->buf, (uint16_t)p_arg->len, MQTTSN_REGACK, &p_arg->decoded.topic_id,
+                                   &p_arg->decoded.packet_id, &p_arg->decoded.rc);
+}
+
+static int codec_register_enc(bench_arg_t * p_arg)
+{
+    return p_arg->len = mqttsn_codec_register_encode(p_arg->buf, sizeof(p_arg->buf), 0, 1, p_arg->payload,
+                                                     p_arg->size);
+}
+
+static int codec_register_dec(bench_arg_t * p_arg)
+{
+    return mqttsn_codec_register_decode(p_arg->buf, (uint16_t)p_arg->len, &p_arg->decoded.topic_id,
+                                        &p_arg->decoded.packet_id, &p_arg->decoded.p_data,
+                                        &p_arg->decoded.data_len);
+}
+
+static int codec_suback_dec(bench_arg_t * p_arg)
+{
+    uint8_t flags = 0;
+    bool    ok;
+
+    ok = mqttsn_codec_suback_decode(p_arg->buf, (uint16_t)p_arg->len, &flags, &p_arg->decoded.topic_id,
+                                    &p_arg->decoded.packet_id, &p_arg->decoded.rc);
+
+    p_arg->decoded.qos = (flags & MQTTSN_FLAG_QOS_MASK) >> MQTTSN_FLAG_QOS_POS;
+
+    return ok;
+}
+
+static int codec_pingreq_enc(bench_arg_t * p_arg)
+{
+    return p_arg->len = mqttsn_codec_pingreq_encode(p_arg->buf, sizeof(p_arg->buf), p_arg->payload,
+                                                    (uint8_t)p_arg->size);
+}
+
+static int codec_pingresp_dec(bench_arg_t * p_arg)
+{
+    return mqttsn_codec_pingresp_decode(p_arg->buf, (uint16_t)p_arg->len);
+}
+
+#define NO_SIZE       { 0, UINT16_MAX }
+#define CLIENT_IDS    { 1, 23, UINT16_MAX }
+#define TOPIC_NAMES   { 1, 16, 64, UINT16_MAX }
+#define PAYLOADS      { 0, 16, 200, 256, 1024, UINT16_MAX }
+#define SMALL_FIELDS  { 0, 16, UINT16_MAX }
+
+static const bench_case_t m_cases[] =
+{
+    { "MQTTSNSerialize_connect",         connect_ser,       connect_ser,       CLIENT_IDS   },
+    { "MQTTSNDeserialize_connect",       connect_ser,       connect_des,       CLIENT_IDS   },
+    { "MQTTSNSerialize_connack",         connack_ser,       connack_ser,       NO_SIZE      },
+    { "MQTTSNDeserialize_connack",       connack_ser,       connack_des,       NO_SIZE      },
+    { "MQTTSNSerialize_disconnect",      disconnect_ser,    disconnect_ser,    NO_SIZE      },
+    { "MQTTSNDeserialize_disconnect",    disconnect_ser,    disconnect_des,    NO_SIZE      },
+    { "MQTTSNSerialize_pingreq",         pingreq_ser,       pingreq_ser,       SMALL_FIELDS },
+    { "MQTTSNDeserialize_pingreq",       pingreq_ser,       pingreq_des,       SMALL_FIELDS },
+    { "MQTTSNSerialize_pingresp",        pingresp_ser,      pingresp_ser,      NO_SIZE      },
+    { "MQTTSNDeserialize_pingresp",      pingresp_ser,      pingresp_des,      NO_SIZE      },
+    { "MQTTSNSerialize_willtopic",       willtopic_ser,     willtopic_ser,     TOPIC_NAMES  },
+    { "MQTTSNDeserialize_willtopic",     willtopic_ser,     willtopic_des,     TOPIC_NAMES  },
+    { "MQTTSNSerialize_willtopicupd",    willtopicupd_ser,  willtopicupd_ser,  TOPIC_NAMES  },
+    { "MQTTSNDeserialize_willtopicupd",  willtopicupd_ser,  willtopicupd_des,  TOPIC_NAMES  },
+    { "MQTTSNSerialize_willtopicreq",    willtopicreq_ser,  willtopicreq_ser,  NO_SIZE      },
+    { "MQTTSNDeserialize_willtopicreq",  willtopicreq_ser,  willtopicreq_des,  NO_SIZE      },
+    { "MQTTSNSerialize_willtopicresp",   willtopicresp_ser, willtopicresp_ser, NO_SIZE      },
+    { "MQTTSNDeserialize_willtopicresp", willtopicresp_ser, willtopicresp_des, NO_SIZE      },
+    { "MQTTSNSerialize_willmsg",         willmsg_ser,       willmsg_ser,       PAYLOADS     },
+    { "MQTTSNDeserialize_willmsg",       willmsg_ser,       willmsg_des,       PAYLOADS     },
+    { "MQTTSNSerialize_willmsgupd",      willmsgupd_ser,    willmsgupd_ser,    PAYLOADS     },
+    { "MQTTSNDeserialize_willmsgupd",    willmsgupd_ser,    willmsgupd_des,    PAYLOADS     },
+    { "MQTTSNSerialize_willmsgreq",      willmsgreq_ser,    willmsgreq_ser,    NO_SIZE      },
+    { "MQTTSNDeserialize_willmsgreq",    willmsgreq_ser,    willmsgreq_des,    NO_SIZE      },
+    { "MQTTSNSerialize_willmsgresp",     willmsgresp_ser,   willmsgresp_ser,   NO_SIZE      },
+    { "MQTTSNDeserialize_willmsgresp",   willmsgresp_ser,   willmsgresp_des,   NO_SIZE      },
+    { "MQTTSNSerialize_publish",         publish_ser,       publish_ser,       PAYLOADS     },
+    { "MQTTSNDeserialize_publish",       publish_ser,       publish_des,       PAYLOADS     },
+    { "MQTTSNSerialize_puback",          puback_ser,        puback_ser,        NO_SIZE      },
+    { "MQTTSNDeserialize_puback",        puback_ser,        puback_des,        NO_SIZE      },
+    { "MQTTSNSerialize_pubrec",          pubrec_ser,        pubrec_ser,        NO_SIZE      },
+    { "MQTTSNSerialize_pubrel",          pubrel_ser,        pubrel_ser,        NO_SIZE      },
+    { "MQTTSNSerialize_pubcomp",         pubcomp_ser,       pubcomp_ser,       NO_SIZE      },
+    { "MQTTSNDeserialize_ack",           pubrec_ser,        ack_des,           NO_SIZE      },
+    { "MQTTSNSerialize_register",        register_ser,      register_ser,      TOPIC_NAMES  },
+    { "MQTTSNDeserialize_register",      register_ser,      register_des,      TOPIC_NAMES  },
+    { "MQTTSNSerialize_regack",          regack_ser,        regack_ser,        NO_SIZE      },
+    { "MQTTSNDeserialize_regack",        regack_ser,        regack_des,        NO_SIZE      },
+    { "MQTTSNSerialize_subscribe",       subscribe_ser,     subscribe_ser,     TOPIC_NAMES  },
+    { "MQTTSNDeserialize_subscribe",     subscribe_ser,     subscribe_des,     TOPIC_NAMES  },
+    { "MQTTSNSerialize_suback",          suback_ser,        suback_ser,        NO_SIZE      },
+    { "MQTTSNDeserialize_suback",        suback_ser,        suback_des,        NO_SIZE      },
+    { "MQTTSNSerialize_unsubscribe",     unsubscribe_ser,   unsubscribe_ser,   TOPIC_NAMES  },
+    { "MQTTSNDeserialize_unsubscribe",   unsubscribe_ser,   unsubscribe_des,   TOPIC_NAMES  },
+    { "MQTTSNSerialize_unsuback",        unsuback_ser,      unsuback_ser,      NO_SIZE      },
+    { "MQTTSNDeserialize_unsuback",      unsuback_ser,      unsuback_des,      NO_SIZE      },
+    { "MQTTSNSerialize_advertise",       advertise_ser,     advertise_ser,     NO_SIZE      },
+    { "MQTTSNDeserialize_advertise",     advertise_ser,     advertise_des,     NO_SIZE      },
+    { "MQTTSNSerialize_searchgw",        searchgw_ser,      searchgw_ser,      NO_SIZE      },
+    { "MQTTSNDeserialize_searchgw",      searchgw_ser,      searchgw_des,      NO_SIZE      },
+    { "MQTTSNSerialize_gwinfo",          gwinfo_ser,        gwinfo_ser,        SMALL_FIELDS },
+    { "MQTTSNDeserialize_gwinfo",        gwinfo_ser,        gwinfo_des,        SMALL_FIELDS },
+};
+
+static const codec_case_t m_codec_cases[] =
+{
+    { "publish encode",   NULL,         publish_ser,  codec_publish_enc,        false, PAYLOADS     },
+    { "publish header",   NULL,         publish_ser,  codec_publish_header_enc, true,  PAYLOADS     },
+    { "publish decode",   publish_ser,  publish_des,  codec_publish_dec,        false, PAYLOADS     },
+    { "puback encode",    NULL,         puback_ser,   codec_puback_enc,         false, NO_SIZE      },
+    { "puback decode",    puback_ser,   puback_des,   codec_puback_dec,         false, NO_SIZE      },
+    { "register encode",  NULL,         register_ser, codec_register_enc,       false, TOPIC_NAMES  },
+    { "register decode",  register_ser, register_des, codec_register_dec,       false, TOPIC_NAMES  },
+    { "regack encode",    NULL,         regack_ser,   codec_regack_enc,         false, NO_SIZE      },
+    { "regack decode",    regack_ser,   regack_des,   codec_regack_dec,         false, NO_SIZE      },
+    { "suback decode",    suback_ser,   suback_des,   codec_suback_dec,         false, NO_SIZE      },
+    { "pingreq encode",   NULL,         pingreq_ser,  codec_pingreq_enc,        false, SMALL_FIELDS },
+    { "pingresp decode",  pingresp_ser, pingresp_des, codec_pingresp_dec,       false, NO_SIZE      },
+};
+
+static uint64_t ticks_get(void)
+{
+#if BENCH_TICKS_AVAILABLE
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**@brief Measures a call.
+ *
+ * @param[in]    op          Measured call.
+ * @param[inout] p_arg       Arguments of the call.
+ * @param[in]    time_ns     Time to spend measuring.
+ * @param[out]   p_ticks     Mean time stamp counter ticks per call. May be NULL.
+ *
+ * @return       Mean time per call in nanoseconds.
+ */
+static double measure(bench_op_t op, bench_arg_t * p_arg, uint64_t time_ns, double * p_ticks)
+{
+    uint64_t iterations = 1;
+
+    for (;;)
+    {
+        uint64_t start       = now_ns();
+        uint64_t start_ticks = ticks_get();
+
+        for (uint64_t i = 0; i < iterations; i++)
+        {
+            m_sink = op(p_arg);
+        }
+
+        uint64_t ticks   = ticks_get() - start_ticks;
+        uint64_t elapsed = now_ns() - start;
+
+        if (elapsed >= time_ns || iterations >= (1ULL << 40))
+        {
+            if (p_ticks != NULL)
+            {
+                *p_ticks = (double)ticks / (double)iterations;
+            }
+
+            return (double)elapsed / (double)iterations;
+        }
+
+        iterations *= 2;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    static bench_arg_t arg;
+    uint64_t           time_ns = BENCH_TIME_NS;
+    int                failed  = 0;
+
+    if (argc > 1 && strcmp(argv[1], "--quick") == 0)
+    {
+        time_ns = BENCH_QUICK_TIME_NS;
+    }
+
+    for (uint32_t i = 0; i < sizeof(arg.payload); i++)
+    {
+        arg.payload[i] = (unsigned char)('a' + i % 26);
+    }
+
+    printf("%-34s %6s %8s %10s\n", "function", "size", "frame", "ns/op");
+
+    for (uint32_t i = 0; i < sizeof(m_cases) / sizeof(m_cases[0]); i++)
+    {
+        const bench_case_t * p_case = &m_cases[i];
+
+        for (uint32_t j = 0; p_case->sizes[j] != UINT16_MAX; j++)
+        {
+            arg.size = p_case->sizes[j];
+
+            /* Every frame is checked to round-trip, so that a broken case is not timed. */
+            if (p_case->serialize(&arg) <= 0 || p_case->op(&arg) <= 0)
+            {
+                printf("%-34s %6u %8s\n", p_case->p_name, arg.size, "FAILED");
+                failed = 1;
+                continue;
+            }
+
+            double ns = measure(p_case->op, &arg, time_ns, NULL);
+
+            printf("%-34s %6u %8d %10.1f\n", p_case->p_name, arg.size, arg.len, ns);
+        }
+    }
+
+    printf("\n%-18s %6s %8s %10s %10s %10s %10s %8s\n", "codec vs paho", "size", "frame", "paho ns",
+           "codec ns", "paho tsc", "codec tsc", "speedup");
+
+    for (uint32_t i = 0; i < sizeof(m_codec_cases) / sizeof(m_codec_cases[0]); i++)
+    {
+        const codec_case_t * p_case = &m_codec_cases[i];
+
+        for (uint32_t j = 0; p_case->sizes[j] != UINT16_MAX; j++)
+        {
+            static unsigned char expected[BENCH_BUF_LENGTH];
+            bench_decoded_t      decoded;
+            int                  expected_len;
+            bool                 same;
+
+            arg.size = p_case->sizes[j];
+
+            if (p_case->serialize != NULL && p_case->serialize(&arg) <= 0)
+            {
+                printf("%-18s %6u %8s\n", p_case->p_name, arg.size, "FAILED");
+                failed = 1;
+                continue;
+            }
+
+            /* Both must encode the same bytes, or decode the same fields, before they are timed. */
+            memset(&arg.decoded, 0, sizeof(arg.decoded));
+            same         = (p_case->paho(&arg) > 0);
+            expected_len = arg.len;
+            decoded      = arg.decoded;
+            memcpy(expected, arg.buf, sizeof(expected));
+
+            memset(&arg.decoded, 0, sizeof(arg.decoded));
+            if (p_case->serialize == NULL)
+            {
+                memset(arg.buf, 0, sizeof(arg.buf));
+            }
+            same = same && (p_case->codec(&arg) > 0) &&
+                   (p_case->header ? (arg.len + arg.size == expected_len) : (arg.len == expected_len)) &&
+                   (memcmp(arg.buf, expected, (size_t)arg.len) == 0) &&
+                   (memcmp(&arg.decoded, &decoded, sizeof(decoded)) == 0);
+
+            if (!same)
+            {
+                printf("%-18s %6u %8s\n", p_case->p_name, arg.size, "MISMATCH");
+                failed = 1;
+                continue;
+            }
+
+            double paho_ticks;
+            double codec_ticks;
+            double paho_ns  = measure(p_case->paho, &arg, time_ns, &paho_ticks);
+            double codec_ns = measure(p_case->codec, &arg, time_ns, &codec_ticks);
+
+            if (BENCH_TICKS_AVAILABLE)
+            {
+                printf("%-18s %6u %8d %10.1f %10.1f %10.1f %10.1f %7.1fx\n", p_case->p_name, arg.size, arg.len,
+                       paho_ns, codec_ns, paho_ticks, codec_ticks, paho_ns / codec_ns);
+            }
+            else
+            {
+                printf("%-18s %6u %8d %10.1f %10.1f %10s %10s %7.1fx\n", p_case->p_name, arg.size, arg.len,
+                       paho_ns, codec_ns, "-", "-", paho_ns / codec_ns);
+            }
+        }
+    }
+
+    return failed;
+}
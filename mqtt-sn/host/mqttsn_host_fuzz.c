@@ -0,0 +1,194 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/**@file mqttsn_host_fuzz.c
+ *
+ * @brief Fuzz target feeding frames to @ref mqttsn_packet_receiver.
+ *
+ * @details Each input starts a fresh client connected over the loopback transport. The first byte
+ *          selects the client setup:
+ *          - bits 0-3: initialized client state forced before the frames are received, modulo
+ *                      the number of such states,
+ *          - bit 4:    a topic is registered, published to and subscribed to first,
+ *          - bit 5:    received publications are dropped oldest first instead of acknowledged on
+ *                      delivery,
+ *          - bit 6:    the transport is not point-to-point.
+ *          The rest is a sequence of frames, each preceded by an action byte and a length byte:
+ *          - bit 0 of the action: the virtual clock is advanced by 10 seconds before the frame,
+ *          - bit 1 of the action: received publications are delivered after the frame.
+ *          A frame shorter than its length byte ends the input.
+ *
+ *          Built with clang, this is a libFuzzer target. Otherwise it is linked with
+ *          mqttsn_host_fuzz_main.c.
+ */
+
+#include "mqttsn_client.h"
+#include "mqttsn_packet_internal.h"
+#include "mqttsn_platform_posix.h"
+#include "mqttsn_transport_host.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SETUP_STATE_MASK      0x0F
+#define SETUP_TRAFFIC         0x10
+#define SETUP_DROP_OLDEST     0x20
+#define SETUP_MULTICAST       0x40
+
+#define ACTION_TIME_ADVANCE   0x01
+#define ACTION_PROCESS        0x02
+
+/**@brief Number of client states. */
+#define CLIENT_STATE_COUNT    (MQTTSN_CLIENT_AWAKE + 1)
+
+/**@brief Time the virtual clock is advanced by, in milliseconds. */
+#define TIME_ADVANCE_MS       10000
+
+static mqttsn_client_t m_client;
+
+static void evt_handler(mqttsn_client_t * p_client, mqttsn_event_t * p_event)
+{
+    (void)p_client;
+    (void)p_event;
+}
+
+/**@brief Connects the client over the loopback transport, answering CONNECT with CONNACK. */
+static void client_connect(void)
+{
+    static const uint8_t connack[] = { 3, MQTTSN_CONNACK, MQTTSN_RC_ACCEPTED };
+    mqttsn_remote_t      gateway;
+    mqttsn_connect_opt_t options   =
+    {
+        .alive_duration = MQTTSN_DEFAULT_ALIVE_DURATION,
+        .clean_session  = MQTTSN_DEFAULT_CLEAN_SESSION_FLAG,
+        .client_id_len  = 4,
+    };
+
+    memset(&gateway, 0, sizeof(gateway));
+    memcpy(options.p_client_id, "fuzz", options.client_id_len);
+
+    (void)mqttsn_client_search_gateway(&m_client);
+
+    /* Without a point-to-point transport, the gateway is found through GWINFO. */
+    if (m_client.client_state != MQTTSN_CLIENT_GATEWAY_FOUND)
+    {
+        static const uint8_t gwinfo[] = { 3, MQTTSN_GWINFO, 1 };
+
+        (void)mqttsn_transport_read(&m_client, NULL, &gateway, gwinfo, sizeof(gwinfo));
+    }
+
+    (void)mqttsn_client_connect(&m_client, &options);
+    (void)mqttsn_transport_read(&m_client, NULL, &gateway, connack, sizeof(connack));
+}
+
+/**@brief Starts traffic the received frames may answer. */
+static void client_traffic_start(void)
+{
+    static const uint8_t topic[]   = "fuzz/topic";
+    static const uint8_t payload[] = "x";
+
+    (void)mqttsn_client_topic_register(&m_client, topic, sizeof(topic) - 1, NULL);
+    (void)mqttsn_client_publish(&m_client, 1, payload, 1, NULL);
+    (void)mqttsn_client_subscribe(&m_client, topic, sizeof(topic) - 1, NULL);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t * p_data, size_t size)
+{
+    static bool     platform_ready = false;
+    mqttsn_remote_t gateway;
+
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    memset(&gateway, 0, sizeof(gateway));
+
+    if (!platform_ready)
+    {
+        mqttsn_platform_posix_clock_set(MQTTSN_PLATFORM_POSIX_CLOCK_VIRTUAL, 1000);
+        platform_ready = true;
+    }
+
+    uint8_t setup = p_data[0];
+
+    mqttsn_transport_host_caps_set((setup & SETUP_MULTICAST) ? 0 : MQTTSN_TRANSPORT_CAP_POINT_TO_POINT);
+
+    if (mqttsn_client_init(&m_client, MQTTSN_DEFAULT_CLIENT_PORT, evt_handler, NULL) != NRF_SUCCESS)
+    {
+        abort();
+    }
+
+    client_connect();
+
+    if (setup & SETUP_TRAFFIC)
+    {
+        client_traffic_start();
+    }
+
+    if (setup & SETUP_DROP_OLDEST)
+    {
+        (void)mqttsn_client_delivery_policy_set(&m_client, MQTTSN_DELIVERY_DROP_OLDEST);
+    }
+
+    /* IDLE is left out: an uninitialized client could not be uninitialized at the end. */
+    m_client.client_state = (mqttsn_client_state_t)(MQTTSN_CLIENT_IDLE + 1 +
+                                                    (setup & SETUP_STATE_MASK) % (CLIENT_STATE_COUNT - 1));
+
+    size_t offset = 1;
+
+    while (offset + 2 <= size)
+    {
+        uint8_t action = p_data[offset];
+        uint8_t len    = p_data[offset + 1];
+
+        offset += 2;
+
+        if (offset + len > size)
+        {
+            break;
+        }
+
+        if (action & ACTION_TIME_ADVANCE)
+        {
+            (void)mqttsn_platform_posix_time_advance(TIME_ADVANCE_MS);
+        }
+
+        /* A copy of the exact length, so that reads past the frame are caught. */
+        uint8_t * p_frame = malloc(len ? len : 1);
+
+        if (p_frame == NULL)
+        {
+            abort();
+        }
+
+        memcpy(p_frame, &p_data[offset], len);
+        (void)mqttsn_transport_read(&m_client, NULL, &gateway, p_frame, len);
+        free(p_frame);
+
+        if (action & ACTION_PROCESS)
+        {
+            (void)mqttsn_client_process(&m_client);
+        }
+
+        offset += len;
+    }
+
+    (void)mqttsn_client_uninit(&m_client);
+
+    /* Packets still queued are not freed by the client. The pool starts over, as after a reset. */
+    (void)nrf_mem_init();
+
+    return 0;
+}
@@ -0,0 +1,292 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/**@file mqttsn_host_fuzz_main.c
+ *
+ * @brief Coverage-guided fuzz driver for compilers without libFuzzer.
+ *
+ * @details The sources under test are compiled with -fsanitize-coverage=trace-pc, so that every
+ *          basic block reports its address. Inputs reaching a block not seen before are kept in
+ *          the corpus and mutated further. Accepts the libFuzzer options used by the build:
+ *
+ *          Usage: mqttsn_host_fuzz [-runs=N] [-seed=S] [FILE...]
+ *
+ *          Files are added to the built-in seed corpus and run first.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MQTTSNPacket.h"
+
+/**@brief Number of bits of the coverage map. */
+#define COVERAGE_MAP_BITS     (1u << 18)
+
+/**@brief Maximum number of inputs kept in the corpus. */
+#define CORPUS_MAX_LENGTH     4096
+
+/**@brief Maximum length of an input. */
+#define INPUT_MAX_LENGTH      512
+
+/**@brief Default number of mutated inputs run. */
+#define DEFAULT_RUNS          200000
+
+/**@brief Input kept in the corpus. */
+typedef struct input_t
+{
+    uint16_t len;                     /**< Length of the input. */
+    uint8_t  data[INPUT_MAX_LENGTH];  /**< Input. */
+} input_t;
+
+int LLVMFuzzerTestOneInput(const uint8_t * p_data, size_t size);
+
+static uint8_t  m_coverage[COVERAGE_MAP_BITS / 8];
+static uint32_t m_new_blocks;
+static input_t  m_corpus[CORPUS_MAX_LENGTH];
+static uint32_t m_corpus_len;
+static uint64_t m_rand_state;
+
+/**@brief Records the calling basic block. Called by code built with -fsanitize-coverage=trace-pc. */
+void __sanitizer_cov_trace_pc(void)
+{
+    uintptr_t pc  = (uintptr_t)__builtin_return_address(0);
+    uint32_t  bit = (uint32_t)((pc ^ (pc >> 18)) % COVERAGE_MAP_BITS);
+
+    if ((m_coverage[bit / 8] & (1u << (bit % 8))) == 0)
+    {
+        m_coverage[bit / 8] |= (uint8_t)(1u << (bit % 8));
+        m_new_blocks++;
+    }
+}
+
+static uint32_t rand_get(void)
+{
+    /* xorshift64* */
+    m_rand_state ^= m_rand_state >> 12;
+    m_rand_state ^= m_rand_state << 25;
+    m_rand_state ^= m_rand_state >> 27;
+
+    return (uint32_t)((m_rand_state * 2685821657736338717ULL) >> 32);
+}
+
+/**@brief Runs an input and keeps it if it has reached new code. */
+static bool input_run(const uint8_t * p_data, uint16_t len)
+{
+    uint32_t new_blocks = m_new_blocks;
+
+    (void)LLVMFuzzerTestOneInput(p_data, len);
+
+    if (m_new_blocks == new_blocks || m_corpus_len == CORPUS_MAX_LENGTH)
+    {
+        return false;
+    }
+
+    m_corpus[m_corpus_len].len = len;
+    memcpy(m_corpus[m_corpus_len].data, p_data, len);
+    m_corpus_len++;
+
+    return true;
+}
+
+/**@brief Adds a seed made of a setup byte and a single frame. */
+static void seed_add(uint8_t setup, const uint8_t * p_frame, uint8_t len)
+{
+    uint8_t input[INPUT_MAX_LENGTH] = { setup, 0, len };
+
+    memcpy(&input[3], p_frame, len);
+    (void)input_run(input, (uint16_t)(3 + len));
+}
+
+/**@brief Runs the built-in seeds, one frame of every type the client handles, in both Length
+ *        forms. */
+static void seeds_run(void)
+{
+    static const uint8_t frames[][12] =
+    {
+        { 5, MQTTSN_ADVERTISE, 7, 3, 0x84 },
+        { 3, MQTTSN_GWINFO, 7 },
+        { 2, MQTTSN_WILLTOPICREQ },
+        { 2, MQTTSN_WILLMSGREQ },
+        { 3, MQTTSN_CONNACK, 0 },
+        { 10, MQTTSN_REGISTER, 0, 5, 0, 1, 't', 'e', 'm', 'p' },
+        { 7, MQTTSN_REGACK, 0, 1, 0, 1, 0 },
+        { 9, MQTTSN_PUBLISH, 0x20, 0, 5, 0, 1, 'x', 'y' },
+        { 9, MQTTSN_PUBLISH, 0xA0, 0, 5, 0, 1, 'x', 'y' },
+        { 7, MQTTSN_PUBACK, 0, 1, 0, 2, 0 },
+        { 8, MQTTSN_SUBACK, 0x20, 0, 5, 0, 3, 0 },
+        { 4, MQTTSN_UNSUBACK, 0, 1 },
+        { 2, MQTTSN_PINGRESP },
+        { 2, MQTTSN_DISCONNECT },
+        { 4, MQTTSN_DISCONNECT, 0, 5 },
+        { 3, MQTTSN_WILLTOPICRESP, 0 },
+        { 3, MQTTSN_WILLMSGRESP, 0 },
+    };
+
+    for (uint32_t setup = 0; setup < 0x80; setup += 0x0B)
+    {
+        for (uint32_t i = 0; i < sizeof(frames) / sizeof(frames[0]); i++)
+        {
+            uint8_t len = frames[i][0];
+            uint8_t three_byte[16] = { 1, 0, (uint8_t)(len + 2) };
+
+            seed_add((uint8_t)setup, frames[i], len);
+
+            memcpy(&three_byte[3], &frames[i][1], len - 1);
+            seed_add((uint8_t)setup, three_byte, (uint8_t)(len + 2));
+        }
+    }
+}
+
+/**@brief Mutates an input in place. */
+static uint16_t mutate(uint8_t * p_data, uint16_t len)
+{
+    static const uint8_t interesting[] = { 0x00, 0x01, 0x02, 0x03, 0x7F, 0x80, 0xFF, MQTTSN_PUBLISH };
+    uint32_t             count         = 1 + rand_get() % 4;
+
+    while (count--)
+    {
+        uint32_t pos = len ? rand_get() % len : 0;
+
+        switch (rand_get() % 7)
+        {
+            case 0:
+                if (len)
+                {
+                    p_data[pos] ^= (uint8_t)(1u << (rand_get() % 8));
+                }
+                break;
+
+            case 1:
+                if (len)
+                {
+                    p_data[pos] = (uint8_t)rand_get();
+                }
+                break;
+
+            case 2:
+                if (len)
+                {
+                    p_data[pos] = interesting[rand_get() % sizeof(interesting)];
+                }
+                break;
+
+            case 3:
+                if (len < INPUT_MAX_LENGTH)
+                {
+                    memmove(&p_data[pos + 1], &p_data[pos], len - pos);
+                    p_data[pos] = (uint8_t)rand_get();
+                    len++;
+                }
+                break;
+
+            case 4:
+                if (len > 1)
+                {
+                    memmove(&p_data[pos], &p_data[pos + 1], len - pos - 1);
+                    len--;
+                }
+                break;
+
+            case 5:
+                len = (uint16_t)(len ? rand_get() % (len + 1) : 0);
+                break;
+
+            default:
+            {
+                /* Splice the tail of another input. */
+                const input_t * p_other = &m_corpus[rand_get() % m_corpus_len];
+                uint32_t        from    = p_other->len ? rand_get() % p_other->len : 0;
+                uint32_t        copied  = p_other->len - from;
+
+                if (pos + copied > INPUT_MAX_LENGTH)
+                {
+                    copied = INPUT_MAX_LENGTH - pos;
+                }
+
+                memcpy(&p_data[pos], &p_other->data[from], copied);
+                len = (uint16_t)(pos + copied);
+                break;
+            }
+        }
+    }
+
+    return len;
+}
+
+/**@brief Runs an input read from a file. */
+static int file_run(const char * p_path)
+{
+    uint8_t input[INPUT_MAX_LENGTH];
+    FILE  * p_file = fopen(p_path, "rb");
+
+    if (p_file == NULL)
+    {
+        fprintf(stderr, "cannot open %s\n", p_path);
+        return 1;
+    }
+
+    size_t len = fread(input, 1, sizeof(input), p_file);
+    fclose(p_file);
+
+    (void)input_run(input, (uint16_t)len);
+
+    return 0;
+}
+
+int main(int argc, char ** argv)
+{
+    uint64_t runs = DEFAULT_RUNS;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "-runs=", 6) == 0)
+        {
+            runs = strtoull(&argv[i][6], NULL, 10);
+        }
+        else if (strncmp(argv[i], "-seed=", 6) == 0)
+        {
+            seed = strtoull(&argv[i][6], NULL, 10);
+        }
+        else if (argv[i][0] == '-')
+        {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+        else if (file_run(argv[i]) != 0)
+        {
+            return 1;
+        }
+    }
+
+    m_rand_state = seed ? seed : 1;
+
+    seeds_run();
+
+    for (uint64_t run = 0; run < runs; run++)
+    {
+        uint8_t         input[INPUT_MAX_LENGTH];
+        const input_t * p_parent = &m_corpus[rand_get() % m_corpus_len];
+
+        memcpy(input, p_parent->data, p_parent->len);
+
+        (void)input_run(input, mutate(input, p_parent->len));
+    }
+
+    printf("runs: %llu, corpus: %u, blocks: %u\n", (unsigned long long)runs, m_corpus_len, m_new_blocks);
+
+    return 0;
+}
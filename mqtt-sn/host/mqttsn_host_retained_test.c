@@ -0,0 +1,354 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+
+/**@file mqttsn_host_retained_test.c
+ *
+ * @brief Test of client state kept across soft resets.
+ *
+ * @details A reset is simulated by keeping the retained images as the .non_init section keeps
+ *          them, while the client, its timer and the memory manager start over. The test fails
+ *          with the line of the first failed check.
+ */
+
+#include "mqttsn_client.h"
+#include "mqttsn_packet_internal.h"
+#include "mqttsn_platform_posix.h"
+#include "mqttsn_transport_host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(EXPR)                                                                                \
+    if (!(EXPR))                                                                                   \
+    {                                                                                              \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #EXPR);                            \
+        exit(1);                                                                                   \
+    }
+
+/**@brief Port of the second client. */
+#define OTHER_CLIENT_PORT     (MQTTSN_DEFAULT_CLIENT_PORT + 1)
+
+/**@brief Topic ID assigned by the gateway. */
+#define GATEWAY_TOPIC_ID      5
+
+/**@brief Maximum number of frames recorded. */
+#define SENT_MAX_LENGTH       32
+
+/**@brief Frame written by a client. */
+typedef struct sent_frame_t
+{
+    uint16_t len;                     /**< Length of the frame. */
+    uint8_t  data[128];               /**< Frame. */
+} sent_frame_t;
+
+static mqttsn_client_t m_client;
+static mqttsn_client_t m_other_client;
+static sent_frame_t    m_sent[SENT_MAX_LENGTH];
+static uint32_t        m_sent_count;
+static uint16_t        m_topic_id;
+
+static uint32_t write_handler(mqttsn_client_t * p_client, const uint8_t * p_data, uint16_t datalen)
+{
+    (void)p_client;
+
+    CHECK(m_sent_count < SENT_MAX_LENGTH && datalen <= sizeof(m_sent[0].data));
+
+    memcpy(m_sent[m_sent_count].data, p_data, datalen);
+    m_sent[m_sent_count].len = datalen;
+    m_sent_count++;
+
+    return NRF_SUCCESS;
+}
+
+static void evt_handler(mqttsn_client_t * p_client, mqttsn_event_t * p_event)
+{
+    (void)p_client;
+
+    if (p_event->event_id == MQTTSN_EVENT_REGISTERED)
+    {
+        m_topic_id = p_event->event_data.registered.packet.topic.topic_id;
+    }
+}
+
+/**@brief Gets the last frame written. */
+static const sent_frame_t * last_sent_get(void)
+{
+    CHECK(m_sent_count > 0);
+
+    return &m_sent[m_sent_count - 1];
+}
+
+/**@brief Feeds a frame from the gateway to a client. */
+static void receive(mqttsn_client_t * p_client, const uint8_t * p_data, uint16_t datalen)
+{
+    mqttsn_remote_t gateway;
+
+    memset(&gateway, 0, sizeof(gateway));
+    CHECK(mqttsn_transport_read(p_client, NULL, &gateway, p_data, datalen) == NRF_SUCCESS);
+}
+
+/**@brief Connects a client to the gateway. */
+static void client_connect(mqttsn_client_t * p_client, uint8_t clean_session)
+{
+    static const uint8_t connack[] = { 3, MQTTSN_CONNACK, MQTTSN_RC_ACCEPTED };
+    mqttsn_connect_opt_t options;
+
+    memset(&options, 0, sizeof(options));
+    options.alive_duration = MQTTSN_DEFAULT_ALIVE_DURATION;
+    options.clean_session  = clean_session;
+    options.client_id_len  = 4;
+    memcpy(options.p_client_id, "host", options.client_id_len);
+
+    if (p_client->client_state == MQTTSN_CLIENT_IDLE || p_client->client_state == MQTTSN_CLIENT_DISCONNECTED)
+    {
+        CHECK(mqttsn_client_search_gateway(p_client) == NRF_SUCCESS);
+    }
+
+    CHECK(mqttsn_client_connect(p_client, &options) == NRF_SUCCESS);
+    CHECK(last_sent_get()->data[1] == MQTTSN_CONNECT);
+
+    receive(p_client, connack, sizeof(connack));
+    CHECK(p_client->client_state == MQTTSN_CLIENT_CONNECTED);
+}
+
+/**@brief Registers a topic and answers with REGACK. */
+static void topic_register(mqttsn_client_t * p_client)
+{
+    static const uint8_t topic[] = "host/temp";
+    uint16_t             msg_id;
+    uint8_t              regack[7];
+
+    CHECK(mqttsn_client_topic_register(p_client, topic, sizeof(topic) - 1, &msg_id) == NRF_SUCCESS);
+    CHECK(last_sent_get()->data[1] == MQTTSN_REGISTER);
+
+    CHECK(mqttsn_codec_ack_encode(regack, sizeof(regack), MQTTSN_REGACK, GATEWAY_TOPIC_ID, msg_id,
+                                  MQTTSN_RC_ACCEPTED) == sizeof(regack));
+    receive(p_client, regack, sizeof(regack));
+    CHECK(m_topic_id != 0);
+}
+
+/**@brief Gets the valid image saved for a port. */
+static mqttsn_retained_t * image_get(uint16_t port)
+{
+    for (uint32_t i = 0; i < MQTTSN_RETAINED_MAX_CLIENTS; i++)
+    {
+        mqttsn_retained_t * p_image = mqttsn_platform_retained_get(i);
+
+        if (p_image->magic != 0 && p_image->session.port == port)
+        {
+            return p_image;
+        }
+    }
+
+    CHECK(false);
+
+    return NULL;
+}
+
+/**@brief Simulates a soft reset of the device.
+ *
+ * @details Everything but the retained images is lost. The client is initialized again, on the
+ *          given port.
+ */
+static void reset(mqttsn_client_t * p_client, uint16_t port)
+{
+    static mqttsn_retained_t images[MQTTSN_RETAINED_MAX_CLIENTS];
+
+    for (uint32_t i = 0; i < MQTTSN_RETAINED_MAX_CLIENTS; i++)
+    {
+        memcpy(&images[i], mqttsn_platform_retained_get(i), sizeof(mqttsn_retained_t));
+    }
+
+    /* Releases the timer and the image, as the RAM cleared at startup does. */
+    CHECK(mqttsn_client_uninit(p_client) == NRF_SUCCESS);
+
+    for (uint32_t i = 0; i < MQTTSN_RETAINED_MAX_CLIENTS; i++)
+    {
+        memcpy(mqttsn_platform_retained_get(i), &images[i], sizeof(mqttsn_retained_t));
+    }
+
+    CHECK(nrf_mem_init() == NRF_SUCCESS);
+    memset(p_client, 0, sizeof(*p_client));
+
+    CHECK(mqttsn_client_init(p_client, port, evt_handler, NULL) == NRF_SUCCESS);
+}
+
+/**@brief Checks that an in-flight and a deferred publication are restored after reset and sent
+ *        again when the session is resumed. */
+static void test_publications_restored(void)
+{
+    static const uint8_t in_flight[] = "hello";
+    static const uint8_t deferred[]  = "x";
+    uint16_t             msg_id;
+
+    CHECK(mqttsn_client_init(&m_client, MQTTSN_DEFAULT_CLIENT_PORT, evt_handler, NULL) == NRF_SUCCESS);
+    client_connect(&m_client, 1);
+    topic_register(&m_client);
+
+    CHECK(mqttsn_client_publish(&m_client, m_topic_id, in_flight, sizeof(in_flight) - 1, &msg_id) == NRF_SUCCESS);
+
+    m_client.client_state = MQTTSN_CLIENT_DISCONNECTED;
+    CHECK(mqttsn_client_publish(&m_client, m_topic_id, deferred, sizeof(deferred) - 1, NULL) == NRF_SUCCESS);
+    CHECK(m_client.deferred_queue.num_of_elements == 1);
+
+    reset(&m_client, MQTTSN_DEFAULT_CLIENT_PORT);
+
+    CHECK(m_client.packet_queue.num_of_elements == 1);
+    CHECK(m_client.deferred_queue.num_of_elements == 1);
+    CHECK(m_client.message_id == msg_id);
+
+    uint32_t first = m_sent_count;
+
+    client_connect(&m_client, 0);
+
+    /* CONNECT, the in-flight publication again with DUP set, then the deferred one. */
+    CHECK(m_sent_count == first + 3);
+
+    const uint8_t * p_dup  = m_sent[first + 1].data;
+    const uint8_t * p_next = m_sent[first + 2].data;
+
+    CHECK(p_dup[1] == MQTTSN_PUBLISH && (p_dup[2] & MQTTSN_FLAG_DUP) != 0);
+    CHECK(mqttsn_codec_uint16_read(&p_dup[3]) == GATEWAY_TOPIC_ID);
+    CHECK(mqttsn_codec_uint16_read(&p_dup[5]) == msg_id);
+    CHECK(memcmp(&p_dup[7], in_flight, sizeof(in_flight) - 1) == 0);
+    CHECK(p_next[1] == MQTTSN_PUBLISH && (p_next[2] & MQTTSN_FLAG_DUP) == 0 && p_next[7] == deferred[0]);
+
+    CHECK(mqttsn_client_uninit(&m_client) == NRF_SUCCESS);
+}
+
+/**@brief Checks that a corrupted image is not restored. */
+static void test_corrupted_image_ignored(void)
+{
+    static const uint8_t payload[] = "y";
+
+    CHECK(mqttsn_client_init(&m_client, MQTTSN_DEFAULT_CLIENT_PORT, evt_handler, NULL) == NRF_SUCCESS);
+    client_connect(&m_client, 1);
+    topic_register(&m_client);
+
+    m_client.client_state = MQTTSN_CLIENT_DISCONNECTED;
+    CHECK(mqttsn_client_publish(&m_client, m_topic_id, payload, sizeof(payload) - 1, NULL) == NRF_SUCCESS);
+
+    mqttsn_retained_t * p_image = image_get(MQTTSN_DEFAULT_CLIENT_PORT);
+
+    CHECK(p_image->deferred.num_of_elements == 1);
+    p_image->deferred.publish[0].p_payload[0] ^= 0x02;
+
+    reset(&m_client, MQTTSN_DEFAULT_CLIENT_PORT);
+
+    CHECK(m_client.deferred_queue.num_of_elements == 0);
+    CHECK(m_client.message_id == 0);
+
+    CHECK(mqttsn_client_uninit(&m_client) == NRF_SUCCESS);
+}
+
+/**@brief Checks that a frame which changes nothing kept across resets leaves the image alone, and
+ *        that a change rewrites only its part. */
+static void test_unchanged_state_not_saved(void)
+{
+    static const uint8_t pingresp[] = { 2, MQTTSN_PINGRESP };
+    static const uint8_t payload[]  = "v";
+    mqttsn_retained_t    saved;
+
+    CHECK(mqttsn_client_init(&m_client, MQTTSN_DEFAULT_CLIENT_PORT, evt_handler, NULL) == NRF_SUCCESS);
+    client_connect(&m_client, 1);
+    topic_register(&m_client);
+
+    /* Marks the image, so that any write of the parts shows. */
+    mqttsn_retained_t * p_image = image_get(MQTTSN_DEFAULT_CLIENT_PORT);
+
+    p_image->session.checksum  ^= 1;
+    p_image->deferred.checksum ^= 1;
+    memcpy(&saved, p_image, sizeof(saved));
+
+    receive(&m_client, pingresp, sizeof(pingresp));
+    CHECK(memcmp(&saved, p_image, sizeof(saved)) == 0);
+
+    CHECK(mqttsn_client_publish(&m_client, m_topic_id, payload, sizeof(payload) - 1, NULL) == NRF_SUCCESS);
+    CHECK(p_image->in_flight.num_of_elements == 1);
+    CHECK(memcmp(&saved.session, &p_image->session, sizeof(saved.session)) == 0);
+    CHECK(memcmp(&saved.deferred, &p_image->deferred, sizeof(saved.deferred)) == 0);
+
+    CHECK(mqttsn_client_uninit(&m_client) == NRF_SUCCESS);
+}
+
+/**@brief Checks that images are keyed to the port of the client. */
+static void test_image_keyed_to_port(void)
+{
+    static const uint8_t payload[] = "z";
+
+    CHECK(mqttsn_client_init(&m_client, MQTTSN_DEFAULT_CLIENT_PORT, evt_handler, NULL) == NRF_SUCCESS);
+    client_connect(&m_client, 1);
+    topic_register(&m_client);
+
+    m_client.client_state = MQTTSN_CLIENT_DISCONNECTED;
+    CHECK(mqttsn_client_publish(&m_client, m_topic_id, payload, sizeof(payload) - 1, NULL) == NRF_SUCCESS);
+
+    /* After reset, a client bound to another port does not take over the state. */
+    reset(&m_client, OTHER_CLIENT_PORT);
+
+    CHECK(m_client.deferred_queue.num_of_elements == 0);
+    CHECK(m_client.message_id == 0);
+
+    CHECK(mqttsn_client_uninit(&m_client) == NRF_SUCCESS);
+
+    /* A released image is taken by the next client. */
+    CHECK(mqttsn_client_init(&m_other_client, OTHER_CLIENT_PORT, evt_handler, NULL) == NRF_SUCCESS);
+    CHECK(mqttsn_client_uninit(&m_other_client) == NRF_SUCCESS);
+}
+
+/**@brief Checks that a client initialized after every image is taken runs without one. */
+static void test_clients_beyond_images(void)
+{
+    static const uint8_t payload[] = "w";
+
+    CHECK(mqttsn_client_init(&m_client, MQTTSN_DEFAULT_CLIENT_PORT, evt_handler, NULL) == NRF_SUCCESS);
+    CHECK(mqttsn_client_init(&m_other_client, OTHER_CLIENT_PORT, evt_handler, NULL) == NRF_SUCCESS);
+
+    client_connect(&m_client, 1);
+    topic_register(&m_client);
+    client_connect(&m_other_client, 1);
+    topic_register(&m_other_client);
+
+    m_client.client_state       = MQTTSN_CLIENT_DISCONNECTED;
+    m_other_client.client_state = MQTTSN_CLIENT_DISCONNECTED;
+    CHECK(mqttsn_client_publish(&m_client, m_topic_id, payload, sizeof(payload) - 1, NULL) == NRF_SUCCESS);
+    CHECK(mqttsn_client_publish(&m_other_client, m_topic_id, payload, sizeof(payload) - 1, NULL) == NRF_SUCCESS);
+
+    /* The first client keeps its state, the second one only if there is an image left for it. */
+    reset(&m_client, MQTTSN_DEFAULT_CLIENT_PORT);
+    reset(&m_other_client, OTHER_CLIENT_PORT);
+
+    CHECK(m_client.deferred_queue.num_of_elements == 1);
+    CHECK(m_other_client.deferred_queue.num_of_elements == (MQTTSN_RETAINED_MAX_CLIENTS > 1 ? 1 : 0));
+
+    CHECK(mqttsn_client_uninit(&m_other_client) == NRF_SUCCESS);
+    CHECK(mqttsn_client_uninit(&m_client) == NRF_SUCCESS);
+}
+
+int main(void)
+{
+    mqttsn_platform_posix_clock_set(MQTTSN_PLATFORM_POSIX_CLOCK_VIRTUAL, 1000);
+    mqttsn_transport_host_caps_set(MQTTSN_TRANSPORT_CAP_POINT_TO_POINT);
+    mqttsn_transport_host_write_handler_set(write_handler);
+
+    test_publications_restored();
+    test_corrupted_image_ignored();
+    test_unchanged_state_not_saved();
+    test_image_keyed_to_port();
+    test_clients_beyond_images();
+
+    printf("ok\n");
+
+    return 0;
+}
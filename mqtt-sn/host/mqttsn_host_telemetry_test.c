@@ -0,0 +1,235 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+
+/**@file mqttsn_host_telemetry_test.c
+ *
+ * @brief Test of the telemetry record encoding.
+ *
+ * @details Fields are checked against their expected bytes at the limits of each encoding, and
+ *          decoded back. The test fails with the line of the first failed check.
+ */
+
+#include "mqttsn_telemetry.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(EXPR)                                                                                \
+    if (!(EXPR))                                                                                   \
+    {                                                                                              \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #EXPR);                            \
+        exit(1);                                                                                   \
+    }
+
+/**@brief Fractional bits of the fixed-point fields tested. */
+#define FIXED16_FRAC_BITS     8
+
+/**@brief Number of samples of the series tested. */
+#define SERIES_LENGTH         5
+
+/**@brief Encodes a single field and checks it against the expected bytes, then decodes it back.
+ *
+ * @param[in]    type        Field encoding.
+ * @param[in]    value       Value.
+ * @param[in]    p_expected  Expected encoding.
+ * @param[in]    len         Length of the expected encoding.
+ *
+ * @return       Decoded value.
+ */
+static mqttsn_telemetry_value_t field_check(mqttsn_telemetry_field_type_t  type,
+                                            mqttsn_telemetry_value_t       value,
+                                            const uint8_t                * p_expected,
+                                            uint16_t                       len)
+{
+    const mqttsn_telemetry_field_t  field  = { .type = type, .frac_bits = FIXED16_FRAC_BITS };
+    const mqttsn_telemetry_schema_t schema = { .p_fields = &field, .field_cnt = 1 };
+    mqttsn_telemetry_value_t        decoded;
+    uint8_t                         buf[MQTTSN_TELEMETRY_FIELD_MAX_LENGTH];
+
+    CHECK(mqttsn_telemetry_encode(&schema, &value, buf, sizeof(buf)) == len);
+    CHECK(memcmp(buf, p_expected, len) == 0);
+
+    /* A buffer one byte short does not take the field. */
+    CHECK(mqttsn_telemetry_encode(&schema, &value, buf, len - 1) == 0);
+
+    CHECK(mqttsn_telemetry_decode(&schema, buf, len, &decoded) == len);
+
+    return decoded;
+}
+
+/**@brief Decodes a single unsigned varint field. */
+static uint16_t uvarint_decode(const uint8_t * p_buf, uint16_t buflen, uint32_t * p_value)
+{
+    const mqttsn_telemetry_field_t  field  = { .type = MQTTSN_TELEMETRY_FIELD_UVARINT };
+    const mqttsn_telemetry_schema_t schema = { .p_fields = &field, .field_cnt = 1 };
+    mqttsn_telemetry_value_t        value;
+    uint16_t                        len    = mqttsn_telemetry_decode(&schema, p_buf, buflen, &value);
+
+    *p_value = value.u;
+
+    return len;
+}
+
+/**@brief Checks unsigned varints at the limits of each length, and malformed ones. */
+static void test_varint_limits(void)
+{
+    static const uint8_t zero[]       = { 0x00 };
+    static const uint8_t one_byte[]   = { 0x7F };
+    static const uint8_t two_bytes[]  = { 0x80, 0x01 };
+    static const uint8_t four_bytes[] = { 0xFF, 0xFF, 0xFF, 0x7F };
+    static const uint8_t max[]        = { 0xFF, 0xFF, 0xFF, 0xFF, 0x0F };
+    static const uint8_t too_wide[]   = { 0xFF, 0xFF, 0xFF, 0xFF, 0x1F };
+    static const uint8_t too_long[]   = { 0x80, 0x80, 0x80, 0x80, 0x80, 0x00 };
+    mqttsn_telemetry_value_t value;
+    uint32_t                 decoded;
+
+    value.u = 0;
+    CHECK(field_check(MQTTSN_TELEMETRY_FIELD_UVARINT, value, zero, sizeof(zero)).u == 0);
+    value.u = 127;
+    CHECK(field_check(MQTTSN_TELEMETRY_FIELD_UVARINT, value, one_byte, sizeof(one_byte)).u == 127);
+    value.u = 128;
+    CHECK(field_check(MQTTSN_TELEMETRY_FIELD_UVARINT, value, two_bytes, sizeof(two_bytes)).u == 128);
+    value.u = (1UL << 28) - 1;
+    CHECK(field_check(MQTTSN_TELEMETRY_FIELD_UVARINT, value, four_bytes, sizeof(four_bytes)).u == (1UL << 28) - 1);
+    value.u = UINT32_MAX;
+    CHECK(field_check(MQTTSN_TELEMETRY_FIELD_UVARINT, value, max, sizeof(max)).u == UINT32_MAX);
+
+    /* Values past 32 bits, varints past 5 bytes and truncated ones are refused. */
+    CHECK(uvarint_decode(too_wide, sizeof(too_wide), &decoded) == 0);
+    CHECK(uvarint_decode(too_long, sizeof(too_long), &decoded) == 0);
+    CHECK(uvarint_decode(two_bytes, 1, &decoded) == 0);
+}
+
+/**@brief Checks zig-zag mapped varints of small magnitudes and of the limits of int32_t. */
+static void test_zigzag_limits(void)
+{
+    static const uint8_t minus_one[] = { 0x01 };
+    static const uint8_t plus_one[]  = { 0x02 };
+    static const uint8_t max[]       = { 0xFE, 0xFF, 0xFF, 0xFF, 0x0F };
+    static const uint8_t min[]       = { 0xFF, 0xFF, 0xFF, 0xFF, 0x0F };
+    mqttsn_telemetry_value_t value;
+
+    value.s = -1;
+    CHECK(field_check(MQTTSN_TELEMETRY_FIELD_SVARINT, value, minus_one, sizeof(minus_one)).s == -1);
+    value.s = 1;
+    CHECK(field_check(MQTTSN_TELEMETRY_FIELD_SVARINT, value, plus_one, sizeof(plus_one)).s == 1);
+    value.s = INT32_MAX;
+    CHECK(field_check(MQTTSN_TELEMETRY_FIELD_SVARINT, value, max, sizeof(max)).s == INT32_MAX);
+    value.s = INT32_MIN;
+    CHECK(field_check(MQTTSN_TELEMETRY_FIELD_SVARINT, value, min, sizeof(min)).s == INT32_MIN);
+}
+
+/**@brief Checks fixed-point rounding and saturation. */
+static void test_fixed16_saturation(void)
+{
+    static const uint8_t plus[]     = { 0x01, 0x80 };
+    static const uint8_t minus[]    = { 0xFE, 0x80 };
+    static const uint8_t rounded[]  = { 0x00, 0x01 };
+    static const uint8_t max[]      = { 0x7F, 0xFF };
+    static const uint8_t min[]      = { 0x80, 0x00 };
+    mqttsn_telemetry_value_t value;
+
+    value.f = 1.5f;
+    CHECK(field_check(MQTTSN_TELEMETRY_FIELD_FIXED16, value, plus, sizeof(plus)).f == 1.5f);
+    value.f = -1.5f;
+    CHECK(field_check(MQTTSN_TELEMETRY_FIELD_FIXED16, value, minus, sizeof(minus)).f == -1.5f);
+
+    /* Rounded to the nearest step of 1/256. */
+    value.f = 0.6f / 256.0f;
+    CHECK(field_check(MQTTSN_TELEMETRY_FIELD_FIXED16, value, rounded, sizeof(rounded)).f == 1.0f / 256.0f);
+
+    /* Out of range values saturate instead of wrapping around. */
+    value.f = 1000.0f;
+    CHECK(field_check(MQTTSN_TELEMETRY_FIELD_FIXED16, value, max, sizeof(max)).f == 32767.0f / 256.0f);
+    value.f = -1000.0f;
+    CHECK(field_check(MQTTSN_TELEMETRY_FIELD_FIXED16, value, min, sizeof(min)).f == -128.0f);
+}
+
+/**@brief Checks that series deltas between samples far apart wrap around and decode losslessly. */
+static void test_series_wrapping_deltas(void)
+{
+    static const int32_t samples[SERIES_LENGTH] = { INT32_MAX, INT32_MIN, 0, -1, 1 };
+
+    /* INT32_MAX, then +1 wrapped, INT32_MIN wrapped, -1 and +2. */
+    static const uint8_t expected[] =
+    {
+        0xFE, 0xFF, 0xFF, 0xFF, 0x0F,
+        0x02,
+        0xFF, 0xFF, 0xFF, 0xFF, 0x0F,
+        0x01,
+        0x04
+    };
+
+    int32_t decoded[SERIES_LENGTH];
+    uint8_t buf[sizeof(expected)];
+
+    CHECK(mqttsn_telemetry_series_encode(samples, SERIES_LENGTH, buf, sizeof(buf)) == sizeof(expected));
+    CHECK(memcmp(buf, expected, sizeof(expected)) == 0);
+    CHECK(mqttsn_telemetry_series_encode(samples, SERIES_LENGTH, buf, sizeof(buf) - 1) == 0);
+
+    CHECK(mqttsn_telemetry_series_decode(buf, sizeof(buf), decoded, SERIES_LENGTH) == SERIES_LENGTH);
+    CHECK(memcmp(decoded, samples, sizeof(samples)) == 0);
+
+    /* A series longer than the room given, or ending in a truncated varint, is refused. */
+    CHECK(mqttsn_telemetry_series_decode(buf, sizeof(buf), decoded, SERIES_LENGTH - 1) == 0);
+    CHECK(mqttsn_telemetry_series_decode(buf, 4, decoded, SERIES_LENGTH) == 0);
+}
+
+/**@brief Checks that samples within the deadband are suppressed, at most max_suppressed in a row. */
+static void test_deadband_max_suppressed(void)
+{
+    mqttsn_telemetry_deadband_t deadband;
+
+    memset(&deadband, 0, sizeof(deadband));
+    deadband.deadband       = 2;
+    deadband.max_suppressed = 3;
+
+    CHECK(mqttsn_telemetry_deadband_check(&deadband, 10));
+    CHECK(!mqttsn_telemetry_deadband_check(&deadband, 12));
+    CHECK(!mqttsn_telemetry_deadband_check(&deadband, 8));
+    CHECK(!mqttsn_telemetry_deadband_check(&deadband, 11));
+
+    /* The fourth sample in a row is reported anyway, and becomes the reference. */
+    CHECK(mqttsn_telemetry_deadband_check(&deadband, 11));
+    CHECK(!mqttsn_telemetry_deadband_check(&deadband, 13));
+    CHECK(mqttsn_telemetry_deadband_check(&deadband, 14));
+
+    /* The change between the limits of int32_t does not overflow. */
+    CHECK(mqttsn_telemetry_deadband_check(&deadband, INT32_MIN));
+    CHECK(mqttsn_telemetry_deadband_check(&deadband, INT32_MAX));
+
+    /* Without a limit, samples within the deadband are never reported. */
+    memset(&deadband, 0, sizeof(deadband));
+    deadband.deadband = 2;
+
+    CHECK(mqttsn_telemetry_deadband_check(&deadband, 0));
+
+    for (uint32_t i = 0; i < UINT16_MAX + 2UL; i++)
+    {
+        CHECK(!mqttsn_telemetry_deadband_check(&deadband, 1));
+    }
+}
+
+int main(void)
+{
+    test_varint_limits();
+    test_zigzag_limits();
+    test_fixed16_saturation();
+    test_series_wrapping_deltas();
+    test_deadband_max_suppressed();
+
+    printf("ok\n");
+
+    return 0;
+}
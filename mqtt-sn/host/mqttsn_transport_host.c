@@ -0,0 +1,110 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "mqttsn_transport_host.h"
+#include "mqttsn_packet_internal.h"
+#include "app_util.h"
+
+#define NULL_PARAM_CHECK(PARAM)                                                                    \
+    if ((PARAM) == NULL)                                                                           \
+    {                                                                                              \
+        return (NRF_ERROR_NULL);                                                                   \
+    }
+
+/**@brief Handler of written frames. */
+static mqttsn_transport_host_write_handler_t m_write_handler;
+
+/**@brief Capabilities reported to the client. */
+static uint32_t m_caps;
+
+void mqttsn_transport_host_write_handler_set(mqttsn_transport_host_write_handler_t handler)
+{
+    m_write_handler = handler;
+}
+
+void mqttsn_transport_host_caps_set(uint32_t caps)
+{
+    m_caps = caps;
+}
+
+uint32_t mqttsn_transport_init(mqttsn_client_t * p_client, uint16_t port, const void * p_context)
+{
+    UNUSED_PARAMETER(port);
+    UNUSED_PARAMETER(p_context);
+
+    p_client->transport.p_handle = NULL;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t mqttsn_transport_write(mqttsn_client_t       * p_client,
+                                const mqttsn_remote_t * p_remote,
+                                const uint8_t         * p_data,
+                                uint16_t                datalen)
+{
+    NULL_PARAM_CHECK(p_remote);
+    NULL_PARAM_CHECK(p_data);
+
+    if (m_write_handler == NULL)
+    {
+        return NRF_SUCCESS;
+    }
+
+    return m_write_handler(p_client, p_data, datalen);
+}
+
+uint32_t mqttsn_transport_writev(mqttsn_client_t       * p_client,
+                                 const mqttsn_remote_t * p_remote,
+                                 const mqttsn_iovec_t  * p_iov,
+                                 uint8_t                 iovcnt)
+{
+    uint8_t  frame[MQTTSN_TRANSPORT_HOST_FRAME_MAX_LENGTH];
+    uint16_t len = 0;
+
+    NULL_PARAM_CHECK(p_iov);
+
+    for (uint8_t i = 0; i < iovcnt; i++)
+    {
+        if (p_iov[i].len > sizeof(frame) - len)
+        {
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+
+        memcpy(&frame[len], p_iov[i].p_data, p_iov[i].len);
+        len += p_iov[i].len;
+    }
+
+    return mqttsn_transport_write(p_client, p_remote, frame, len);
+}
+
+uint32_t mqttsn_transport_read(void                  * p_context,
+                               const mqttsn_port_t   * p_port,
+                               const mqttsn_remote_t * p_remote,
+                               const uint8_t         * p_data,
+                               uint16_t                datalen)
+{
+    return mqttsn_packet_receiver((mqttsn_client_t *)p_context, p_port, p_remote, p_data, datalen);
+}
+
+uint32_t mqttsn_transport_caps_get(const mqttsn_client_t * p_client)
+{
+    UNUSED_PARAMETER(p_client);
+
+    return m_caps;
+}
+
+uint32_t mqttsn_transport_uninit(mqttsn_client_t * p_client)
+{
+    UNUSED_PARAMETER(p_client);
+
+    return NRF_SUCCESS;
+}
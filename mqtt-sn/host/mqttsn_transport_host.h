@@ -0,0 +1,56 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/**@file mqttsn_transport_host.h
+ *
+ * @brief Loopback transport for host builds of the MQTT-SN client.
+ *
+ * @details Implements mqttsn_transport.h without a radio. Every frame the client writes is handed
+ *          to a handler set by the host program, which plays the gateway and feeds its answers
+ *          back through @ref mqttsn_transport_read.
+ */
+
+#ifndef MQTTSN_TRANSPORT_HOST_H
+#define MQTTSN_TRANSPORT_HOST_H
+
+#include <stdint.h>
+
+#include "mqttsn_transport.h"
+
+/**@brief Largest frame the loopback transport carries. */
+#define MQTTSN_TRANSPORT_HOST_FRAME_MAX_LENGTH 1024
+
+/**@brief Handler of frames written by a client.
+ *
+ * @param[inout] p_client    Client which has written the frame.
+ * @param[in]    p_data      Frame.
+ * @param[in]    datalen     Length of the frame.
+ *
+ * @return       Value returned to the client from the write call.
+ */
+typedef uint32_t (*mqttsn_transport_host_write_handler_t)(mqttsn_client_t * p_client,
+                                                          const uint8_t   * p_data,
+                                                          uint16_t          datalen);
+
+/**@brief Sets the handler of written frames. Frames are discarded while it is NULL.
+ *
+ * @param[in]    handler     Handler of written frames.
+ */
+void mqttsn_transport_host_write_handler_set(mqttsn_transport_host_write_handler_t handler);
+
+/**@brief Sets the capabilities reported by @ref mqttsn_transport_caps_get.
+ *
+ * @param[in]    caps        Bitmask of MQTTSN_TRANSPORT_CAP_* flags, 0 by default.
+ */
+void mqttsn_transport_host_caps_set(uint32_t caps);
+
+#endif // MQTTSN_TRANSPORT_HOST_H
@@ -0,0 +1,31 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/**@file app_util.h
+ *
+ * @brief Host stand-in for the nRF5 SDK utility macros used by the MQTT-SN client.
+ */
+
+#ifndef APP_UTIL_H__
+#define APP_UTIL_H__
+
+#define STATIC_ASSERT(EXPR)       _Static_assert((EXPR), #EXPR)
+
+#define UNUSED_VARIABLE(X)        ((void)(X))
+#define UNUSED_PARAMETER(X)       UNUSED_VARIABLE(X)
+
+#define ROUNDED_DIV(A, B)         (((A) + ((B) / 2)) / (B))
+#define CEIL_DIV(A, B)            (((A) + (B) - 1) / (B))
+
+#define ARRAY_SIZE(ARR)           (sizeof(ARR) / sizeof((ARR)[0]))
+
+#endif // APP_UTIL_H__
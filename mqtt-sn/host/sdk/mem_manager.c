@@ -0,0 +1,161 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "mem_manager.h"
+#include "nrf_error.h"
+
+#include <stdlib.h>
+
+#ifndef MEMORY_MANAGER_SMALL_BLOCK_COUNT
+#define MEMORY_MANAGER_SMALL_BLOCK_COUNT   0
+#define MEMORY_MANAGER_SMALL_BLOCK_SIZE    0
+#endif
+#ifndef MEMORY_MANAGER_MEDIUM_BLOCK_COUNT
+#define MEMORY_MANAGER_MEDIUM_BLOCK_COUNT  0
+#define MEMORY_MANAGER_MEDIUM_BLOCK_SIZE   0
+#endif
+#ifndef MEMORY_MANAGER_LARGE_BLOCK_COUNT
+#define MEMORY_MANAGER_LARGE_BLOCK_COUNT   0
+#define MEMORY_MANAGER_LARGE_BLOCK_SIZE    0
+#endif
+#ifndef MEMORY_MANAGER_XLARGE_BLOCK_COUNT
+#define MEMORY_MANAGER_XLARGE_BLOCK_COUNT  0
+#define MEMORY_MANAGER_XLARGE_BLOCK_SIZE   0
+#endif
+#ifndef MEMORY_MANAGER_XXLARGE_BLOCK_COUNT
+#define MEMORY_MANAGER_XXLARGE_BLOCK_COUNT 0
+#define MEMORY_MANAGER_XXLARGE_BLOCK_SIZE  0
+#endif
+
+/**@brief Total number of blocks. */
+#define BLOCK_COUNT (MEMORY_MANAGER_SMALL_BLOCK_COUNT  + MEMORY_MANAGER_MEDIUM_BLOCK_COUNT +         \
+                     MEMORY_MANAGER_LARGE_BLOCK_COUNT  + MEMORY_MANAGER_XLARGE_BLOCK_COUNT +         \
+                     MEMORY_MANAGER_XXLARGE_BLOCK_COUNT)
+
+/**@brief Block category, smallest first. */
+typedef struct
+{
+    uint32_t size;   /**< Size of the blocks. */
+    uint32_t count;  /**< Number of the blocks. */
+    uint32_t in_use; /**< Number of the blocks allocated. */
+} block_category_t;
+
+/**@brief Allocated block. */
+typedef struct
+{
+    void             * p_data;     /**< Allocated memory, NULL if the entry is unused. */
+    block_category_t * p_category; /**< Category the block belongs to. */
+} block_t;
+
+static block_category_t m_categories[] =
+{
+    { MEMORY_MANAGER_SMALL_BLOCK_SIZE,   MEMORY_MANAGER_SMALL_BLOCK_COUNT,   0 },
+    { MEMORY_MANAGER_MEDIUM_BLOCK_SIZE,  MEMORY_MANAGER_MEDIUM_BLOCK_COUNT,  0 },
+    { MEMORY_MANAGER_LARGE_BLOCK_SIZE,   MEMORY_MANAGER_LARGE_BLOCK_COUNT,   0 },
+    { MEMORY_MANAGER_XLARGE_BLOCK_SIZE,  MEMORY_MANAGER_XLARGE_BLOCK_COUNT,  0 },
+    { MEMORY_MANAGER_XXLARGE_BLOCK_SIZE, MEMORY_MANAGER_XXLARGE_BLOCK_COUNT, 0 },
+};
+
+static block_t m_blocks[BLOCK_COUNT];
+
+uint32_t nrf_mem_init(void)
+{
+    for (uint32_t i = 0; i < BLOCK_COUNT; i++)
+    {
+        free(m_blocks[i].p_data);
+        m_blocks[i].p_data = NULL;
+    }
+
+    for (uint32_t i = 0; i < sizeof(m_categories) / sizeof(m_categories[0]); i++)
+    {
+        m_categories[i].in_use = 0;
+    }
+
+    return NRF_SUCCESS;
+}
+
+void * nrf_malloc(uint32_t size)
+{
+    block_category_t * p_category = NULL;
+
+    if (size == 0)
+    {
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < sizeof(m_categories) / sizeof(m_categories[0]); i++)
+    {
+        if (m_categories[i].size >= size && m_categories[i].in_use < m_categories[i].count)
+        {
+            p_category = &m_categories[i];
+            break;
+        }
+    }
+
+    if (p_category == NULL)
+    {
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < BLOCK_COUNT; i++)
+    {
+        if (m_blocks[i].p_data == NULL)
+        {
+            m_blocks[i].p_data = malloc(size);
+            if (m_blocks[i].p_data == NULL)
+            {
+                return NULL;
+            }
+
+            m_blocks[i].p_category = p_category;
+            p_category->in_use++;
+
+            return m_blocks[i].p_data;
+        }
+    }
+
+    return NULL;
+}
+
+void nrf_free(void * p_buffer)
+{
+    if (p_buffer == NULL)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < BLOCK_COUNT; i++)
+    {
+        if (m_blocks[i].p_data == p_buffer)
+        {
+            free(p_buffer);
+            m_blocks[i].p_data = NULL;
+            m_blocks[i].p_category->in_use--;
+            return;
+        }
+    }
+
+    /* Freeing memory the manager does not own corrupts its pool on the device. */
+    abort();
+}
+
+uint32_t nrf_mem_host_in_use_get(void)
+{
+    uint32_t in_use = 0;
+
+    for (uint32_t i = 0; i < sizeof(m_categories) / sizeof(m_categories[0]); i++)
+    {
+        in_use += m_categories[i].in_use;
+    }
+
+    return in_use;
+}
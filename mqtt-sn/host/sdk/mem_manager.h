@@ -0,0 +1,57 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/**@file mem_manager.h
+ *
+ * @brief Host stand-in for the nRF5 SDK memory manager.
+ *
+ * @details Allocations are limited to the block sizes and counts configured in the application's
+ *          sdk_config.h, as on the device, so that a request no block can hold fails on the host
+ *          too. Each block is allocated from the heap at the requested size, so that
+ *          AddressSanitizer catches accesses past it.
+ */
+
+#ifndef MEM_MANAGER_H__
+#define MEM_MANAGER_H__
+
+#include <stdint.h>
+
+#include "app_util.h"
+#include "sdk_config.h"
+
+/**@brief Initializes the memory manager. Releases all blocks, as a reset does on the device.
+ *
+ * @retval NRF_SUCCESS Always.
+ */
+uint32_t nrf_mem_init(void);
+
+/**@brief Allocates the smallest free block which can hold the requested size.
+ *
+ * @param[in] size  Requested size in bytes.
+ *
+ * @return Pointer to the allocated memory, or NULL if size is 0 or no block can hold it.
+ */
+void * nrf_malloc(uint32_t size);
+
+/**@brief Frees a block allocated with @ref nrf_malloc.
+ *
+ * @param[in] p_buffer  Pointer to the allocated memory.
+ */
+void nrf_free(void * p_buffer);
+
+/**@brief Gets the number of blocks currently allocated.
+ *
+ * @return Number of allocated blocks.
+ */
+uint32_t nrf_mem_host_in_use_get(void);
+
+#endif // MEM_MANAGER_H__
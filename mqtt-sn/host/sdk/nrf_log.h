@@ -0,0 +1,48 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/**@file nrf_log.h
+ *
+ * @brief Host stand-in for the nRF5 SDK logger.
+ *
+ * @details Log calls compile to nothing, unless MQTTSN_HOST_LOG is defined to 1, in which case
+ *          errors and warnings are printed to stderr.
+ */
+
+#ifndef NRF_LOG_H_
+#define NRF_LOG_H_
+
+#ifndef MQTTSN_HOST_LOG
+#define MQTTSN_HOST_LOG 0
+#endif
+
+#if MQTTSN_HOST_LOG
+
+#include <stdio.h>
+
+#define NRF_LOG_ERROR(...)   fprintf(stderr, "<error> " __VA_ARGS__)
+#define NRF_LOG_WARNING(...) fprintf(stderr, "<warning> " __VA_ARGS__)
+
+#else
+
+#define NRF_LOG_ERROR(...)
+#define NRF_LOG_WARNING(...)
+
+#endif // MQTTSN_HOST_LOG
+
+#define NRF_LOG_INFO(...)
+#define NRF_LOG_DEBUG(...)
+#define NRF_LOG_RAW_INFO(...)
+#define NRF_LOG_HEXDUMP_INFO(p_data, len)
+#define NRF_LOG_HEXDUMP_DEBUG(p_data, len)
+
+#endif // NRF_LOG_H_
@@ -0,0 +1,200 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "mqttsn_packet_internal.h"
+
+/**@brief Length of the record length prefix. */
+#define RECORD_PREFIX_LENGTH 1
+
+/**@brief Gets the longest aggregated payload which fits a single transport frame.
+ *
+ * @param[in]    p_client    Pointer to initialized client.
+ *
+ * @return       Maximum payload length.
+ */
+static uint16_t payload_max_get(const mqttsn_client_t * p_client)
+{
+    /* Aggregated payloads are short enough for a one-byte Length field. */
+    uint16_t header_len  = MQTTSN_CODEC_PUBLISH_FIXED_LENGTH + 1;
+    uint16_t payload_max = MQTTSN_AGGREGATOR_PAYLOAD_MAX_LENGTH;
+
+    if (p_client->mtu <= header_len)
+    {
+        return 0;
+    }
+
+    if (p_client->mtu - header_len < payload_max)
+    {
+        payload_max = p_client->mtu - header_len;
+    }
+
+    /* Any publication may have to wait in the deferred queue, whose payloads also fit a single
+     * memory manager block, as the sender's copy has to. */
+    if (payload_max > MQTTSN_DEFERRED_PAYLOAD_MAX_LENGTH)
+    {
+        payload_max = MQTTSN_DEFERRED_PAYLOAD_MAX_LENGTH;
+    }
+
+    return payload_max;
+}
+
+/**@brief Publishes staged records and releases their slot.
+ *
+ * @details Records are kept for another attempt if they cannot be sent for lack of memory, which
+ *          acknowledgements free. They are dropped on any other error, which another attempt would
+ *          run into again.
+ *
+ * @param[inout] p_client    Pointer to initialized client.
+ * @param[inout] p_aggregate Aggregated publication.
+ *
+ * @return       NRF_SUCCESS if the publication has been sent or queued successfully.
+ *               Otherwise error code returned by @ref mqttsn_client_publish.
+ */
+static uint32_t aggregate_publish(mqttsn_client_t * p_client, mqttsn_aggregate_t * p_aggregate)
+{
+    uint32_t err_code = mqttsn_client_publish(p_client,
+                                              p_aggregate->topic_id,
+                                              p_aggregate->p_payload,
+                                              p_aggregate->payload_len,
+                                              NULL);
+
+    if (err_code == NRF_ERROR_NO_MEM)
+    {
+        p_aggregate->deadline = mqttsn_platform_timer_set_in_ms(MQTTSN_AGGREGATOR_LATENCY_MS);
+        return err_code;
+    }
+
+    if (err_code != NRF_SUCCESS)
+    {
+        NRF_LOG_ERROR("%d aggregated records dropped, error %d\r\n", p_aggregate->record_cnt, err_code);
+    }
+
+    memset(p_aggregate, 0, sizeof(mqttsn_aggregate_t));
+    p_aggregate->deadline = MQTTSN_CLOCK_DEADLINE_NONE;
+
+    return err_code;
+}
+
+void mqttsn_aggregator_init(mqttsn_client_t * p_client)
+{
+    memset(&(p_client->aggregator), 0, sizeof(mqttsn_aggregator_t));
+
+    for (int i = 0; i < MQTTSN_AGGREGATOR_MAX_LENGTH; i++)
+    {
+        p_client->aggregator.aggregate[i].deadline = MQTTSN_CLOCK_DEADLINE_NONE;
+    }
+}
+
+uint32_t mqttsn_aggregator_append(mqttsn_client_t * p_client,
+                                  uint16_t          topic_id,
+                                  const uint8_t   * p_record,
+                                  uint16_t          record_len)
+{
+    mqttsn_aggregate_t * p_aggregate = NULL;
+    uint16_t             payload_max = payload_max_get(p_client);
+
+    if (record_len == 0 || record_len > UINT8_MAX || RECORD_PREFIX_LENGTH + record_len > payload_max)
+    {
+        NRF_LOG_ERROR("Record too long to be aggregated\r\n");
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    for (int i = 0; i < MQTTSN_AGGREGATOR_MAX_LENGTH; i++)
+    {
+        mqttsn_aggregate_t * p_candidate = &(p_client->aggregator.aggregate[i]);
+
+        if (p_candidate->topic_id == topic_id)
+        {
+            p_aggregate = p_candidate;
+            break;
+        }
+
+        if (p_aggregate == NULL && p_candidate->topic_id == 0)
+        {
+            p_aggregate = p_candidate;
+        }
+    }
+
+    if (p_aggregate == NULL)
+    {
+        NRF_LOG_ERROR("Aggregator capacity exceeded\r\n");
+        return NRF_ERROR_NO_MEM;
+    }
+
+    /* Staged records are published to make room for a record they leave no room for. */
+    if (p_aggregate->payload_len + RECORD_PREFIX_LENGTH + record_len > payload_max)
+    {
+        uint32_t err_code = aggregate_publish(p_client, p_aggregate);
+
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
+    if (p_aggregate->record_cnt == 0)
+    {
+        p_aggregate->topic_id = topic_id;
+        p_aggregate->deadline = mqttsn_platform_timer_set_in_ms(MQTTSN_AGGREGATOR_LATENCY_MS);
+    }
+
+    p_aggregate->p_payload[p_aggregate->payload_len] = (uint8_t)record_len;
+    memcpy(&(p_aggregate->p_payload[p_aggregate->payload_len + RECORD_PREFIX_LENGTH]), p_record, record_len);
+    p_aggregate->payload_len += RECORD_PREFIX_LENGTH + record_len;
+    p_aggregate->record_cnt++;
+
+    if (p_aggregate->record_cnt >= MQTTSN_AGGREGATOR_RECORD_MAX_COUNT ||
+        p_aggregate->payload_len + RECORD_PREFIX_LENGTH + 1 > payload_max)
+    {
+        /* Retried at the deadline if memory is short now, dropped on other errors. */
+        (void)aggregate_publish(p_client, p_aggregate);
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t mqttsn_aggregator_flush(mqttsn_client_t * p_client, uint64_t now)
+{
+    uint32_t err_code = NRF_SUCCESS;
+
+    for (int i = 0; i < MQTTSN_AGGREGATOR_MAX_LENGTH; i++)
+    {
+        mqttsn_aggregate_t * p_aggregate = &(p_client->aggregator.aggregate[i]);
+
+        if (mqttsn_clock_deadline_passed(p_aggregate->deadline, now))
+        {
+            uint32_t publish_err_code = aggregate_publish(p_client, p_aggregate);
+
+            if (err_code == NRF_SUCCESS)
+            {
+                err_code = publish_err_code;
+            }
+        }
+    }
+
+    return err_code;
+}
+
+uint64_t mqttsn_aggregator_deadline_get(const mqttsn_client_t * p_client)
+{
+    uint64_t deadline = MQTTSN_CLOCK_DEADLINE_NONE;
+
+    for (int i = 0; i < MQTTSN_AGGREGATOR_MAX_LENGTH; i++)
+    {
+        if (p_client->aggregator.aggregate[i].deadline < deadline)
+        {
+            deadline = p_client->aggregator.aggregate[i].deadline;
+        }
+    }
+
+    return deadline;
+}
@@ -18,28 +18,12 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-/**@brief Next timer timeout value. */
-static uint32_t m_next_timeout = UINT32_MAX;
-
 #define NULL_PARAM_CHECK(PARAM)                                                                    \
     if ((PARAM) == NULL)                                                                           \
     {                                                                                              \
         return (NRF_ERROR_NULL);                                                                   \
     }
 
-/**@brief Checks if timer has already passed a scheduled event timeout.  
- *
- * @param[in]    timeout     Scheduled event timeout.
- * @param[in]    now         Current timer value.
- *
- * @retval       true        If the scheduled event timeout has passed.
- * @retval       false       Otherwise.
- */
-static inline bool is_earlier(uint32_t timeout, uint32_t now)
-{
-    return ((timeout - now) & mqttsn_platform_timer_resolution_get()) != 0;
-}
-
 /**@brief Checks if MQTT-SN client has been initialized. 
  *
  * @param[in]    p_client    Pointer to MQTT-SN client instance.
@@ -76,6 +60,18 @@ static inline bool is_asleep(mqttsn_client_t * p_client)
     return p_client->client_state == MQTTSN_CLIENT_ASLEEP;
 }
 
+/**@brief Checks if MQTT-SN client is awake between sleep periods. 
+ *
+ * @param[in]    p_client    Pointer to MQTT-SN client instance.
+ *
+ * @retval       true        If the client is awake.
+ * @retval       false       Otherwise.
+ */
+static inline bool is_awake(mqttsn_client_t * p_client)
+{
+    return p_client->client_state == MQTTSN_CLIENT_AWAKE;
+}
+
 /**@brief Checks if MQTT-SN client is disconnected.
  *
  * @param[in]    p_client    Pointer to MQTT-SN client instance.
@@ -128,6 +124,23 @@ static void connect_info_init(mqttsn_client_t * p_client, mqttsn_connect_opt_t *
     memcpy(p_client->connect_info.p_client_id, p_options->p_client_id, p_options->client_id_len);
 }
 
+/**@brief Switches to another gateway, as the current one has stopped answering.
+ *
+ * @param[in]    p_client    Pointer to MQTT-SN client instance.
+ *
+ * @retval       true        If the client is connecting to another gateway.
+ * @retval       false       If the client was not connected, or no other gateway is known.
+ */
+static bool gateway_switch(mqttsn_client_t * p_client)
+{
+    if (!is_connected(p_client) && !is_awake(p_client))
+    {
+        return false;
+    }
+
+    return mqttsn_failover_start(p_client) == NRF_SUCCESS;
+}
+
 /**@brief Attempts retransmission if retransmission limit has not been reached; otherwise throws event timeout. 
  *
  * @param[in]    p_client    Pointer to MQTT-SN client instance.
@@ -137,29 +150,37 @@ static void message_retransmission_attempt(mqttsn_client_t * p_client, uint8_t i
 {
     if (p_client->packet_queue.packet[index].retransmission_cnt == 0)
     {
+        /* The message is kept and resent to the new gateway. */
+        if (gateway_switch(p_client))
+        {
+            return;
+        }
+
         mqttsn_event_t evt = 
         {
             .event_id         = MQTTSN_EVENT_TIMEOUT,
             .event_data.error =
             {
                 .error    = MQTTSN_ERROR_TIMEOUT,
-                .msg_type = mqttsn_packet_msgtype_error_get(p_client->packet_queue.packet[index].p_data),
+                .msg_type = mqttsn_packet_msgtype_error_get(mqttsn_packet_data_get(&(p_client->packet_queue.packet[index]))),
                 .msg_id   = p_client->packet_queue.packet[index].id,
             },
         };
 
-        switch (mqttsn_packet_msgtype_error_get(p_client->packet_queue.packet[index].p_data))
+        switch (mqttsn_packet_msgtype_error_get(mqttsn_packet_data_get(&(p_client->packet_queue.packet[index]))))
         {
             case MQTTSN_PACKET_CONNACK:
-                mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_MSGTYPE_CONNECT, MQTTSN_MESSAGE_TYPE);
+                mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_CONNECT, MQTTSN_MESSAGE_TYPE);
+                /* The gateway no longer answers, so the next search must not select it again. */
+                mqttsn_gateway_table_remove(p_client, p_client->gateway_info.id);
                 break;
 
             case MQTTSN_PACKET_WILLTOPICUPD:
-                mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_MSGTYPE_WILLTOPICUPD, MQTTSN_MESSAGE_TYPE);
+                mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_WILLTOPICUPD, MQTTSN_MESSAGE_TYPE);
                 break;
 
             case MQTTSN_PACKET_WILLMSGUPD:
-                mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_MSGTYPE_WILLMSGUPD, MQTTSN_MESSAGE_TYPE);
+                mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_WILLMSGUPD, MQTTSN_MESSAGE_TYPE);
                 break;
 
             default:
@@ -177,8 +198,7 @@ static void message_retransmission_attempt(mqttsn_client_t * p_client, uint8_t i
             mqttsn_platform_timer_set_in_ms(MQTTSN_DEFAULT_RETRANSMISSION_TIME_IN_MS);
         mqttsn_packet_sender_retransmit(p_client,
                                         &(p_client->gateway_info.addr),
-                                        p_client->packet_queue.packet[index].p_data,
-                                        p_client->packet_queue.packet[index].len);
+                                        &(p_client->packet_queue.packet[index]));
     }
 }
 
@@ -191,6 +211,11 @@ static void keep_alive_transmission_attempt(mqttsn_client_t * p_client)
     /* Retransmission limit reached : throw retransmission timeout event to the application. */
     if (p_client->keep_alive.message.retransmission_cnt == 0)
     {
+        if (gateway_switch(p_client))
+        {
+            return;
+        }
+
         mqttsn_event_t evt =
         {
             .event_id = MQTTSN_EVENT_TIMEOUT,
@@ -201,25 +226,134 @@ static void keep_alive_transmission_attempt(mqttsn_client_t * p_client)
             },
         };
 
+        p_client->keep_alive.timeout = MQTTSN_CLOCK_DEADLINE_NONE;
         p_client->evt_handler(p_client, &evt);
     }
     /* Usual procedure : set timer for retransmission. Receiving response will postpone timeout. */
     else if (p_client->keep_alive.response_arrived == 0)
     {
-        if (p_client->client_state == MQTTSN_CLIENT_ASLEEP)
-        {
-            mqttsn_event_t evt = { .event_id = MQTTSN_EVENT_SLEEP_STOP };
-            p_client->evt_handler(p_client, &evt);
-        }
         --(p_client->keep_alive.message.retransmission_cnt);
         p_client->keep_alive.timeout = mqttsn_platform_timer_set_in_ms(MQTTSN_DEFAULT_RETRANSMISSION_TIME_IN_MS);
         mqttsn_packet_sender_retransmit(p_client,
                                         &(p_client->gateway_info.addr),
-                                        p_client->keep_alive.message.p_data,
-                                        p_client->keep_alive.message.len);
+                                        &(p_client->keep_alive.message));
+    }
+}
+
+/**@brief Wakes the client from sleep to exchange buffered messages with the gateway.
+ *
+ * @details PINGREQ is sent first, as the gateway considers the client asleep until it arrives.
+ *          Queued publications follow. The gateway then delivers buffered messages and closes the
+ *          wake window with PINGRESP. The client goes back to sleep once PINGRESP has arrived and
+ *          its publications are acknowledged.
+ *
+ * @param[in]    p_client    Pointer to MQTT-SN client instance.
+ */
+static void client_wake(mqttsn_client_t * p_client)
+{
+    mqttsn_event_t evt = { .event_id = MQTTSN_EVENT_SLEEP_STOP };
+
+    p_client->client_state                          = MQTTSN_CLIENT_AWAKE;
+    p_client->keep_alive.response_arrived           = 0;
+    p_client->keep_alive.message.retransmission_cnt = MQTTSN_DEFAULT_RETRANSMISSION_CNT + 1;
+    p_client->evt_handler(p_client, &evt);
+
+    keep_alive_transmission_attempt(p_client);
+    mqttsn_client_deferred_process(p_client);
+    mqttsn_client_timer_reschedule(p_client);
+}
+
+/**@brief Checks if the packet queue has a slot for a publication of a given priority class.
+ *
+ * @param[in]    p_client    Pointer to MQTT-SN client instance.
+ * @param[in]    priority    Priority class of the publication.
+ *
+ * @retval       true        If the publication can be sent.
+ * @retval       false       If the slots it may use await acknowledgement.
+ */
+static bool packet_queue_has_room(const mqttsn_client_t * p_client, mqttsn_priority_t priority)
+{
+    uint8_t limit = MQTTSN_PACKET_FIFO_MAX_LENGTH;
+
+    if (priority != MQTTSN_PRIORITY_HIGH)
+    {
+        limit -= MQTTSN_PACKET_FIFO_RESERVED_LENGTH;
     }
+
+    return p_client->packet_queue.num_of_elements < limit;
 }
 
+/**@brief Finds the first held back publication to a topic registered with the current gateway.
+ *
+ * @param[in]    p_client    Pointer to MQTT-SN client instance.
+ * @param[out]   p_position  Position of the publication in the deferred queue.
+ *
+ * @return       Pointer to the publication, or NULL if there is none.
+ */
+static mqttsn_deferred_publish_t * deferred_queue_sendable_find(mqttsn_client_t * p_client, uint8_t * p_position)
+{
+    mqttsn_deferred_publish_t * p_publish;
+
+    for (uint8_t i = 0; (p_publish = mqttsn_deferred_queue_elem_get(p_client, i)) != NULL; i++)
+    {
+        if (mqttsn_topic_table_is_registered(p_client, p_publish->topic_id))
+        {
+            *p_position = i;
+            return p_publish;
+        }
+    }
+
+    return NULL;
+}
+
+/**@brief Sends held back publications the packet queue has room for, in order.
+ *
+ * @details Publications to a topic not registered with the current gateway yet are skipped and
+ *          stay queued, so a topic waiting for REGACK does not hold back the others. Publications
+ *          to the same topic are still sent in order. Stops at the configured rate limit, in which
+ *          case the rest is sent from the timer. High priority publications are not rate limited.
+ *
+ * @param[in]    p_client    Pointer to MQTT-SN client instance.
+ */
+static void deferred_queue_flush(mqttsn_client_t * p_client)
+{
+    mqttsn_deferred_queue_t   * p_queue = &(p_client->deferred_queue);
+    mqttsn_deferred_publish_t * p_publish;
+    uint8_t                     position = 0;
+
+    p_queue->replay_timeout = MQTTSN_CLOCK_DEADLINE_NONE;
+
+    while ((p_publish = deferred_queue_sendable_find(p_client, &position)) != NULL &&
+           packet_queue_has_room(p_client, p_publish->priority))
+    {
+        uint64_t now = mqttsn_platform_time_ms_get();
+
+        if (p_publish->priority != MQTTSN_PRIORITY_HIGH &&
+            p_queue->replay_interval != 0                &&
+            p_queue->replay_last != MQTTSN_CLOCK_DEADLINE_NONE)
+        {
+            uint64_t next_replay = mqttsn_clock_deadline_get(p_queue->replay_last, p_queue->replay_interval);
+
+            if (!mqttsn_clock_deadline_passed(next_replay, now))
+            {
+                p_queue->replay_timeout = next_replay;
+                mqttsn_client_timer_reschedule(p_client);
+                return;
+            }
+        }
+
+        mqttsn_topic_t topic = { .topic_id = mqttsn_topic_table_gateway_id_get(p_client, p_publish->topic_id) };
+
+        if (mqttsn_packet_sender_publish(p_client, &topic, p_publish->p_payload, p_publish->payload_len) != NRF_SUCCESS)
+        {
+            /* Out of memory. Retried when the next acknowledgement frees a packet. */
+            return;
+        }
+
+        mqttsn_deferred_queue_elem_drop(p_client, position);
+        p_queue->replay_last = now;
+    }
+}
 
 // Removed Thread dependency
 
@@ -232,15 +366,33 @@ uint32_t mqttsn_client_init(mqttsn_client_t           * p_client,
     NULL_PARAM_CHECK(evt_handler);
     //NULL_PARAM_CHECK(p_transport_context);
 
+    static bool mem_initialized = false;
+
     uint32_t err_code = NRF_SUCCESS;
     mqttsn_packet_fifo_init(p_client);
-
-    if (nrf_mem_init()!= NRF_SUCCESS)
+    mqttsn_deferred_queue_init(p_client);
+    mqttsn_aggregator_init(p_client);
+    mqttsn_delivery_queue_init(p_client);
+    mqttsn_gateway_table_init(p_client);
+    mqttsn_topic_table_init(p_client);
+    mqttsn_failover_init(p_client);
+    memset(&(p_client->rx_stats), 0, sizeof(mqttsn_rx_stats_t));
+
+    /* Memory manager is shared between all client instances. */
+    if (!mem_initialized)
     {
-        NRF_LOG_ERROR("Memory manager failed to initialize\r\n");
-        return NRF_ERROR_INTERNAL;
+        if (nrf_mem_init()!= NRF_SUCCESS)
+        {
+            NRF_LOG_ERROR("Memory manager failed to initialize\r\n");
+            return NRF_ERROR_INTERNAL;
+        }
+
+        mem_initialized = true;
     }
 
+    /* Publications survive a soft reset, the session state with them. */
+    mqttsn_retained_init(p_client, port);
+
     
     if (mqttsn_transport_init(p_client, port, p_transport_context) != NRF_SUCCESS)
     {
@@ -255,7 +407,16 @@ uint32_t mqttsn_client_init(mqttsn_client_t           * p_client,
         return NRF_ERROR_INTERNAL;
     }
 
-    p_client->client_state = MQTTSN_CLIENT_DISCONNECTED;
+    if (mqttsn_platform_timer_init(p_client) != NRF_SUCCESS)
+    {
+        NRF_LOG_ERROR("Platform timer failed to initialize\r\n");
+        return NRF_ERROR_INTERNAL;
+    }
+
+    p_client->next_timeout       = MQTTSN_CLOCK_DEADLINE_NONE;
+    p_client->keep_alive.timeout = MQTTSN_CLOCK_DEADLINE_NONE;
+    p_client->client_state       = MQTTSN_CLIENT_DISCONNECTED;
+    p_client->mtu                = MQTTSN_DEFAULT_MTU;
     p_client->evt_handler  = evt_handler;
 
     return err_code;
@@ -269,15 +430,34 @@ uint32_t mqttsn_client_search_gateway(mqttsn_client_t * p_client)
     {
         return NRF_ERROR_FORBIDDEN;
     }
-/*
-    if (!is_disconnected(p_client))
+
+    /* Selecting a gateway restarts the connection procedure. */
+    if (p_client->client_state != MQTTSN_CLIENT_DISCONNECTED &&
+        p_client->client_state != MQTTSN_CLIENT_SEARCHING_GATEWAY)
     {
         return NRF_ERROR_INVALID_STATE;
     }
-*/
+
+    /* The only peer of a point-to-point link is the gateway. Broadcasting SEARCHGW after a random
+     * delay would only put off CONNECT message. */
+    if (mqttsn_transport_caps_get(p_client) & MQTTSN_TRANSPORT_CAP_POINT_TO_POINT)
+    {
+        mqttsn_client_gateway_select(p_client, &(p_client->gateway_info));
+        return NRF_SUCCESS;
+    }
+
+    const mqttsn_gateway_entry_t * p_gateway = mqttsn_gateway_table_best_get(p_client,
+                                                                             mqttsn_platform_time_ms_get());
+    if (p_gateway != NULL)
+    {
+        mqttsn_client_gateway_select(p_client, &(p_gateway->info));
+        return NRF_SUCCESS;
+    }
 
     uint16_t rnd_jitter = mqttsn_platform_rand(MQTTSN_SEARCH_GATEWAY_MAX_DELAY_IN_MS);
-    mqttsn_platform_timer_start(p_client, mqttsn_platform_timer_set_in_ms(rnd_jitter));
+    mqttsn_platform_timer_stop(p_client);
+    p_client->next_timeout = mqttsn_platform_timer_set_in_ms(rnd_jitter);
+    mqttsn_platform_timer_start(p_client, rnd_jitter);
     p_client->client_state = MQTTSN_CLIENT_SEARCHING_GATEWAY;
 
     return NRF_SUCCESS;
@@ -310,15 +490,22 @@ uint32_t mqttsn_client_connect(mqttsn_client_t      * p_client,
         return NRF_ERROR_INVALID_STATE;
     }
 
-    memset(&(p_client->gateway_info.addr), 0, sizeof(p_client->gateway_info.addr));
-    // TODO: Fix for p_remote (that originally was an argument in function call) so it can handle both BLE and thread
-    //memcpy(&(p_client->gateway_info.addr), p_remote, sizeof(p_client->gateway_info.addr));  
-
     connect_info_init(p_client, p_options);
 
+    /* A clean session drops topic registrations. Publications to remembered topics are held back
+     * until the application registers them again. */
+    if (p_options->clean_session)
+    {
+        mqttsn_topic_table_registrations_clear(p_client);
+    }
+
     p_client->client_state = MQTTSN_CLIENT_ESTABLISHING_CONNECTION;
 
-    return mqttsn_packet_sender_connect(p_client);
+    uint32_t err_code = mqttsn_packet_sender_connect(p_client);
+
+    mqttsn_retained_save(p_client);
+
+    return err_code;
 }
 
 uint32_t mqttsn_client_disconnect(mqttsn_client_t * p_client)
@@ -345,11 +532,100 @@ uint32_t mqttsn_client_sleep(mqttsn_client_t * p_client, uint16_t polling_time)
     return mqttsn_packet_sender_disconnect(p_client, polling_time);
 }
 
+/**@brief Sends a publication, or queues it if it cannot be sent now.
+ *
+ * @param[inout] p_client    Pointer to initialized client.
+ * @param[in]    topic_id    Topic ID known to the application.
+ * @param[in]    p_payload   Payload.
+ * @param[in]    payload_len Length of the payload.
+ * @param[in]    priority    Priority class of the publication.
+ * @param[out]   p_msg_id    Message ID of the publication, 0 if it has been queued. May be NULL.
+ *
+ * @return       NRF_SUCCESS if the publication has been sent or queued successfully.
+ *               Otherwise error code is returned.
+ */
+static uint32_t publish_send_or_defer(mqttsn_client_t * p_client,
+                                      uint16_t          topic_id,
+                                      const uint8_t   * p_payload,
+                                      uint16_t          payload_len,
+                                      mqttsn_priority_t priority,
+                                      uint16_t        * p_msg_id)
+{
+    /* Only publications of the same or higher priority have to be sent first. Those to topics
+     * not registered yet do not, as they wait for REGACK. */
+    uint8_t                           position = 0;
+    const mqttsn_deferred_publish_t * p_ahead  = deferred_queue_sendable_find(p_client, &position);
+
+    if ((!is_connected(p_client) && !is_awake(p_client))          ||
+        p_client->failover.in_progress                             ||
+        (p_ahead != NULL && p_ahead->priority >= priority)         ||
+        !packet_queue_has_room(p_client, priority)                 ||
+        !mqttsn_topic_table_is_registered(p_client, topic_id))
+    {
+        uint32_t err_code = mqttsn_deferred_queue_elem_add(p_client, topic_id, p_payload, payload_len, priority);
+
+        if (p_msg_id)
+        {
+            *p_msg_id = 0;
+        }
+
+        if (err_code == NRF_SUCCESS && is_asleep(p_client) &&
+            (mqttsn_deferred_queue_is_full(p_client) || priority == MQTTSN_PRIORITY_HIGH))
+        {
+            client_wake(p_client);
+        }
+        else if (err_code == NRF_SUCCESS && (is_connected(p_client) || is_awake(p_client)))
+        {
+            deferred_queue_flush(p_client);
+        }
+
+        return err_code;
+    }
+
+    mqttsn_topic_t topic = { .topic_id = mqttsn_topic_table_gateway_id_get(p_client, topic_id) };
+
+    uint32_t err_code = mqttsn_packet_sender_publish(p_client, &topic, p_payload, payload_len);
+    if (err_code != NRF_SUCCESS &&
+        mqttsn_deferred_queue_elem_add(p_client, topic_id, p_payload, payload_len, priority) == NRF_SUCCESS)
+    {
+        /* The link is down or out of memory. Sent when the next acknowledgement or reconnection
+         * makes room. */
+        if (p_msg_id)
+        {
+            *p_msg_id = 0;
+        }
+
+        return NRF_SUCCESS;
+    }
+
+    if (p_msg_id)
+    {
+        *p_msg_id = p_client->message_id;
+    }
+
+    return err_code;
+}
+
 uint32_t mqttsn_client_publish(mqttsn_client_t * p_client,
                                uint16_t          topic_id,
                                const uint8_t   * p_payload,
                                uint16_t          payload_len,
                                uint16_t        * p_msg_id)
+{
+    return mqttsn_client_publish_with_priority(p_client,
+                                               topic_id,
+                                               p_payload,
+                                               payload_len,
+                                               MQTTSN_PRIORITY_NORMAL,
+                                               p_msg_id);
+}
+
+uint32_t mqttsn_client_publish_with_priority(mqttsn_client_t * p_client,
+                                             uint16_t          topic_id,
+                                             const uint8_t   * p_payload,
+                                             uint16_t          payload_len,
+                                             mqttsn_priority_t priority,
+                                             uint16_t        * p_msg_id)
 {
     NULL_PARAM_CHECK(p_client);
     NULL_PARAM_CHECK(p_payload);
@@ -359,22 +635,86 @@ uint32_t mqttsn_client_publish(mqttsn_client_t * p_client,
         return NRF_ERROR_NULL;
     }
 
-    if (!is_connected(p_client) && !is_asleep(p_client))
+    if (priority != MQTTSN_PRIORITY_NORMAL && priority != MQTTSN_PRIORITY_HIGH)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if (!is_initialized(p_client))
     {
         return NRF_ERROR_FORBIDDEN;
     }
 
-    mqttsn_topic_t topic = { .topic_id = topic_id };
+    uint32_t err_code = publish_send_or_defer(p_client, topic_id, p_payload, payload_len, priority, p_msg_id);
 
-    uint32_t err_code = mqttsn_packet_sender_publish(p_client, &topic, p_payload, payload_len);
-    if (p_msg_id)
+    mqttsn_retained_save(p_client);
+
+    return err_code;
+}
+
+uint32_t mqttsn_client_replay_interval_set(mqttsn_client_t * p_client, uint32_t interval_ms)
+{
+    NULL_PARAM_CHECK(p_client);
+
+    p_client->deferred_queue.replay_interval = interval_ms;
+    mqttsn_retained_changed(p_client, MQTTSN_RETAINED_DEFERRED);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t mqttsn_client_publish_append(mqttsn_client_t * p_client,
+                                      uint16_t          topic_id,
+                                      const uint8_t   * p_record,
+                                      uint16_t          record_len)
+{
+    NULL_PARAM_CHECK(p_client);
+    NULL_PARAM_CHECK(p_record);
+
+    if (topic_id == 0)
     {
-        *p_msg_id = p_client->message_id;
+        return NRF_ERROR_NULL;
+    }
+
+    if (!is_initialized(p_client))
+    {
+        return NRF_ERROR_FORBIDDEN;
+    }
+
+    uint32_t err_code = mqttsn_aggregator_append(p_client, topic_id, p_record, record_len);
+
+    if (err_code == NRF_SUCCESS && mqttsn_aggregator_deadline_get(p_client) < p_client->next_timeout)
+    {
+        err_code = mqttsn_client_timer_reschedule(p_client);
     }
 
     return err_code;
 }
 
+uint32_t mqttsn_client_publish_flush(mqttsn_client_t * p_client)
+{
+    NULL_PARAM_CHECK(p_client);
+
+    uint32_t err_code = mqttsn_aggregator_flush(p_client, MQTTSN_CLOCK_DEADLINE_NONE);
+
+    mqttsn_client_timer_reschedule(p_client);
+
+    return err_code;
+}
+
+uint32_t mqttsn_client_mtu_set(mqttsn_client_t * p_client, uint16_t mtu)
+{
+    NULL_PARAM_CHECK(p_client);
+
+    if (mtu == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    p_client->mtu = mtu;
+
+    return NRF_SUCCESS;
+}
+
 uint32_t mqttsn_client_topic_register(mqttsn_client_t * p_client,
                                       const uint8_t   * p_topic_name,
                                       uint16_t          topic_name_len,
@@ -403,6 +743,30 @@ uint32_t mqttsn_client_topic_register(mqttsn_client_t * p_client,
     return err_code;
 }
 
+uint32_t mqttsn_client_topic_add(mqttsn_client_t * p_client,
+                                 const uint8_t   * p_topic_name,
+                                 uint16_t          topic_name_len,
+                                 uint16_t        * p_topic_id)
+{
+    NULL_PARAM_CHECK(p_client);
+    NULL_PARAM_CHECK(p_topic_name);
+    NULL_PARAM_CHECK(p_topic_id);
+
+    if (!is_initialized(p_client))
+    {
+        return NRF_ERROR_FORBIDDEN;
+    }
+
+    uint32_t err_code = mqttsn_topic_table_local_add(p_client, p_topic_name, topic_name_len, p_topic_id);
+
+    if (err_code == NRF_SUCCESS)
+    {
+        mqttsn_retained_save(p_client);
+    }
+
+    return err_code;
+}
+
 uint32_t mqttsn_client_subscribe(mqttsn_client_t * p_client,
                                  const uint8_t   * p_topic_name,
                                  uint16_t          topic_name_len,
@@ -508,6 +872,46 @@ uint32_t mqttsn_client_willmsgupd(mqttsn_client_t * p_client,
     return mqttsn_packet_sender_willmsgupd(p_client);
 }
 
+uint32_t mqttsn_client_process(mqttsn_client_t * p_client)
+{
+    NULL_PARAM_CHECK(p_client);
+
+    if (!is_initialized(p_client))
+    {
+        return NRF_ERROR_FORBIDDEN;
+    }
+
+    mqttsn_delivery_queue_process(p_client);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t mqttsn_client_delivery_policy_set(mqttsn_client_t * p_client, mqttsn_delivery_policy_t policy)
+{
+    NULL_PARAM_CHECK(p_client);
+
+    if (policy != MQTTSN_DELIVERY_DROP_OLDEST &&
+        policy != MQTTSN_DELIVERY_DROP_NEWEST &&
+        policy != MQTTSN_DELIVERY_BACKPRESSURE)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    p_client->delivery_queue.policy = policy;
+
+    return NRF_SUCCESS;
+}
+
+const mqttsn_delivery_stats_t * mqttsn_client_delivery_stats_get(const mqttsn_client_t * p_client)
+{
+    return (p_client != NULL) ? &(p_client->delivery_queue.stats) : NULL;
+}
+
+const mqttsn_rx_stats_t * mqttsn_client_rx_stats_get(const mqttsn_client_t * p_client)
+{
+    return (p_client != NULL) ? &(p_client->rx_stats) : NULL;
+}
+
 uint32_t mqttsn_client_uninit(mqttsn_client_t * p_client)
 {
     NULL_PARAM_CHECK(p_client);
@@ -517,55 +921,168 @@ uint32_t mqttsn_client_uninit(mqttsn_client_t * p_client)
         return NRF_ERROR_FORBIDDEN;
     }
 
+    mqttsn_platform_timer_uninit(p_client);
+    mqttsn_retained_uninit(p_client);
     mqttsn_packet_fifo_uninit(p_client);
-    
-    // Removed dependency of Open Thread
-    return /*mqttsn_transport_uninit(p_client) == 0 ?*/ NRF_SUCCESS; /*: NRF_ERROR_INTERNAL;*/
+
+    p_client->client_state = MQTTSN_CLIENT_IDLE;
+
+    return mqttsn_transport_uninit(p_client) == NRF_SUCCESS ? NRF_SUCCESS : NRF_ERROR_INTERNAL;
 }
 
-void mqttsn_client_timer_timeout_handle(mqttsn_client_t * p_client)
+uint32_t mqttsn_client_timer_reschedule(mqttsn_client_t * p_client)
 {
-    uint32_t next_timeout = UINT32_MAX;
-    uint32_t timer_value  = mqttsn_platform_timer_cnt_get();
+    uint64_t next_timeout = p_client->keep_alive.timeout;
 
+    if (p_client->failover.message.timeout < next_timeout)
+    {
+        next_timeout = p_client->failover.message.timeout;
+    }
+
+    if (mqttsn_aggregator_deadline_get(p_client) < next_timeout)
+    {
+        next_timeout = mqttsn_aggregator_deadline_get(p_client);
+    }
+
+    if (p_client->deferred_queue.replay_timeout < next_timeout)
+    {
+        next_timeout = p_client->deferred_queue.replay_timeout;
+    }
+
+    for (int i = 0; i < p_client->packet_queue.num_of_elements; i++)
+    {
+        if (p_client->packet_queue.packet[i].timeout < next_timeout)
+        {
+            next_timeout = p_client->packet_queue.packet[i].timeout;
+        }
+    }
+
+    mqttsn_platform_timer_stop(p_client);
+    p_client->next_timeout = next_timeout;
+
+    if (next_timeout == MQTTSN_CLOCK_DEADLINE_NONE)
+    {
+        return NRF_SUCCESS;
+    }
+
+    /* Deadlines beyond the platform timer's range are reached in several timer runs. */
+    uint64_t remaining = mqttsn_clock_deadline_remaining(next_timeout, mqttsn_platform_time_ms_get());
+    if (remaining > mqttsn_platform_timer_resolution_get())
+    {
+        remaining = mqttsn_platform_timer_resolution_get();
+    }
+
+    return mqttsn_platform_timer_start(p_client, (uint32_t)remaining);
+}
+
+void mqttsn_client_timer_timeout_handle(mqttsn_client_t * p_client)
+{
     /* Random jitter for SEARCH GATEWAY message. */
     if (p_client->client_state == MQTTSN_CLIENT_SEARCHING_GATEWAY)
     {
+        p_client->next_timeout = MQTTSN_CLOCK_DEADLINE_NONE;
         mqttsn_packet_sender_searchgw(p_client);
         return;
     }
 
+    uint64_t now = mqttsn_platform_time_ms_get();
+
     /* Retransmission handler. */
     for (int i = 0; i < p_client->packet_queue.num_of_elements; i++)
     {
-        if (is_earlier(p_client->packet_queue.packet[i].timeout, m_next_timeout))
+        if (mqttsn_clock_deadline_passed(p_client->packet_queue.packet[i].timeout, now))
         {
+            uint8_t num_of_elements = p_client->packet_queue.num_of_elements;
+
             message_retransmission_attempt(p_client, i);
-        }
-        
-        if (p_client->packet_queue.packet[i].timeout - timer_value < next_timeout)
-        {
-            next_timeout = p_client->packet_queue.packet[i].timeout - timer_value;
+
+            /* A packet out of retransmissions is dequeued, and the next one takes its index. */
+            if (p_client->packet_queue.num_of_elements < num_of_elements)
+            {
+                --i;
+            }
         }
     }
 
-    /* Keep alive (pingreq) message. */
-    if (m_next_timeout != UINT32_MAX)
+    /* Aggregated publications due. Failed ones are retried later. */
+    (void)mqttsn_aggregator_flush(p_client, now);
+
+    /* Queued publications held back by the rate limit. */
+    if (mqttsn_clock_deadline_passed(p_client->deferred_queue.replay_timeout, now))
     {
-        if (is_earlier(p_client->keep_alive.timeout, m_next_timeout))
+        p_client->deferred_queue.replay_timeout = MQTTSN_CLOCK_DEADLINE_NONE;
+        mqttsn_client_deferred_process(p_client);
+    }
+
+    /* CONNECT or REGISTER message sent while switching gateways. */
+    if (mqttsn_clock_deadline_passed(p_client->failover.message.timeout, now))
+    {
+        mqttsn_failover_timeout_handle(p_client);
+    }
+
+    /* Keep alive (pingreq) message, or end of the sleep period. */
+    if (mqttsn_clock_deadline_passed(p_client->keep_alive.timeout, now))
+    {
+        if (is_asleep(p_client))
         {
-            keep_alive_transmission_attempt(p_client);
+            client_wake(p_client);
+            mqttsn_retained_save(p_client);
+            return;
         }
+
+        p_client->keep_alive.response_arrived = 0;
+        keep_alive_transmission_attempt(p_client);
+    }
+
+    mqttsn_client_timer_reschedule(p_client);
+    mqttsn_retained_save(p_client);
+}
+
+void mqttsn_client_gateway_select(mqttsn_client_t * p_client, const mqttsn_gw_info_t * p_gateway)
+{
+    if (p_gateway != &(p_client->gateway_info))
+    {
+        memcpy(&(p_client->gateway_info), p_gateway, sizeof(mqttsn_gw_info_t));
+        mqttsn_retained_changed(p_client, MQTTSN_RETAINED_SESSION);
     }
 
-    if (p_client->keep_alive.timeout - timer_value < next_timeout)
+    p_client->client_state = MQTTSN_CLIENT_GATEWAY_FOUND;
+
+    mqttsn_event_t evt =
     {
-        next_timeout = p_client->keep_alive.timeout - timer_value;
-        next_timeout = next_timeout % mqttsn_platform_timer_resolution_get();
-        p_client->keep_alive.response_arrived = 0;
+        .event_id             = MQTTSN_EVENT_GATEWAY_FOUND,
+        .event_data.connected =
+        {
+            .gateway_id     = p_client->gateway_info.id,
+            .p_gateway_addr = &(p_client->gateway_info.addr),
+        },
+    };
+
+    p_client->evt_handler(p_client, &evt);
+}
+
+void mqttsn_client_deferred_process(mqttsn_client_t * p_client)
+{
+    if (!is_connected(p_client) && !is_awake(p_client))
+    {
+        return;
     }
 
-    m_next_timeout = next_timeout;
+    /* Publications restored after a reset go out ahead of the ones held back since. */
+    mqttsn_retained_release(p_client);
+    deferred_queue_flush(p_client);
 
-    mqttsn_platform_timer_start(p_client, m_next_timeout);
+    if (is_awake(p_client)                             &&
+        p_client->keep_alive.response_arrived          &&
+        p_client->packet_queue.num_of_elements == 0    &&
+        mqttsn_deferred_queue_front_get(p_client) == NULL)
+    {
+        mqttsn_event_t evt = { .event_id = MQTTSN_EVENT_SLEEP_PERMIT };
+
+        p_client->client_state       = MQTTSN_CLIENT_ASLEEP;
+        p_client->keep_alive.timeout = mqttsn_platform_timer_set_in_ms(p_client->keep_alive.duration);
+        mqttsn_client_timer_reschedule(p_client);
+
+        p_client->evt_handler(p_client, &evt);
+    }
 }
@@ -21,9 +21,16 @@
  * @section DEFINES
  **************************************************************************************************/
 
+/**@brief Number of MQTT-SN message types, from ADVERTISE to WILLMSGRESP. */
+#define MQTTSN_MSGTYPE_COUNT                     30
+
 /**@brief Default maximum number of elements in packet queue. */
 #define MQTTSN_PACKET_FIFO_MAX_LENGTH            4
 
+/**@brief Number of packet queue slots normal priority publications leave free for high priority
+ *        ones. */
+#define MQTTSN_PACKET_FIFO_RESERVED_LENGTH       1
+
 /**@brief Maximum length of Client ID according to the protocol spec in bytes. */
 #define MQTTSN_CLIENT_ID_MAX_LENGTH              23
 
@@ -48,6 +55,78 @@
 /**@brief Default number of retransmission retries. */
 #define MQTTSN_DEFAULT_RETRANSMISSION_CNT        2
 
+/**@brief Maximum number of gateways remembered from ADVERTISE and GWINFO messages. */
+#define MQTTSN_GATEWAY_TABLE_MAX_LENGTH          4
+
+/**@brief Number of ADVERTISE periods a gateway may stay silent before it is considered lost. */
+#define MQTTSN_GATEWAY_ADVERTISE_TOLERANCE       2
+
+/**@brief Time in seconds a gateway known only from GWINFO is considered live. */
+#define MQTTSN_GATEWAY_INFO_VALIDITY             300
+
+/**@brief Maximum number of registered topics the client remembers, so that it can register them
+ *        again after switching to another gateway. */
+#define MQTTSN_TOPIC_TABLE_MAX_LENGTH            4
+
+/**@brief Maximum length of a topic name remembered for re-registration. */
+#define MQTTSN_TOPIC_NAME_MAX_LENGTH             32
+
+/**@brief Topic ID given to a topic added with @ref mqttsn_client_topic_add before it is registered,
+ *        decreasing with the position of the topic in the table. Gateways assign topic IDs from 1
+ *        upwards, and 0xFFFF is reserved. */
+#define MQTTSN_TOPIC_LOCAL_ID_FIRST              0xFFFE
+
+/**@brief Length of the PUBLISH header template kept for each registered topic. */
+#define MQTTSN_TOPIC_PUBLISH_TEMPLATE_LENGTH     4
+
+/**@brief Maximum length of a message header kept in the packet queue in front of a separate
+ *        payload: the PUBLISH header with a 3-byte Length field. */
+#define MQTTSN_PACKET_HEADER_MAX_LENGTH          9
+
+/**@brief Maximum number of publications held back while the client cannot send them. A sleeping
+ *        client wakes up early when the queue fills. */
+#define MQTTSN_DEFERRED_QUEUE_MAX_LENGTH         16
+
+/**@brief Maximum payload length of a publication held back while the client cannot send it. */
+#define MQTTSN_DEFERRED_PAYLOAD_MAX_LENGTH       32
+
+/**@brief Maximum number of topics records can be aggregated for at the same time. */
+#define MQTTSN_AGGREGATOR_MAX_LENGTH             2
+
+/**@brief Maximum payload length of an aggregated publication, including record length prefixes.
+ *        Aggregated publications are queued like any other, so they are limited to
+ *        MQTTSN_DEFERRED_PAYLOAD_MAX_LENGTH, which the memory manager blocks have to hold. */
+#define MQTTSN_AGGREGATOR_PAYLOAD_MAX_LENGTH     MQTTSN_DEFERRED_PAYLOAD_MAX_LENGTH
+
+/**@brief Number of records after which an aggregated publication is sent. */
+#define MQTTSN_AGGREGATOR_RECORD_MAX_COUNT       8
+
+/**@brief Time in milliseconds the first record of an aggregated publication may wait to be sent. */
+#define MQTTSN_AGGREGATOR_LATENCY_MS             1000
+
+/**@brief Largest message carried by the transport in one frame until the application sets it. */
+#define MQTTSN_DEFAULT_MTU                       20
+
+/**@brief Maximum number of received publications waiting to be delivered to the application. */
+#define MQTTSN_DELIVERY_QUEUE_MAX_LENGTH         4
+
+/**@brief Maximum payload length of a received publication. Longer publications are dropped. */
+#define MQTTSN_DELIVERY_PAYLOAD_MAX_LENGTH       64
+
+/**@brief Number of recently received QoS 1 publications remembered to recognize retransmissions. */
+#define MQTTSN_DELIVERY_DUP_WINDOW_LENGTH        8
+
+/**@brief Default handling of publications received while the delivery queue is full. */
+#define MQTTSN_DEFAULT_DELIVERY_POLICY           MQTTSN_DELIVERY_BACKPRESSURE
+
+/**@brief Maximum length of an in-flight PUBLISH message kept across soft resets. Longer messages
+ *        are lost on reset. */
+#define MQTTSN_RETAINED_PUBLISH_MAX_LENGTH       72
+
+/**@brief Maximum number of clients whose state is kept across soft resets. Further clients run
+ *        without it, and lose their state on reset. */
+#define MQTTSN_RETAINED_MAX_CLIENTS              1
+
 /**@brief Length of an IPv6 address in bytes. For internal use only */
 #define IPV6_ADDR_BYTE_LENGTH                    16
 
@@ -55,6 +134,15 @@
 #define MQTTSN_WILL_TOPIC_MAX_LENGTH             32
 #define MQTTSN_WILL_MSG_MAX_LENGTH               32
 
+/**@brief Maximum length of PINGREQ message carrying the Client ID. For internal use only */
+#define MQTTSN_PINGREQ_MAX_LENGTH                (2 + MQTTSN_CLIENT_ID_MAX_LENGTH)
+
+/**@brief Maximum length of CONNECT and REGISTER messages sent while switching gateways. For internal use only */
+#define MQTTSN_FAILOVER_MSG_MAX_LENGTH           (6 + MQTTSN_TOPIC_NAME_MAX_LENGTH)
+
+/**@brief Size of platform-specific timer storage in bytes. For internal use only */
+#define MQTTSN_PLATFORM_TIMER_DATA_SIZE          32
+
 
 /***************************************************************************************************
  * @section TYPES
@@ -96,13 +184,112 @@ typedef struct mqttsn_topic_t
 typedef struct mqttsn_packet_t
 {
     uint8_t        retransmission_cnt; /**< Number of retransmissions to attempt if necessary. */
-    uint8_t      * p_data;             /**< Message content. */
-    uint16_t       len;                /**< Length of the message. */
+    uint8_t      * p_data;             /**< Message content, or NULL if the message header is kept in header. */
+    uint8_t        header[MQTTSN_PACKET_HEADER_MAX_LENGTH]; /**< Message header, if the payload is separate. */
+    uint16_t       len;                /**< Length of the message content or header. */
+    uint8_t      * p_payload;          /**< Payload sent after the message content, or NULL. */
+    uint16_t       payload_len;        /**< Length of the payload. */
     uint16_t       id;                 /**< Message ID. */
-    uint32_t       timeout;            /**< Time of the next retransmissions in ms (if necessary). */
+    uint64_t       timeout;            /**< Time of the next retransmissions in ms (if necessary). */
     mqttsn_topic_t topic;              /**< Topic of the message. */
   } mqttsn_packet_t;
 
+/**@brief Priority class of a publication. */
+typedef enum mqttsn_priority_t
+{
+    MQTTSN_PRIORITY_NORMAL, /**< Sent in order, while the packet queue has a slot left beyond the reserved ones. */
+    MQTTSN_PRIORITY_HIGH    /**< Sent ahead of queued normal priority publications, into any packet queue slot. */
+} mqttsn_priority_t;
+
+/**@brief Publication held back until the client can send it. For internal use only */
+typedef struct mqttsn_deferred_publish_t
+{
+    uint16_t          topic_id;                                      /**< Topic ID. */
+    uint16_t          payload_len;                                   /**< Length of the payload. */
+    mqttsn_priority_t priority;                                      /**< Priority class. */
+    uint8_t           p_payload[MQTTSN_DEFERRED_PAYLOAD_MAX_LENGTH]; /**< Payload. */
+} mqttsn_deferred_publish_t;
+
+/**@brief Queue of held back publications, high priority ones first, then oldest first. For internal
+ *        use only */
+typedef struct mqttsn_deferred_queue_t
+{
+    mqttsn_deferred_publish_t publish[MQTTSN_DEFERRED_QUEUE_MAX_LENGTH]; /**< Ring of publications. */
+    uint8_t                   head;                                      /**< Index of the oldest publication. */
+    uint8_t                   num_of_elements;                           /**< Current number of elements in the queue. */
+    uint32_t                  replay_interval;                           /**< Minimum time between sent publications in milliseconds, 0 for no limit. */
+    uint64_t                  replay_last;                               /**< Time the last publication was sent in milliseconds, MQTTSN_CLOCK_DEADLINE_NONE if none. */
+    uint64_t                  replay_timeout;                            /**< Time the next publication held back by the rate limit is sent, MQTTSN_CLOCK_DEADLINE_NONE if none. */
+} mqttsn_deferred_queue_t;
+
+/**@brief Records staged for a single aggregated publication. For internal use only */
+typedef struct mqttsn_aggregate_t
+{
+    uint16_t topic_id;                                        /**< Topic ID known to the application, 0 if the slot is unused. */
+    uint16_t payload_len;                                     /**< Length of the staged records. */
+    uint8_t  record_cnt;                                      /**< Number of staged records. */
+    uint64_t deadline;                                        /**< Time the staged records are sent at the latest, in milliseconds. */
+    uint8_t  p_payload[MQTTSN_AGGREGATOR_PAYLOAD_MAX_LENGTH]; /**< Length-prefixed records. */
+} mqttsn_aggregate_t;
+
+/**@brief Aggregated publications being staged. For internal use only */
+typedef struct mqttsn_aggregator_t
+{
+    mqttsn_aggregate_t aggregate[MQTTSN_AGGREGATOR_MAX_LENGTH]; /**< Array of aggregated publications. */
+} mqttsn_aggregator_t;
+
+/**@brief Handling of publications received while the delivery queue is full. */
+typedef enum mqttsn_delivery_policy_t
+{
+    MQTTSN_DELIVERY_DROP_OLDEST,  /**< The oldest undelivered publication is dropped to make room. */
+    MQTTSN_DELIVERY_DROP_NEWEST,  /**< The received publication is dropped. */
+    MQTTSN_DELIVERY_BACKPRESSURE  /**< QoS 1 publications are acknowledged once delivered. One which does not fit is
+                                       left unacknowledged for the gateway to retransmit, others are dropped. */
+} mqttsn_delivery_policy_t;
+
+/**@brief Counters of received publications. */
+typedef struct mqttsn_delivery_stats_t
+{
+    uint16_t delivered;      /**< Publications passed to the application. */
+    uint16_t dropped_oldest; /**< Undelivered publications dropped to make room for newer ones. */
+    uint16_t dropped_newest; /**< Publications dropped as the queue was full. */
+    uint16_t deferred;       /**< QoS 1 publications left unacknowledged as the queue was full. */
+    uint16_t oversized;      /**< Publications dropped as their payload did not fit a queue slot. */
+    uint16_t duplicates;     /**< Retransmissions of publications already received, acknowledged again only. */
+    uint8_t  max_queued;     /**< Largest number of publications waiting at once. */
+} mqttsn_delivery_stats_t;
+
+/**@brief Received publication waiting to be delivered. For internal use only */
+typedef struct mqttsn_delivery_publish_t
+{
+    uint16_t topic_id;                                      /**< Topic ID. */
+    uint16_t packet_id;                                     /**< Message ID. */
+    bool     ack_pending;                                   /**< True if PUBACK message is sent on delivery. */
+    uint16_t payload_len;                                   /**< Length of the payload. */
+    uint8_t  p_payload[MQTTSN_DELIVERY_PAYLOAD_MAX_LENGTH]; /**< Payload. */
+} mqttsn_delivery_publish_t;
+
+/**@brief Queue of received publications, oldest first. For internal use only */
+typedef struct mqttsn_delivery_queue_t
+{
+    mqttsn_delivery_publish_t publish[MQTTSN_DELIVERY_QUEUE_MAX_LENGTH]; /**< Ring of publications. */
+    uint8_t                   head;                                      /**< Index of the oldest publication. */
+    uint8_t                   num_of_elements;                           /**< Current number of elements in the queue. */
+    mqttsn_delivery_policy_t  policy;                                    /**< Handling of publications which do not fit. */
+    uint32_t                  seen[MQTTSN_DELIVERY_DUP_WINDOW_LENGTH];   /**< Ring of topic and message IDs of QoS 1 publications received, 0 if unused. */
+    uint8_t                   seen_next;                                 /**< Index of the oldest entry of the ring. */
+    mqttsn_delivery_stats_t   stats;                                     /**< Counters of received publications. */
+} mqttsn_delivery_queue_t;
+
+/**@brief Counters of received messages. Indexed by Message Type field value. */
+typedef struct mqttsn_rx_stats_t
+{
+    uint16_t received[MQTTSN_MSGTYPE_COUNT];  /**< Messages passed to their handler. */
+    uint16_t rejected[MQTTSN_MSGTYPE_COUNT];  /**< Messages their handler failed to process. */
+    uint16_t malformed[MQTTSN_MSGTYPE_COUNT]; /**< Messages shorter than the fixed fields of their type. */
+    uint16_t invalid;                         /**< Messages with a malformed Length field or of a type the client does not receive. */
+} mqttsn_rx_stats_t;
+
 /**@brief Packet queueing data available for client. For internal use only */
 typedef struct mqttsn_packet_queue_t
 {
@@ -122,6 +309,7 @@ typedef enum mqttsn_client_state_t
     MQTTSN_CLIENT_WAITING_FOR_SLEEP,       /**< Client is waiting for permission to sleep. */
     MQTTSN_CLIENT_WAITING_FOR_DISCONNECT,  /**< Client is waiting for permission to disconnect. */
     MQTTSN_CLIENT_ASLEEP,                  /**< Client is in sleep mode. */
+    MQTTSN_CLIENT_AWAKE,                   /**< Client has woken up from sleep to exchange buffered messages. */
 } mqttsn_client_state_t;
 
 /**@brief MQTT-SN gateway information. */ 
@@ -131,6 +319,95 @@ typedef struct mqttsn_gw_info_t
     mqttsn_remote_t addr; /**< Address and port number of the gateway. */
 } mqttsn_gw_info_t;
 
+/**@brief Gateway known to the client. For internal use only */
+typedef struct mqttsn_gateway_entry_t
+{
+    mqttsn_gw_info_t info;      /**< Gateway ID and address. */
+    bool             in_use;    /**< True if the entry holds a gateway. */
+    uint16_t         duration;  /**< Advertised interval between ADVERTISE messages in seconds, 0 if unknown. */
+    uint32_t         rtt;       /**< Measured SEARCHGW to GWINFO round trip time in milliseconds, UINT32_MAX if unknown. */
+    uint64_t         last_seen; /**< Time the gateway was last heard from in milliseconds. */
+} mqttsn_gateway_entry_t;
+
+/**@brief Gateways known to the client. For internal use only */
+typedef struct mqttsn_gateway_table_t
+{
+    mqttsn_gateway_entry_t gateway[MQTTSN_GATEWAY_TABLE_MAX_LENGTH]; /**< Array of gateways. */
+    uint64_t               searchgw_sent;                            /**< Time the last SEARCHGW was sent in milliseconds. */
+} mqttsn_gateway_table_t;
+
+/**@brief Topic registered by the client. For internal use only */
+typedef struct mqttsn_topic_entry_t
+{
+    uint8_t  p_topic_name[MQTTSN_TOPIC_NAME_MAX_LENGTH]; /**< Topic name. */
+    uint16_t topic_name_len;                             /**< Length of the topic name, 0 if the entry is unused. */
+    uint16_t app_id;                                     /**< Topic ID known to the application, assigned by the first gateway. */
+    uint16_t gateway_id;                                 /**< Topic ID assigned by the current gateway, 0 if not registered. */
+    uint8_t  publish_template[MQTTSN_TOPIC_PUBLISH_TEMPLATE_LENGTH]; /**< PUBLISH header fields for the current topic ID. */
+} mqttsn_topic_entry_t;
+
+/**@brief Topics registered by the client. For internal use only */
+typedef struct mqttsn_topic_table_t
+{
+    mqttsn_topic_entry_t topic[MQTTSN_TOPIC_TABLE_MAX_LENGTH]; /**< Array of topics. */
+} mqttsn_topic_table_t;
+
+/**@brief In-flight PUBLISH message kept across soft resets. For internal use only */
+typedef struct mqttsn_retained_publish_t
+{
+    uint16_t len;                                      /**< Length of the message, 0 if the slot is unused. */
+    uint8_t  p_msg[MQTTSN_RETAINED_PUBLISH_MAX_LENGTH]; /**< Message, with the topic ID known to the application. */
+} mqttsn_retained_publish_t;
+
+/**@brief Parts of the client state kept across soft resets, each saved on its own. For internal use only */
+typedef enum mqttsn_retained_part_t
+{
+    MQTTSN_RETAINED_SESSION   = 0x01, /**< Gateway and topic table. */
+    MQTTSN_RETAINED_DEFERRED  = 0x02, /**< Publications not sent yet. */
+    MQTTSN_RETAINED_IN_FLIGHT = 0x04, /**< Message ID and publications awaiting PUBACK. */
+    MQTTSN_RETAINED_ALL       = 0x07  /**< All parts. */
+} mqttsn_retained_part_t;
+
+/**@brief Session part of a retained image. For internal use only */
+typedef struct mqttsn_retained_session_t
+{
+    uint32_t             checksum;     /**< Checksum of the rest of the part. */
+    uint16_t             port;         /**< Port of the client the image belongs to. */
+    mqttsn_gw_info_t     gateway_info; /**< Gateway the client was using. */
+    mqttsn_topic_table_t topic_table;  /**< Topics registered by the client. */
+} mqttsn_retained_session_t;
+
+/**@brief Deferred part of a retained image. For internal use only */
+typedef struct mqttsn_retained_deferred_t
+{
+    uint32_t                  checksum;                                  /**< Checksum of the rest of the part, up to the last publication. */
+    uint32_t                  replay_interval;                           /**< Minimum time between sent publications in milliseconds. */
+    uint8_t                   num_of_elements;                           /**< Number of publications. */
+    mqttsn_deferred_publish_t publish[MQTTSN_DEFERRED_QUEUE_MAX_LENGTH]; /**< Publications, in the order they are sent. */
+} mqttsn_retained_deferred_t;
+
+/**@brief In-flight part of a retained image. For internal use only */
+typedef struct mqttsn_retained_in_flight_t
+{
+    uint32_t                  checksum;                                /**< Checksum of the rest of the part, up to the last publication. */
+    uint16_t                  message_id;                              /**< Last message ID used. */
+    uint8_t                   num_of_elements;                         /**< Number of publications. */
+    mqttsn_retained_publish_t publish[MQTTSN_PACKET_FIFO_MAX_LENGTH]; /**< Publications awaiting PUBACK, in the order they were sent. */
+} mqttsn_retained_in_flight_t;
+
+/**@brief Client state kept across soft resets in RAM not initialized at startup.
+ *
+ * @details The parts are checksummed separately, so that a change rewrites only the part it
+ *          affects. Only the publications held are written and summed. For internal use only
+ */
+typedef struct mqttsn_retained_t
+{
+    uint32_t                    magic;     /**< Image marker, tied to the image layout. */
+    mqttsn_retained_session_t   session;   /**< Gateway and topics. */
+    mqttsn_retained_deferred_t  deferred;  /**< Publications not sent yet. */
+    mqttsn_retained_in_flight_t in_flight; /**< Publications awaiting PUBACK. */
+} mqttsn_retained_t;
+
 /**@brief MQTT-SN client connect options. */
 typedef struct mqttsn_connect_opt_t
 {
@@ -161,7 +438,8 @@ typedef enum mqttsn_event_id_t
     MQTTSN_EVENT_RECEIVED,          /**< Client has received data to subscribed topic. */
     MQTTSN_EVENT_SLEEP_PERMIT,      /**< Client is allowed to sleep. */
     MQTTSN_EVENT_SLEEP_STOP,        /**< Client should wake up. */
-    MQTTSN_EVENT_TIMEOUT            /**< Message hasn't been delivered successfully. Reason: mqttsn_error_t */
+    MQTTSN_EVENT_TIMEOUT,           /**< Message hasn't been delivered successfully. Reason: mqttsn_error_t */
+    MQTTSN_EVENT_GATEWAY_SWITCHED   /**< Client has lost its gateway and connected to another one. */
 } mqttsn_event_id_t;
 
 /**@brief MQTT-SN sending error the application shall handle. */
@@ -216,7 +494,7 @@ typedef struct mqttsn_event_error_t
 /**@brief MQTT-SN event data for specific events. */
 typedef union mqttsn_event_data_t
 {
-    mqttsn_event_gwinfo_t   connected;  /**< Data forwarded to the application when a gateway is found. */
+    mqttsn_event_gwinfo_t   connected;  /**< Data forwarded to the application when a gateway is found or switched to. */
     mqttsn_event_register_t registered; /**< Data forwarded to the application when a topic is registered. */
     mqttsn_event_publish_t  published;  /**< Data forwarded to the application when PUBLISH message is received. */
     mqttsn_event_error_t    error;      /**< Data forwarded to the application when a retransmission error occurred. */
@@ -232,12 +510,29 @@ typedef struct mqttsn_event_t
 /**@brief MQTT-SN keep-alive procedure. */
 typedef struct mqttsn_keep_alive_t
 {
-    uint32_t        timeout;          /**< Time of the next keep alive message in milliseconds. */
-    uint32_t        duration;         /**< Keep alive duration in milliseconds. */
-    uint8_t         response_arrived; /**< 1 when gateway has responded to previous keep alive, 0 otherwise. */
-    mqttsn_packet_t message;          /**< Keep alive message (PINGREQ). */
+    uint64_t        timeout;                                  /**< Time of the next keep alive message in milliseconds. */
+    uint32_t        duration;                                 /**< Keep alive duration in milliseconds. */
+    uint8_t         response_arrived;                         /**< 1 when gateway has responded to previous keep alive, 0 otherwise. */
+    mqttsn_packet_t message;                                  /**< Keep alive message (PINGREQ). */
+    uint8_t         p_pingreq_msg[MQTTSN_PINGREQ_MAX_LENGTH]; /**< PINGREQ message buffer. */
 } mqttsn_keep_alive_t;
 
+/**@brief Switch to another gateway after the current one stopped answering. For internal use only */
+typedef struct mqttsn_failover_t
+{
+    bool            in_progress;                             /**< True while the client is switching gateways. */
+    uint8_t         topic_index;                             /**< Index of the topic being registered, MQTTSN_TOPIC_TABLE_MAX_LENGTH while connecting. */
+    mqttsn_packet_t message;                                 /**< CONNECT or REGISTER message awaiting acknowledgement. */
+    uint8_t         p_msg[MQTTSN_FAILOVER_MSG_MAX_LENGTH];   /**< Message buffer. */
+} mqttsn_failover_t;
+
+/**@brief Platform timer owned by a client. For internal use only */
+typedef struct mqttsn_platform_timer_t
+{
+    uint64_t data[MQTTSN_PLATFORM_TIMER_DATA_SIZE / sizeof(uint64_t)]; /**< Platform-specific timer storage. */
+    void   * p_next;                                                  /**< Platform-specific link to another client's timer. */
+} mqttsn_platform_timer_t;
+
 /**@brief Forward declaration of MQTT-SN client. */
 typedef struct mqttsn_client_t mqttsn_client_t;
 
@@ -258,10 +553,21 @@ struct mqttsn_client_t
     mqttsn_keep_alive_t         keep_alive;   /**< Keep alive data. */
     mqttsn_client_state_t       client_state; /**< Current state of the client. */
     mqttsn_gw_info_t            gateway_info; /**< Gateway information. */
+    mqttsn_gateway_table_t      gateway_table; /**< Gateways heard from. */
+    mqttsn_topic_table_t        topic_table;  /**< Topics registered by the client. */
+    mqttsn_failover_t           failover;     /**< Gateway switch state. */
     mqttsn_connect_opt_t        connect_info; /**< Connect options. */
     mqttsn_packet_queue_t       packet_queue; /**< Packet queue. */
+    mqttsn_deferred_queue_t     deferred_queue; /**< Publications held back while asleep. */
+    mqttsn_aggregator_t         aggregator;   /**< Records staged for aggregated publications. */
+    mqttsn_delivery_queue_t     delivery_queue; /**< Received publications waiting to be delivered. */
+    uint16_t                    mtu;          /**< Largest message carried by the transport in one frame. */
+    mqttsn_rx_stats_t           rx_stats;     /**< Counters of received messages. */
     mqttsn_client_evt_handler_t evt_handler;  /**< Event handler. */
-    mqttsn_client_transport_t   transport;
+    mqttsn_client_transport_t   transport;    /**< Transport layer information. */
+    mqttsn_platform_timer_t     timer;        /**< Platform timer of the client. */
+    uint64_t                    next_timeout; /**< Deadline the platform timer is running for, in milliseconds. */
+    uint8_t                     retained_dirty; /**< Parts of the retained image out of date, see @ref mqttsn_retained_part_t. */
 };
 
 
@@ -271,6 +577,10 @@ struct mqttsn_client_t
 
 /**@brief Initializes the MQTT-SN client.  
  * 
+ * @details On nRF5 devices, received data and timer expiries are processed in thread mode through
+ *          app_scheduler. The application must initialize the scheduler with an event size of at
+ *          least MQTTSN_SCHED_EVENT_DATA_SIZE and call app_sched_execute from its main loop.
+ *
  * @param[out] p_client            Pointer to initialized client.
  * @param[in]  port                Number of the port the client will be bound to.
  * @param[in]  evt_handler         Pointer to function handling MQTT-SN client events.
@@ -286,15 +596,29 @@ uint32_t mqttsn_client_init(mqttsn_client_t             * p_client,
 
 /**@brief Searches gateway.  
  *
- * @param[inout] p_client    Pointer to initialized client.
+ * @details On a point-to-point transport, such as BLE, the peer is the gateway:
+ *          @ref MQTTSN_EVENT_GATEWAY_FOUND is raised before this function returns, with the gateway
+ *          ID last heard from the peer, or 0. If a live gateway has already been heard from through
+ *          ADVERTISE or GWINFO, the best of them (lowest measured round trip time, then most
+ *          recently heard) is selected and the event is raised the same way. Otherwise SEARCHGW is
+ *          broadcast after a random delay.
+ *
+ * @param[inout] p_client    Pointer to initialized client, disconnected or searching for a gateway.
  *
- * @return       NRF_SUCCESS if the gateway info request has been sent successfully.
+ * @return       NRF_SUCCESS if the gateway has been found or the gateway info request has been sent successfully.
+ *               NRF_ERROR_INVALID_STATE if the client is in any other state.
  *               Otherwise error code is returned.
  */ 
 uint32_t mqttsn_client_search_gateway(mqttsn_client_t * p_client);
 
 
 /**@brief Connects the MQTT-SN client to gateway.  
+ *
+ * @details If the gateway later stops answering, so that a message runs out of retransmissions,
+ *          while another live gateway is known, the client connects to that gateway with the same
+ *          options, registers remembered topics again and resends unacknowledged messages to it,
+ *          then raises @ref MQTTSN_EVENT_GATEWAY_SWITCHED. Subscriptions are not renewed. Only
+ *          when no other gateway is known is @ref MQTTSN_EVENT_TIMEOUT raised.
  *
  * @param[inout] p_client    Pointer to initialized client.
  * @param[in]    p_remote    Pointer to the gateway endpoint.
@@ -322,7 +646,11 @@ uint32_t mqttsn_client_disconnect(mqttsn_client_t * p_client);
 
 /**@brief Puts the MQTT-SN client in asleep state.  
  *
- * @details MQTT-SN Disconnect message with appropriate duration field is sent. 
+ * @details MQTT-SN Disconnect message with appropriate duration field is sent. Once the gateway
+ *          confirms, the client sleeps and manages its wake windows on its own: every polling_time
+ *          it wakes up (@ref MQTTSN_EVENT_SLEEP_STOP), sends publications queued while asleep,
+ *          polls the gateway with PINGREQ and receives buffered messages. When PINGRESP has arrived
+ *          and all publications are acknowledged, it goes back to sleep (@ref MQTTSN_EVENT_SLEEP_PERMIT).
  *
  * @param[inout] p_client     Pointer to initialized and connected client.
  * @param[in]    polling_time Value of time in seconds for which the client is considered asleep by the gateway.
@@ -336,6 +664,8 @@ uint32_t mqttsn_client_sleep(mqttsn_client_t * p_client, uint16_t polling_time);
 /**@brief Registers topic.  
  *
  * @details Topic name with assigned topic ID can be accessed in MQTT-SN_EVENT_REGISTERED callback.  
+ *          Up to MQTTSN_TOPIC_TABLE_MAX_LENGTH topics are remembered by the client and registered
+ *          again if it has to switch gateways, so the topic ID stays valid for the application.
  *
  * @param[inout] p_client       Pointer to initialized and connected client.
  * @param[in]    p_topic_name   String buffer containing the topic name.
@@ -351,15 +681,60 @@ uint32_t mqttsn_client_topic_register(mqttsn_client_t * p_client,
                                       uint16_t        * msg_id);
 
 
+/**@brief Adds a topic to be published to before it is registered.
+ *
+ * @details The topic gets a topic ID in any state once the client is initialized, so that the
+ *          application can publish before the first connection. Publications are queued until
+ *          the topic has been registered with @ref mqttsn_client_topic_register, which reports
+ *          the same topic ID in MQTTSN_EVENT_REGISTERED. The topic takes one of the
+ *          MQTTSN_TOPIC_TABLE_MAX_LENGTH entries of remembered topics.
+ *
+ * @param[inout] p_client       Pointer to initialized client.
+ * @param[in]    p_topic_name   String buffer containing the topic name.
+ * @param[in]    topic_name_len Topic name length.
+ * @param[out]   p_topic_id     Pointer to the topic ID to publish with. The one already known to
+ *                              the application if the topic has been added or registered before.
+ *
+ * @return       NRF_SUCCESS if the topic has been added successfully.
+ *               NRF_ERROR_INVALID_LENGTH if the topic name is empty or longer than
+ *               MQTTSN_TOPIC_NAME_MAX_LENGTH.
+ *               NRF_ERROR_NO_MEM if MQTTSN_TOPIC_TABLE_MAX_LENGTH topics are remembered already.
+ *               Otherwise error code is returned.
+ */
+uint32_t mqttsn_client_topic_add(mqttsn_client_t * p_client,
+                                 const uint8_t   * p_topic_name,
+                                 uint16_t          topic_name_len,
+                                 uint16_t        * p_topic_id);
+
+
 /**@brief Publishes data to given topic.  
+ *
+ * @details Publications are accepted in any state once the client is initialized. Those which
+ *          cannot be sent right away are queued and sent in order later:
+ *          - While the client is asleep, in the next wake window. A full queue wakes the client
+ *            immediately.
+ *          - While the client is switching gateways, once the new gateway has accepted the
+ *            connection.
+ *          - While the client is not connected, for example while the link to the gateway is down,
+ *            once it has connected again. After a connection with a clean session, publications to
+ *            a remembered topic wait until the topic has been registered again.
+ *          Queued publications are sent no faster than set with @ref mqttsn_client_replay_interval_set.
+ *          Publications made while older ones are still queued are queued behind them. Those to a
+ *          topic waiting for registration are skipped, so they do not hold back publications to
+ *          other topics, but stay in order with the other publications to their topic.
+ *          The publication is of normal priority, see @ref mqttsn_client_publish_with_priority.
  *
  * @param[inout] p_client       Pointer to initialized and connected client.
  * @param[in]    topic_id       Value of previously registered topic ID. 
  * @param[in]    p_payload      Data to be published.
  * @param[in]    payload_len    Length of data to be published.
- * @param[out]   msg_id         (optional) Pointer to message ID assigned to the message by client. 
+ * @param[out]   msg_id         (optional) Pointer to message ID assigned to the message by client.
+ *                              Set to 0 for a queued publication, whose ID is assigned when sent.
  *
- * @return       NRF_SUCCESS if the publish request has been sent successfully.
+ * @return       NRF_SUCCESS if the publish request has been sent or queued successfully.
+ *               NRF_ERROR_NO_MEM if the publication had to be queued and the queue is full.
+ *               NRF_ERROR_INVALID_LENGTH if the publication had to be queued and its payload is
+ *               longer than MQTTSN_DEFERRED_PAYLOAD_MAX_LENGTH.
  *               Otherwise error code is returned.
  */
 uint32_t mqttsn_client_publish(mqttsn_client_t * p_client,
@@ -369,6 +744,105 @@ uint32_t mqttsn_client_publish(mqttsn_client_t * p_client,
                                uint16_t        * msg_id);
 
 
+/**@brief Publishes data of a given priority class to a given topic.
+ *
+ * @details Works as @ref mqttsn_client_publish, except for a high priority publication:
+ *          - It is queued ahead of normal priority publications, behind older high priority ones.
+ *            If the queue is full, the newest normal priority publication is dropped to make room.
+ *          - It is not held back by normal priority publications awaiting acknowledgement, as
+ *            MQTTSN_PACKET_FIFO_RESERVED_LENGTH packet queue slots are kept for high priority ones.
+ *          - It is not subject to @ref mqttsn_client_replay_interval_set.
+ *          - It wakes a sleeping client immediately.
+ *
+ * @param[inout] p_client       Pointer to initialized client.
+ * @param[in]    topic_id       Value of previously registered topic ID.
+ * @param[in]    p_payload      Data to be published.
+ * @param[in]    payload_len    Length of data to be published.
+ * @param[in]    priority       Priority class of the publication.
+ * @param[out]   msg_id         (optional) Pointer to message ID assigned to the message by client.
+ *                              Set to 0 for a queued publication, whose ID is assigned when sent.
+ *
+ * @return       NRF_SUCCESS if the publish request has been sent or queued successfully.
+ *               NRF_ERROR_INVALID_PARAM if the priority class is not known.
+ *               Otherwise error code returned by @ref mqttsn_client_publish.
+ */
+uint32_t mqttsn_client_publish_with_priority(mqttsn_client_t * p_client,
+                                             uint16_t          topic_id,
+                                             const uint8_t   * p_payload,
+                                             uint16_t          payload_len,
+                                             mqttsn_priority_t priority,
+                                             uint16_t        * msg_id);
+
+
+/**@brief Sets the minimum time between queued publications sent to the gateway.
+ *
+ * @details Limits the rate at which publications queued while the client could not send them are
+ *          replayed, so that a long backlog does not flood the link after reconnecting.
+ *
+ * @param[inout] p_client       Pointer to initialized client.
+ * @param[in]    interval_ms    Minimum time between queued publications in milliseconds, 0 for no
+ *                              limit (default).
+ *
+ * @return       NRF_SUCCESS if the value has been set successfully.
+ *               Otherwise error code is returned.
+ */
+uint32_t mqttsn_client_replay_interval_set(mqttsn_client_t * p_client, uint32_t interval_ms);
+
+
+/**@brief Appends a record to the aggregated publication of a given topic.
+ *
+ * @details Records are staged and published together, each one preceded by a single byte holding
+ *          its length, so that the receiver can split them again. The staged records are published
+ *          once the next record would not fit a single transport frame (see
+ *          @ref mqttsn_client_mtu_set) or MQTTSN_AGGREGATOR_PAYLOAD_MAX_LENGTH, once
+ *          MQTTSN_AGGREGATOR_RECORD_MAX_COUNT records are staged, or MQTTSN_AGGREGATOR_LATENCY_MS
+ *          after the first of them has been appended, whichever comes first. An aggregated
+ *          publication which cannot be sent for lack of memory is retried after another
+ *          MQTTSN_AGGREGATOR_LATENCY_MS. One rejected for another reason is dropped.
+ *
+ * @param[inout] p_client       Pointer to initialized client.
+ * @param[in]    topic_id       Value of previously registered topic ID.
+ * @param[in]    p_record       Record to be published.
+ * @param[in]    record_len     Length of the record.
+ *
+ * @return       NRF_SUCCESS if the record has been staged successfully.
+ *               NRF_ERROR_INVALID_LENGTH if the record does not fit an aggregated publication.
+ *               NRF_ERROR_NO_MEM if no more topics can be aggregated, or the staged records could not
+ *               be published for lack of memory to make room for the record. They stay staged.
+ *               Otherwise error code is returned. If it comes from publishing the staged records,
+ *               they have been dropped and the record has not been staged.
+ */
+uint32_t mqttsn_client_publish_append(mqttsn_client_t * p_client,
+                                      uint16_t          topic_id,
+                                      const uint8_t   * p_record,
+                                      uint16_t          record_len);
+
+
+/**@brief Publishes all staged records without waiting for their deadline.
+ *
+ * @param[inout] p_client       Pointer to initialized client.
+ *
+ * @return       NRF_SUCCESS if all aggregated publications have been sent or queued successfully.
+ *               Otherwise error code of the first failed publication is returned. Records which
+ *               could not be published for lack of memory stay staged, the others are dropped.
+ */
+uint32_t mqttsn_client_publish_flush(mqttsn_client_t * p_client);
+
+
+/**@brief Sets the largest message the transport carries in one frame.
+ *
+ * @details Limits the size of aggregated publications. On BLE, this is the negotiated ATT MTU less
+ *          the ATT header. Defaults to MQTTSN_DEFAULT_MTU.
+ *
+ * @param[inout] p_client       Pointer to initialized client.
+ * @param[in]    mtu            Largest message length in bytes.
+ *
+ * @return       NRF_SUCCESS if the value has been set successfully.
+ *               Otherwise error code is returned.
+ */
+uint32_t mqttsn_client_mtu_set(mqttsn_client_t * p_client, uint16_t mtu);
+
+
 /**@brief Subscribes to given topic.  
  *
  * @param[inout] p_client       Pointer to initialized and connected client.
@@ -435,6 +909,48 @@ uint32_t mqttsn_client_willmsgupd(mqttsn_client_t * p_client,
                                   uint16_t          will_msg_len);
 
 
+/**@brief Delivers received publications to the application.
+ *
+ * @details Publications are queued as they are received and passed to the event handler as
+ *          @ref MQTTSN_EVENT_RECEIVED from this function only, so that a slow handler does not
+ *          hold up the receive path. It should be called from the application's main loop.
+ *
+ * @param[inout] p_client Pointer to initialized client.
+ *
+ * @retval       NRF_SUCCESS          If the queued publications have been delivered.
+ * @retval       NRF_ERROR_NULL       If @p p_client is NULL.
+ * @retval       NRF_ERROR_FORBIDDEN  If the client is not initialized.
+ */
+uint32_t mqttsn_client_process(mqttsn_client_t * p_client);
+
+/**@brief Sets handling of publications received while the delivery queue is full.
+ *
+ * @param[inout] p_client Pointer to initialized client.
+ * @param[in]    policy   Delivery policy. Defaults to @ref MQTTSN_DEFAULT_DELIVERY_POLICY.
+ *
+ * @retval       NRF_SUCCESS              If the policy has been set.
+ * @retval       NRF_ERROR_NULL           If @p p_client is NULL.
+ * @retval       NRF_ERROR_INVALID_PARAM  If the policy is unknown.
+ */
+uint32_t mqttsn_client_delivery_policy_set(mqttsn_client_t * p_client, mqttsn_delivery_policy_t policy);
+
+/**@brief Gets counters of received publications.
+ *
+ * @param[in]    p_client Pointer to initialized client.
+ *
+ * @return       Pointer to the counters, or NULL if @p p_client is NULL.
+ */
+const mqttsn_delivery_stats_t * mqttsn_client_delivery_stats_get(const mqttsn_client_t * p_client);
+
+/**@brief Gets counters of messages received by the client.
+ *
+ * @param[in]    p_client Pointer to initialized client.
+ *
+ * @return       Pointer to the counters, or NULL if @p p_client is NULL.
+ */
+const mqttsn_rx_stats_t * mqttsn_client_rx_stats_get(const mqttsn_client_t * p_client);
+
+
 /**@brief Unitializes the MQTT-SN client.  
  *
  * @details Unitializes transport layer and packet queue.
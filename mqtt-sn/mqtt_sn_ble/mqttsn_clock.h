@@ -0,0 +1,103 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/**@file mqttsn_clock.h
+ *
+ * @brief Helpers for the MQTT-SN client's 64-bit millisecond clock.
+ *
+ * @details All protocol deadlines are absolute times in milliseconds of a 64-bit monotonic clock,
+ *          which does not wrap during the lifetime of the device. Hardware counters narrower
+ *          than 64 bits are extended in software with @ref mqttsn_clock_counter_extend.
+ */
+
+#ifndef MQTTSN_CLOCK_H
+#define MQTTSN_CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**@brief Deadline value meaning that no event is scheduled. */
+#define MQTTSN_CLOCK_DEADLINE_NONE UINT64_MAX
+
+/**@brief State of a hardware counter extended to 64 bits. */
+typedef struct mqttsn_clock_counter_t
+{
+    uint32_t last;  /**< Counter value read most recently. */
+    uint64_t base;  /**< Sum of counter periods elapsed before the last read. */
+} mqttsn_clock_counter_t;
+
+
+/**@brief Extends a wrapping hardware counter to 64 bits.
+ *
+ * @note Must be called at least once per counter period, otherwise a wrap is missed.
+ *
+ * @param[inout] p_counter   Counter state.
+ * @param[in]    value       Current hardware counter value.
+ * @param[in]    bits        Width of the hardware counter in bits.
+ *
+ * @return       Extended counter value.
+ */
+static inline uint64_t mqttsn_clock_counter_extend(mqttsn_clock_counter_t * p_counter,
+                                                   uint32_t                 value,
+                                                   uint32_t                 bits)
+{
+    if (value < p_counter->last)
+    {
+        p_counter->base += (uint64_t)1 << bits;
+    }
+
+    p_counter->last = value;
+
+    return p_counter->base + value;
+}
+
+
+/**@brief Calculates a deadline.
+ *
+ * @param[in]    now         Current time in milliseconds.
+ * @param[in]    timeout_ms  Time from now in milliseconds.
+ *
+ * @return       Absolute deadline in milliseconds.
+ */
+static inline uint64_t mqttsn_clock_deadline_get(uint64_t now, uint32_t timeout_ms)
+{
+    return now + timeout_ms;
+}
+
+
+/**@brief Checks if a deadline has passed.
+ *
+ * @param[in]    deadline    Absolute deadline in milliseconds.
+ * @param[in]    now         Current time in milliseconds.
+ *
+ * @retval       true        If the deadline has passed.
+ * @retval       false       Otherwise, or if the deadline is @ref MQTTSN_CLOCK_DEADLINE_NONE.
+ */
+static inline bool mqttsn_clock_deadline_passed(uint64_t deadline, uint64_t now)
+{
+    return deadline != MQTTSN_CLOCK_DEADLINE_NONE && deadline <= now;
+}
+
+
+/**@brief Calculates time left until a deadline.
+ *
+ * @param[in]    deadline    Absolute deadline in milliseconds.
+ * @param[in]    now         Current time in milliseconds.
+ *
+ * @return       Milliseconds left, or 0 if the deadline has passed.
+ */
+static inline uint64_t mqttsn_clock_deadline_remaining(uint64_t deadline, uint64_t now)
+{
+    return (deadline > now) ? (deadline - now) : 0;
+}
+
+#endif // MQTTSN_CLOCK_H
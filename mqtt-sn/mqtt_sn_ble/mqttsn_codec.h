@@ -0,0 +1,620 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/**@file mqttsn_codec.h
+ *
+ * @brief Inline codec for the MQTT-SN messages exchanged most often.
+ *
+ * @details PUBLISH, PUBACK, REGISTER, REGACK, SUBACK, PINGREQ and PINGRESP are encoded and decoded
+ *          at fixed offsets with a single bounds check per message, without the out-of-line field
+ *          accessors of the Eclipse Paho codec. The output is byte-identical to Paho's, except for
+ *          messages of exactly 256 bytes, whose Length field Paho gets wrong. Decoders additionally
+ *          reject messages whose Length field does not cover the fixed fields.
+ */
+
+#ifndef MQTTSN_CODEC_H
+#define MQTTSN_CODEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "MQTTSNPacket.h"
+
+/**@brief Length field value announcing a three-byte Length field. */
+#define MQTTSN_CODEC_LENGTH_THREE_BYTES       0x01
+
+/**@brief Largest message length encoded in a one-byte Length field. */
+#define MQTTSN_CODEC_LENGTH_ONE_BYTE_MAX      255
+
+/**@brief Offset of Flags field from Message Type field in PUBLISH message. */
+#define MQTTSN_OFFSET_PUBLISH_FLAGS           1
+
+/**@brief Offset of Topic ID field from Message Type field in PUBLISH message. */
+#define MQTTSN_OFFSET_PUBLISH_TOPIC_ID        2
+
+/**@brief Offset of Message ID field from Message Type field in PUBLISH message. */
+#define MQTTSN_OFFSET_PUBLISH_MSG_ID          4
+
+/**@brief Length of PUBLISH message fields from Message Type field to payload. */
+#define MQTTSN_CODEC_PUBLISH_FIXED_LENGTH     6
+
+/**@brief Longest PUBLISH header, with a three-byte Length field. */
+#define MQTTSN_CODEC_PUBLISH_HEADER_MAX_LENGTH (MQTTSN_CODEC_PUBLISH_FIXED_LENGTH + 3)
+
+/**@brief Length of PUBLISH header template, from Message Type field to Message ID field. */
+#define MQTTSN_CODEC_PUBLISH_TEMPLATE_LENGTH  MQTTSN_OFFSET_PUBLISH_MSG_ID
+
+/**@brief Length of PUBACK and REGACK message fields from Message Type field on. */
+#define MQTTSN_CODEC_ACK_FIXED_LENGTH         6
+
+/**@brief Length of SUBACK message fields from Message Type field on. */
+#define MQTTSN_CODEC_SUBACK_FIXED_LENGTH      7
+
+/**@brief Length of REGISTER message fields from Message Type field to topic name. */
+#define MQTTSN_CODEC_REGISTER_FIXED_LENGTH    5
+
+/**@brief DUP flag of PUBLISH message. */
+#define MQTTSN_FLAG_DUP                       0x80
+
+/**@brief QoS bits of PUBLISH message flags. */
+#define MQTTSN_FLAG_QOS_MASK                  0x60
+
+/**@brief Position of QoS bits in PUBLISH message flags. */
+#define MQTTSN_FLAG_QOS_POS                   5
+
+/**@brief Retain flag of PUBLISH message. */
+#define MQTTSN_FLAG_RETAIN                    0x10
+
+/**@brief Topic ID type bits of PUBLISH message flags. */
+#define MQTTSN_FLAG_TOPIC_ID_TYPE_MASK        0x03
+
+
+/**@brief Writes a 16-bit field in network byte order. */
+static inline void mqttsn_codec_uint16_write(uint8_t * p_buf, uint16_t value)
+{
+    p_buf[0] = (uint8_t)(value >> 8);
+    p_buf[1] = (uint8_t)(value);
+}
+
+
+/**@brief Reads a 16-bit field in network byte order. */
+static inline uint16_t mqttsn_codec_uint16_read(const uint8_t * p_buf)
+{
+    return (uint16_t)((p_buf[0] << 8) | p_buf[1]);
+}
+
+
+/**@brief Writes Length and Message Type fields.
+ *
+ * @param[out]   p_buf       Buffer, large enough for the whole message.
+ * @param[in]    body_len    Length of the message from Message Type field on.
+ * @param[in]    msg_type    Message type.
+ *
+ * @return       Offset of the field following Message Type field.
+ */
+static inline uint16_t mqttsn_codec_header_write(uint8_t * p_buf, uint16_t body_len, uint8_t msg_type)
+{
+    if (body_len + 1 > MQTTSN_CODEC_LENGTH_ONE_BYTE_MAX)
+    {
+        p_buf[0] = MQTTSN_CODEC_LENGTH_THREE_BYTES;
+        mqttsn_codec_uint16_write(&p_buf[1], body_len + 3);
+        p_buf[3] = msg_type;
+        return 4;
+    }
+
+    p_buf[0] = (uint8_t)(body_len + 1);
+    p_buf[1] = msg_type;
+    return 2;
+}
+
+
+/**@brief Calculates length of a message.
+ *
+ * @param[in]    body_len    Length of the message from Message Type field on.
+ *
+ * @return       Length of the whole message.
+ */
+static inline uint32_t mqttsn_codec_length_get(uint16_t body_len)
+{
+    return (body_len + 1 > MQTTSN_CODEC_LENGTH_ONE_BYTE_MAX) ? body_len + 3 : body_len + 1;
+}
+
+
+/**@brief Reads Length field of a received message.
+ *
+ * @param[in]    p_buf       Received data.
+ * @param[in]    buflen      Length of the received data.
+ * @param[out]   p_offset    Offset of Message Type field.
+ *
+ * @return       Length of the message, or 0 if the Length field is malformed, does not cover the
+ *               Message Type field, or exceeds the received data.
+ */
+static inline uint16_t mqttsn_codec_length_read(const uint8_t * p_buf,
+                                                uint16_t        buflen,
+                                                uint16_t      * p_offset)
+{
+    uint16_t offset;
+    uint16_t length;
+
+    if (buflen < 2)
+    {
+        return 0;
+    }
+
+    if (p_buf[0] == MQTTSN_CODEC_LENGTH_THREE_BYTES)
+    {
+        if (buflen < 4)
+        {
+            return 0;
+        }
+        offset = 3;
+        length = mqttsn_codec_uint16_read(&p_buf[1]);
+    }
+    else
+    {
+        offset = 1;
+        length = p_buf[0];
+    }
+
+    if (length > buflen || length < offset + 1)
+    {
+        return 0;
+    }
+
+    *p_offset = offset;
+    return length;
+}
+
+
+/**@brief Checks Length and Message Type fields of a received message.
+ *
+ * @param[in]    p_buf       Received data.
+ * @param[in]    buflen      Length of the received data.
+ * @param[in]    msg_type    Expected message type.
+ * @param[in]    fixed_len   Minimum length of the message from Message Type field on.
+ * @param[out]   p_body_len  Length of the message from Message Type field on.
+ *
+ * @return       Offset of Message Type field, or 0 if the message is malformed or of another type.
+ */
+static inline uint16_t mqttsn_codec_header_read(const uint8_t * p_buf,
+                                                uint16_t        buflen,
+                                                uint8_t         msg_type,
+                                                uint16_t        fixed_len,
+                                                uint16_t      * p_body_len)
+{
+    uint16_t offset = 0;
+    uint16_t length = mqttsn_codec_length_read(p_buf, buflen, &offset);
+
+    if (length == 0 || length < offset + fixed_len || p_buf[offset] != msg_type)
+    {
+        return 0;
+    }
+
+    *p_body_len = length - offset;
+    return offset;
+}
+
+
+/**@brief Builds PUBLISH header template holding the fields which do not change between messages.
+ *
+ * @param[out]   p_template  Template of MQTTSN_CODEC_PUBLISH_TEMPLATE_LENGTH bytes.
+ * @param[in]    flags       Flags field.
+ * @param[in]    topic_id    Topic ID.
+ */
+static inline void mqttsn_codec_publish_template_build(uint8_t * p_template, uint8_t flags, uint16_t topic_id)
+{
+    p_template[0]                           = MQTTSN_PUBLISH;
+    p_template[MQTTSN_OFFSET_PUBLISH_FLAGS] = flags;
+    mqttsn_codec_uint16_write(&p_template[MQTTSN_OFFSET_PUBLISH_TOPIC_ID], topic_id);
+}
+
+
+/**@brief Encodes PUBLISH message up to the payload from a header template.
+ *
+ * @details Only Length, Message ID and the DUP flag are written on top of the template.
+ *
+ * @param[out]   p_buf       Buffer.
+ * @param[in]    buflen      Length of the buffer.
+ * @param[in]    p_template  Template built with @ref mqttsn_codec_publish_template_build.
+ * @param[in]    packet_id   Message ID.
+ * @param[in]    payload_len Length of the payload that will follow the header.
+ * @param[in]    dup         True if the message is a retransmission.
+ *
+ * @return       Length of the header, or 0 if it does not fit the buffer.
+ */
+static inline uint16_t mqttsn_codec_publish_header_patch(uint8_t       * p_buf,
+                                                         uint32_t        buflen,
+                                                         const uint8_t * p_template,
+                                                         uint16_t        packet_id,
+                                                         uint16_t        payload_len,
+                                                         bool            dup)
+{
+    uint32_t body_len   = MQTTSN_CODEC_PUBLISH_FIXED_LENGTH + (uint32_t)payload_len;
+    uint32_t header_len = mqttsn_codec_length_get((uint16_t)body_len) - payload_len;
+
+    if (body_len > UINT16_MAX - 3 || header_len > buflen)
+    {
+        return 0;
+    }
+
+    uint8_t * p_type = &p_buf[header_len - MQTTSN_CODEC_PUBLISH_FIXED_LENGTH];
+
+    if (header_len - MQTTSN_CODEC_PUBLISH_FIXED_LENGTH == 3)
+    {
+        p_buf[0] = MQTTSN_CODEC_LENGTH_THREE_BYTES;
+        mqttsn_codec_uint16_write(&p_buf[1], (uint16_t)(body_len + 3));
+    }
+    else
+    {
+        p_buf[0] = (uint8_t)(body_len + 1);
+    }
+
+    memcpy(p_type, p_template, MQTTSN_CODEC_PUBLISH_TEMPLATE_LENGTH);
+    mqttsn_codec_uint16_write(&p_type[MQTTSN_OFFSET_PUBLISH_MSG_ID], packet_id);
+
+    if (dup)
+    {
+        p_type[MQTTSN_OFFSET_PUBLISH_FLAGS] |= MQTTSN_FLAG_DUP;
+    }
+
+    return (uint16_t)header_len;
+}
+
+
+/**@brief Encodes PUBLISH message up to the payload, which is sent as a separate segment.
+ *
+ * @param[out]   p_buf       Buffer.
+ * @param[in]    buflen      Length of the buffer.
+ * @param[in]    flags       Flags field.
+ * @param[in]    topic_id    Topic ID.
+ * @param[in]    packet_id   Message ID.
+ * @param[in]    payload_len Length of the payload that will follow the header.
+ *
+ * @return       Length of the header, or 0 if it does not fit the buffer.
+ */
+static inline uint16_t mqttsn_codec_publish_header_encode(uint8_t  * p_buf,
+                                                          uint32_t   buflen,
+                                                          uint8_t    flags,
+                                                          uint16_t   topic_id,
+                                                          uint16_t   packet_id,
+                                                          uint16_t   payload_len)
+{
+    uint8_t template[MQTTSN_CODEC_PUBLISH_TEMPLATE_LENGTH];
+
+    mqttsn_codec_publish_template_build(template, flags, topic_id);
+
+    return mqttsn_codec_publish_header_patch(p_buf, buflen, template, packet_id, payload_len, false);
+}
+
+
+/**@brief Encodes PUBLISH message with a two-byte topic ID.
+ *
+ * @param[out]   p_buf       Buffer.
+ * @param[in]    buflen      Length of the buffer.
+ * @param[in]    flags       Flags field.
+ * @param[in]    topic_id    Topic ID.
+ * @param[in]    packet_id   Message ID.
+ * @param[in]    p_payload   Payload.
+ * @param[in]    payload_len Length of the payload.
+ *
+ * @return       Length of the message, or 0 if it does not fit the buffer.
+ */
+static inline uint16_t mqttsn_codec_publish_encode(uint8_t       * p_buf,
+                                                   uint32_t        buflen,
+                                                   uint8_t         flags,
+                                                   uint16_t        topic_id,
+                                                   uint16_t        packet_id,
+                                                   const uint8_t * p_payload,
+                                                   uint16_t        payload_len)
+{
+    if (buflen < payload_len)
+    {
+        return 0;
+    }
+
+    uint16_t header_len = mqttsn_codec_publish_header_encode(p_buf,
+                                                             buflen - payload_len,
+                                                             flags,
+                                                             topic_id,
+                                                             packet_id,
+                                                             payload_len);
+    if (header_len == 0)
+    {
+        return 0;
+    }
+
+    memcpy(&p_buf[header_len], p_payload, payload_len);
+
+    return header_len + payload_len;
+}
+
+
+/**@brief Decodes PUBLISH message.
+ *
+ * @details For a QoS -1 PUBLISH with a long topic name, the name is skipped and its length is
+ *          returned as the topic ID, as Paho does.
+ *
+ * @param[in]    p_buf         Received data.
+ * @param[in]    buflen        Length of the received data.
+ * @param[out]   p_flags       Flags field.
+ * @param[out]   p_topic_id    Topic ID.
+ * @param[out]   p_packet_id   Message ID.
+ * @param[out]   pp_payload    Pointer to the payload within the received data.
+ * @param[out]   p_payload_len Length of the payload.
+ *
+ * @retval       true          If the message has been decoded successfully.
+ * @retval       false         If the message is malformed.
+ */
+static inline bool mqttsn_codec_publish_decode(const uint8_t  * p_buf,
+                                               uint16_t         buflen,
+                                               uint8_t        * p_flags,
+                                               uint16_t       * p_topic_id,
+                                               uint16_t       * p_packet_id,
+                                               const uint8_t ** pp_payload,
+                                               uint16_t       * p_payload_len)
+{
+    uint16_t body_len;
+    uint16_t offset = mqttsn_codec_header_read(p_buf, buflen, MQTTSN_PUBLISH, MQTTSN_CODEC_PUBLISH_FIXED_LENGTH, &body_len);
+
+    if (offset == 0)
+    {
+        return false;
+    }
+
+    const uint8_t * p_type     = &p_buf[offset];
+    uint16_t        header_len = MQTTSN_CODEC_PUBLISH_FIXED_LENGTH;
+
+    *p_flags     = p_type[MQTTSN_OFFSET_PUBLISH_FLAGS];
+    *p_topic_id  = mqttsn_codec_uint16_read(&p_type[MQTTSN_OFFSET_PUBLISH_TOPIC_ID]);
+    *p_packet_id = mqttsn_codec_uint16_read(&p_type[MQTTSN_OFFSET_PUBLISH_MSG_ID]);
+
+    if ((*p_flags & MQTTSN_FLAG_TOPIC_ID_TYPE_MASK) == MQTTSN_TOPIC_TYPE_NORMAL &&
+        (*p_flags & MQTTSN_FLAG_QOS_MASK) == MQTTSN_FLAG_QOS_MASK)
+    {
+        header_len += *p_topic_id;
+        if (header_len > body_len)
+        {
+            return false;
+        }
+    }
+
+    *pp_payload    = &p_type[header_len];
+    *p_payload_len = body_len - header_len;
+
+    return true;
+}
+
+
+/**@brief Encodes PUBACK or REGACK message.
+ *
+ * @param[out]   p_buf       Buffer.
+ * @param[in]    buflen      Length of the buffer.
+ * @param[in]    msg_type    MQTTSN_PUBACK or MQTTSN_REGACK.
+ * @param[in]    topic_id    Topic ID.
+ * @param[in]    packet_id   Message ID.
+ * @param[in]    return_code Return code.
+ *
+ * @return       Length of the message, or 0 if it does not fit the buffer.
+ */
+static inline uint16_t mqttsn_codec_ack_encode(uint8_t * p_buf,
+                                               uint32_t  buflen,
+                                               uint8_t   msg_type,
+                                               uint16_t  topic_id,
+                                               uint16_t  packet_id,
+                                               uint8_t   return_code)
+{
+    if (buflen < MQTTSN_CODEC_ACK_FIXED_LENGTH + 1)
+    {
+        return 0;
+    }
+
+    p_buf[0] = MQTTSN_CODEC_ACK_FIXED_LENGTH + 1;
+    p_buf[1] = msg_type;
+    mqttsn_codec_uint16_write(&p_buf[2], topic_id);
+    mqttsn_codec_uint16_write(&p_buf[4], packet_id);
+    p_buf[6] = return_code;
+
+    return MQTTSN_CODEC_ACK_FIXED_LENGTH + 1;
+}
+
+
+/**@brief Decodes PUBACK or REGACK message.
+ *
+ * @param[in]    p_buf         Received data.
+ * @param[in]    buflen        Length of the received data.
+ * @param[in]    msg_type      MQTTSN_PUBACK or MQTTSN_REGACK.
+ * @param[out]   p_topic_id    Topic ID.
+ * @param[out]   p_packet_id   Message ID.
+ * @param[out]   p_return_code Return code.
+ *
+ * @retval       true          If the message has been decoded successfully.
+ * @retval       false         If the message is malformed.
+ */
+static inline bool mqttsn_codec_ack_decode(const uint8_t * p_buf,
+                                           uint16_t        buflen,
+                                           uint8_t         msg_type,
+                                           uint16_t      * p_topic_id,
+                                           uint16_t      * p_packet_id,
+                                           uint8_t       * p_return_code)
+{
+    uint16_t body_len;
+    uint16_t offset = mqttsn_codec_header_read(p_buf, buflen, msg_type, MQTTSN_CODEC_ACK_FIXED_LENGTH, &body_len);
+
+    if (offset == 0)
+    {
+        return false;
+    }
+
+    *p_topic_id    = mqttsn_codec_uint16_read(&p_buf[offset + 1]);
+    *p_packet_id   = mqttsn_codec_uint16_read(&p_buf[offset + 3]);
+    *p_return_code = p_buf[offset + 5];
+
+    return true;
+}
+
+
+/**@brief Decodes SUBACK message.
+ *
+ * @param[in]    p_buf         Received data.
+ * @param[in]    buflen        Length of the received data.
+ * @param[out]   p_flags       Flags field.
+ * @param[out]   p_topic_id    Topic ID.
+ * @param[out]   p_packet_id   Message ID.
+ * @param[out]   p_return_code Return code.
+ *
+ * @retval       true          If the message has been decoded successfully.
+ * @retval       false         If the message is malformed.
+ */
+static inline bool mqttsn_codec_suback_decode(const uint8_t * p_buf,
+                                              uint16_t        buflen,
+                                              uint8_t       * p_flags,
+                                              uint16_t      * p_topic_id,
+                                              uint16_t      * p_packet_id,
+                                              uint8_t       * p_return_code)
+{
+    uint16_t body_len;
+    uint16_t offset = mqttsn_codec_header_read(p_buf, buflen, MQTTSN_SUBACK, MQTTSN_CODEC_SUBACK_FIXED_LENGTH, &body_len);
+
+    if (offset == 0)
+    {
+        return false;
+    }
+
+    *p_flags       = p_buf[offset + 1];
+    *p_topic_id    = mqttsn_codec_uint16_read(&p_buf[offset + 2]);
+    *p_packet_id   = mqttsn_codec_uint16_read(&p_buf[offset + 4]);
+    *p_return_code = p_buf[offset + 6];
+
+    return true;
+}
+
+
+/**@brief Encodes REGISTER message.
+ *
+ * @param[out]   p_buf          Buffer.
+ * @param[in]    buflen         Length of the buffer.
+ * @param[in]    topic_id       Topic ID, 0 when sent by a client.
+ * @param[in]    packet_id      Message ID.
+ * @param[in]    p_topic_name   Topic name.
+ * @param[in]    topic_name_len Length of the topic name.
+ *
+ * @return       Length of the message, or 0 if it does not fit the buffer.
+ */
+static inline uint16_t mqttsn_codec_register_encode(uint8_t       * p_buf,
+                                                    uint32_t        buflen,
+                                                    uint16_t        topic_id,
+                                                    uint16_t        packet_id,
+                                                    const uint8_t * p_topic_name,
+                                                    uint16_t        topic_name_len)
+{
+    uint32_t body_len = MQTTSN_CODEC_REGISTER_FIXED_LENGTH + (uint32_t)topic_name_len;
+    uint32_t length   = mqttsn_codec_length_get((uint16_t)body_len);
+
+    if (body_len > UINT16_MAX - 3 || length > buflen)
+    {
+        return 0;
+    }
+
+    uint8_t * p_type = &p_buf[mqttsn_codec_header_write(p_buf, (uint16_t)body_len, MQTTSN_REGISTER) - 1];
+
+    mqttsn_codec_uint16_write(&p_type[1], topic_id);
+    mqttsn_codec_uint16_write(&p_type[3], packet_id);
+    memcpy(&p_type[MQTTSN_CODEC_REGISTER_FIXED_LENGTH], p_topic_name, topic_name_len);
+
+    return (uint16_t)length;
+}
+
+
+/**@brief Decodes REGISTER message.
+ *
+ * @param[in]    p_buf            Received data.
+ * @param[in]    buflen           Length of the received data.
+ * @param[out]   p_topic_id       Topic ID.
+ * @param[out]   p_packet_id      Message ID.
+ * @param[out]   pp_topic_name    Pointer to the topic name within the received data. Not terminated.
+ * @param[out]   p_topic_name_len Length of the topic name.
+ *
+ * @retval       true             If the message has been decoded successfully.
+ * @retval       false            If the message is malformed.
+ */
+static inline bool mqttsn_codec_register_decode(const uint8_t  * p_buf,
+                                                uint16_t         buflen,
+                                                uint16_t       * p_topic_id,
+                                                uint16_t       * p_packet_id,
+                                                const uint8_t ** pp_topic_name,
+                                                uint16_t       * p_topic_name_len)
+{
+    uint16_t body_len;
+    uint16_t offset = mqttsn_codec_header_read(p_buf, buflen, MQTTSN_REGISTER, MQTTSN_CODEC_REGISTER_FIXED_LENGTH, &body_len);
+
+    if (offset == 0)
+    {
+        return false;
+    }
+
+    *p_topic_id       = mqttsn_codec_uint16_read(&p_buf[offset + 1]);
+    *p_packet_id      = mqttsn_codec_uint16_read(&p_buf[offset + 3]);
+    *pp_topic_name    = &p_buf[offset + MQTTSN_CODEC_REGISTER_FIXED_LENGTH];
+    *p_topic_name_len = body_len - MQTTSN_CODEC_REGISTER_FIXED_LENGTH;
+
+    return true;
+}
+
+
+/**@brief Encodes PINGREQ message.
+ *
+ * @param[out]   p_buf         Buffer.
+ * @param[in]    buflen        Length of the buffer.
+ * @param[in]    p_client_id   Client ID, or NULL to omit it.
+ * @param[in]    client_id_len Length of the Client ID.
+ *
+ * @return       Length of the message, or 0 if it does not fit the buffer.
+ */
+static inline uint16_t mqttsn_codec_pingreq_encode(uint8_t       * p_buf,
+                                                   uint32_t        buflen,
+                                                   const uint8_t * p_client_id,
+                                                   uint8_t         client_id_len)
+{
+    uint16_t length = (p_client_id != NULL) ? 2 + client_id_len : 2;
+
+    if (length > buflen)
+    {
+        return 0;
+    }
+
+    p_buf[0] = (uint8_t)length;
+    p_buf[1] = MQTTSN_PINGREQ;
+    if (p_client_id != NULL)
+    {
+        memcpy(&p_buf[2], p_client_id, client_id_len);
+    }
+
+    return length;
+}
+
+
+/**@brief Checks if received data is a PINGRESP message.
+ *
+ * @param[in]    p_buf       Received data.
+ * @param[in]    buflen      Length of the received data.
+ *
+ * @retval       true        If the data is a well-formed PINGRESP message.
+ * @retval       false       Otherwise.
+ */
+static inline bool mqttsn_codec_pingresp_decode(const uint8_t * p_buf, uint16_t buflen)
+{
+    uint16_t body_len;
+
+    return mqttsn_codec_header_read(p_buf, buflen, MQTTSN_PINGRESP, 1, &body_len) != 0;
+}
+
+#endif // MQTTSN_CODEC_H
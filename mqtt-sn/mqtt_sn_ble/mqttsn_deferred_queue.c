@@ -0,0 +1,135 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "mqttsn_packet_internal.h"
+
+void mqttsn_deferred_queue_init(mqttsn_client_t * p_client)
+{
+    memset(&(p_client->deferred_queue), 0, sizeof(mqttsn_deferred_queue_t));
+    p_client->deferred_queue.replay_last    = MQTTSN_CLOCK_DEADLINE_NONE;
+    p_client->deferred_queue.replay_timeout = MQTTSN_CLOCK_DEADLINE_NONE;
+    mqttsn_retained_changed(p_client, MQTTSN_RETAINED_DEFERRED);
+}
+
+/**@brief Gets a publication by its position in the queue.
+ *
+ * @param[in]    p_queue     Deferred queue.
+ * @param[in]    position    Position of the publication, 0 for the one to be sent first.
+ *
+ * @return       Pointer to the publication.
+ */
+static mqttsn_deferred_publish_t * elem_get(mqttsn_deferred_queue_t * p_queue, uint8_t position)
+{
+    return &(p_queue->publish[(p_queue->head + position) % MQTTSN_DEFERRED_QUEUE_MAX_LENGTH]);
+}
+
+uint32_t mqttsn_deferred_queue_elem_add(mqttsn_client_t * p_client,
+                                        uint16_t          topic_id,
+                                        const uint8_t   * p_payload,
+                                        uint16_t          payload_len,
+                                        mqttsn_priority_t priority)
+{
+    mqttsn_deferred_queue_t * p_queue  = &(p_client->deferred_queue);
+    uint8_t                   position = p_queue->num_of_elements;
+
+    if (payload_len > MQTTSN_DEFERRED_PAYLOAD_MAX_LENGTH)
+    {
+        NRF_LOG_ERROR("Payload too long to be queued\r\n");
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    if (priority == MQTTSN_PRIORITY_HIGH)
+    {
+        position = 0;
+
+        while (position < p_queue->num_of_elements && elem_get(p_queue, position)->priority == MQTTSN_PRIORITY_HIGH)
+        {
+            position++;
+        }
+
+        if (mqttsn_deferred_queue_is_full(p_client) && position < p_queue->num_of_elements)
+        {
+            NRF_LOG_ERROR("Deferred publish queue full, newest normal priority publication dropped\r\n");
+            p_queue->num_of_elements--;
+            mqttsn_retained_changed(p_client, MQTTSN_RETAINED_DEFERRED);
+        }
+    }
+
+    if (mqttsn_deferred_queue_is_full(p_client))
+    {
+        NRF_LOG_ERROR("Deferred publish queue capacity exceeded\r\n");
+        return NRF_ERROR_NO_MEM;
+    }
+
+    for (uint8_t i = p_queue->num_of_elements; i > position; i--)
+    {
+        *elem_get(p_queue, i) = *elem_get(p_queue, i - 1);
+    }
+
+    mqttsn_deferred_publish_t * p_publish = elem_get(p_queue, position);
+
+    p_publish->topic_id    = topic_id;
+    p_publish->payload_len = payload_len;
+    p_publish->priority    = priority;
+    memcpy(p_publish->p_payload, p_payload, payload_len);
+
+    p_queue->num_of_elements++;
+    mqttsn_retained_changed(p_client, MQTTSN_RETAINED_DEFERRED);
+
+    return NRF_SUCCESS;
+}
+
+mqttsn_deferred_publish_t * mqttsn_deferred_queue_front_get(mqttsn_client_t * p_client)
+{
+    if (p_client->deferred_queue.num_of_elements == 0)
+    {
+        return NULL;
+    }
+
+    return &(p_client->deferred_queue.publish[p_client->deferred_queue.head]);
+}
+
+mqttsn_deferred_publish_t * mqttsn_deferred_queue_elem_get(mqttsn_client_t * p_client, uint8_t position)
+{
+    if (position >= p_client->deferred_queue.num_of_elements)
+    {
+        return NULL;
+    }
+
+    return elem_get(&(p_client->deferred_queue), position);
+}
+
+void mqttsn_deferred_queue_elem_drop(mqttsn_client_t * p_client, uint8_t position)
+{
+    mqttsn_deferred_queue_t * p_queue = &(p_client->deferred_queue);
+
+    if (position >= p_queue->num_of_elements)
+    {
+        return;
+    }
+
+    /* The publications ahead move up, which is cheaper for the front one the client usually
+     * sends. */
+    for (uint8_t i = position; i > 0; i--)
+    {
+        *elem_get(p_queue, i) = *elem_get(p_queue, i - 1);
+    }
+
+    p_queue->head = (p_queue->head + 1) % MQTTSN_DEFERRED_QUEUE_MAX_LENGTH;
+    p_queue->num_of_elements--;
+    mqttsn_retained_changed(p_client, MQTTSN_RETAINED_DEFERRED);
+}
+
+bool mqttsn_deferred_queue_is_full(const mqttsn_client_t * p_client)
+{
+    return p_client->deferred_queue.num_of_elements == MQTTSN_DEFERRED_QUEUE_MAX_LENGTH;
+}
@@ -0,0 +1,238 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "mqttsn_packet_internal.h"
+
+/**@brief Removes the oldest publication.
+ *
+ * @param[inout] p_queue     Delivery queue.
+ */
+static void front_drop(mqttsn_delivery_queue_t * p_queue)
+{
+    p_queue->head = (p_queue->head + 1) % MQTTSN_DELIVERY_QUEUE_MAX_LENGTH;
+    p_queue->num_of_elements--;
+}
+
+/**@brief Gets the key of a QoS 1 publication in the window of received ones. */
+static inline uint32_t seen_key(uint16_t topic_id, uint16_t packet_id)
+{
+    return ((uint32_t)topic_id << 16) | packet_id;
+}
+
+/**@brief Checks if a QoS 1 publication has been received recently.
+ *
+ * @param[in]    p_queue     Delivery queue.
+ * @param[in]    key         Key of the publication.
+ *
+ * @retval       true        If the publication is in the window.
+ * @retval       false       Otherwise.
+ */
+static bool seen_find(const mqttsn_delivery_queue_t * p_queue, uint32_t key)
+{
+    for (int i = 0; i < MQTTSN_DELIVERY_DUP_WINDOW_LENGTH; i++)
+    {
+        if (p_queue->seen[i] == key)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**@brief Remembers a QoS 1 publication, in place of the oldest one.
+ *
+ * @param[inout] p_queue     Delivery queue.
+ * @param[in]    key         Key of the publication.
+ */
+static void seen_add(mqttsn_delivery_queue_t * p_queue, uint32_t key)
+{
+    p_queue->seen[p_queue->seen_next] = key;
+    p_queue->seen_next                = (p_queue->seen_next + 1) % MQTTSN_DELIVERY_DUP_WINDOW_LENGTH;
+}
+
+/**@brief Checks if a publication waits in the queue to be acknowledged on delivery.
+ *
+ * @param[in]    p_queue     Delivery queue.
+ * @param[in]    topic_id    Topic ID of the publication.
+ * @param[in]    packet_id   Message ID of the publication.
+ *
+ * @retval       true        If PUBACK message for the publication is still to be sent.
+ * @retval       false       Otherwise.
+ */
+static bool ack_pending_find(const mqttsn_delivery_queue_t * p_queue, uint16_t topic_id, uint16_t packet_id)
+{
+    for (uint8_t i = 0; i < p_queue->num_of_elements; i++)
+    {
+        const mqttsn_delivery_publish_t * p_publish =
+            &(p_queue->publish[(p_queue->head + i) % MQTTSN_DELIVERY_QUEUE_MAX_LENGTH]);
+
+        if (p_publish->ack_pending && p_publish->topic_id == topic_id && p_publish->packet_id == packet_id)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**@brief Acknowledges a QoS 1 publication. The gateway has proven the connection alive once the
+ *        client answers it, so the next PINGREQ is postponed.
+ *
+ * @param[inout] p_client    Pointer to MQTT-SN client instance.
+ * @param[in]    topic_id    Topic ID of the publication.
+ * @param[in]    packet_id   Message ID of the publication.
+ *
+ * @return       Result of @ref mqttsn_packet_sender_puback.
+ */
+static uint32_t puback_send(mqttsn_client_t * p_client, uint16_t topic_id, uint16_t packet_id)
+{
+    uint32_t err_code = mqttsn_packet_sender_puback(p_client, topic_id, packet_id, MQTTSN_RC_ACCEPTED);
+
+    if (err_code == NRF_SUCCESS && p_client->client_state == MQTTSN_CLIENT_CONNECTED)
+    {
+        mqttsn_client_keep_alive_refresh(p_client);
+    }
+
+    return err_code;
+}
+
+void mqttsn_delivery_queue_init(mqttsn_client_t * p_client)
+{
+    memset(&(p_client->delivery_queue), 0, sizeof(mqttsn_delivery_queue_t));
+    p_client->delivery_queue.policy = MQTTSN_DEFAULT_DELIVERY_POLICY;
+}
+
+uint32_t mqttsn_delivery_queue_elem_add(mqttsn_client_t * p_client,
+                                        uint16_t          topic_id,
+                                        uint16_t          packet_id,
+                                        bool              ack,
+                                        bool              dup,
+                                        const uint8_t   * p_payload,
+                                        uint16_t          payload_len)
+{
+    mqttsn_delivery_queue_t * p_queue  = &(p_client->delivery_queue);
+    bool                      ack_late = ack && p_queue->policy == MQTTSN_DELIVERY_BACKPRESSURE;
+    uint32_t                  key      = seen_key(topic_id, packet_id);
+
+    /* The gateway has not seen PUBACK message yet. Message IDs wrap around, so only messages
+     * flagged as retransmissions are looked up. */
+    if (ack && dup && seen_find(p_queue, key))
+    {
+        p_queue->stats.duplicates++;
+
+        if (ack_pending_find(p_queue, topic_id, packet_id))
+        {
+            return NRF_SUCCESS;
+        }
+
+        return puback_send(p_client, topic_id, packet_id);
+    }
+
+    /* Retransmissions would not make it fit either. */
+    if (payload_len > MQTTSN_DELIVERY_PAYLOAD_MAX_LENGTH)
+    {
+        NRF_LOG_ERROR("Received payload too long to be queued\r\n");
+        p_queue->stats.oversized++;
+        ack_late = false;
+    }
+    else if (p_queue->num_of_elements == MQTTSN_DELIVERY_QUEUE_MAX_LENGTH &&
+             p_queue->policy != MQTTSN_DELIVERY_DROP_OLDEST)
+    {
+        if (ack_late)
+        {
+            /* The gateway retransmits it once the application has caught up. */
+            p_queue->stats.deferred++;
+            return NRF_SUCCESS;
+        }
+
+        NRF_LOG_ERROR("Delivery queue full, received publication dropped\r\n");
+        p_queue->stats.dropped_newest++;
+    }
+    else
+    {
+        if (p_queue->num_of_elements == MQTTSN_DELIVERY_QUEUE_MAX_LENGTH)
+        {
+            NRF_LOG_ERROR("Delivery queue full, oldest publication dropped\r\n");
+            p_queue->stats.dropped_oldest++;
+            front_drop(p_queue);
+        }
+
+        uint8_t                     index     = (p_queue->head + p_queue->num_of_elements) % MQTTSN_DELIVERY_QUEUE_MAX_LENGTH;
+        mqttsn_delivery_publish_t * p_publish = &(p_queue->publish[index]);
+
+        p_publish->topic_id    = topic_id;
+        p_publish->packet_id   = packet_id;
+        p_publish->ack_pending = ack_late;
+        p_publish->payload_len = payload_len;
+        memcpy(p_publish->p_payload, p_payload, payload_len);
+
+        p_queue->num_of_elements++;
+
+        if (p_queue->num_of_elements > p_queue->stats.max_queued)
+        {
+            p_queue->stats.max_queued = p_queue->num_of_elements;
+        }
+    }
+
+    /* Withheld publications are not remembered, so that their retransmission is accepted. */
+    if (ack)
+    {
+        seen_add(p_queue, key);
+    }
+
+    if (ack && !ack_late)
+    {
+        return puback_send(p_client, topic_id, packet_id);
+    }
+
+    return NRF_SUCCESS;
+}
+
+void mqttsn_delivery_queue_process(mqttsn_client_t * p_client)
+{
+    mqttsn_delivery_queue_t * p_queue = &(p_client->delivery_queue);
+
+    /* Bounded to the publications queued on entry, so that a steady downlink cannot keep the
+     * caller here. */
+    for (uint8_t count = p_queue->num_of_elements; count > 0 && p_queue->num_of_elements > 0; count--)
+    {
+        /* The slot is released before the handler runs, so it may receive or uninitialize. */
+        mqttsn_delivery_publish_t publish = p_queue->publish[p_queue->head];
+
+        front_drop(p_queue);
+        p_queue->stats.delivered++;
+
+        if (publish.ack_pending)
+        {
+            (void)puback_send(p_client, publish.topic_id, publish.packet_id);
+        }
+
+        mqttsn_event_t evt =
+        {
+            .event_id = MQTTSN_EVENT_RECEIVED,
+            .event_data.published =
+                {
+                    .packet    = { .id    = publish.packet_id,
+                                   .topic = { .topic_id = publish.topic_id },
+                                   .len   = publish.payload_len},
+                    .p_payload = publish.p_payload,
+                },
+        };
+        p_client->evt_handler(p_client, &evt);
+
+        if (p_client->client_state == MQTTSN_CLIENT_IDLE)
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,164 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "mqttsn_entropy.h"
+#include "nrf_error.h"
+
+#include <stddef.h>
+
+#define MQTTSN_ENTROPY_POOL_MASK    (MQTTSN_ENTROPY_POOL_SIZE - 1)
+
+/* Any non-zero value is a valid xorshift state. */
+#define MQTTSN_ENTROPY_DEFAULT_SEED 0x2545f491UL
+
+#if (MQTTSN_ENTROPY_POOL_SIZE & MQTTSN_ENTROPY_POOL_MASK) != 0
+#error "MQTTSN_ENTROPY_POOL_SIZE must be a power of two"
+#endif
+
+/**@brief Ring of random bytes. */
+static uint8_t m_pool[MQTTSN_ENTROPY_POOL_SIZE];
+
+/**@brief Free-running write and read counters of the ring. */
+static uint32_t m_head;
+static uint32_t m_tail;
+
+/**@brief Entropy source topping up the ring. */
+static mqttsn_entropy_source_t m_source;
+
+/**@brief Fallback generator state, reseeded with every value taken from the ring. */
+static uint32_t m_state = MQTTSN_ENTROPY_DEFAULT_SEED;
+
+/**@brief Advances the fallback generator.
+ *
+ * @return       Next pseudo-random value.
+ */
+static uint32_t fallback_next(void)
+{
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 17;
+    m_state ^= m_state << 5;
+
+    return m_state;
+}
+
+/**@brief Mixes a random value into the fallback generator state.
+ *
+ * @param[in]    value       Random value taken from the ring.
+ */
+static void fallback_reseed(uint32_t value)
+{
+    m_state ^= value;
+
+    if (m_state == 0)
+    {
+        m_state = MQTTSN_ENTROPY_DEFAULT_SEED;
+    }
+
+    (void)fallback_next();
+}
+
+uint32_t mqttsn_entropy_init(mqttsn_entropy_source_t source)
+{
+    if (source == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    m_source = source;
+    m_head   = 0;
+    m_tail   = 0;
+
+    mqttsn_entropy_refill();
+
+    return NRF_SUCCESS;
+}
+
+void mqttsn_entropy_refill(void)
+{
+    if (m_source == NULL)
+    {
+        return;
+    }
+
+    /* The free space wraps around the end of the ring at most once. */
+    for (int chunk = 0; chunk < 2; chunk++)
+    {
+        uint32_t free_space = MQTTSN_ENTROPY_POOL_SIZE - (m_head - m_tail);
+        uint32_t index      = m_head & MQTTSN_ENTROPY_POOL_MASK;
+        uint32_t len        = MQTTSN_ENTROPY_POOL_SIZE - index;
+
+        if (len > free_space)
+        {
+            len = free_space;
+        }
+
+        if (len == 0)
+        {
+            return;
+        }
+
+        uint32_t copied = m_source(&m_pool[index], len);
+        m_head += copied;
+
+        if (copied < len)
+        {
+            return;
+        }
+    }
+}
+
+uint32_t mqttsn_entropy_available(void)
+{
+    return m_head - m_tail;
+}
+
+uint32_t mqttsn_entropy_u32_get(void)
+{
+    uint32_t value = 0;
+
+    mqttsn_entropy_refill();
+
+    if (mqttsn_entropy_available() < sizeof(value))
+    {
+        return fallback_next();
+    }
+
+    for (uint32_t i = 0; i < sizeof(value); i++)
+    {
+        value = (value << 8) | m_pool[m_tail & MQTTSN_ENTROPY_POOL_MASK];
+        ++m_tail;
+    }
+
+    fallback_reseed(value);
+
+    return value;
+}
+
+uint32_t mqttsn_entropy_bounded_get(uint32_t bound)
+{
+    if (bound == 0)
+    {
+        return 0;
+    }
+
+    /* Values below the threshold would make the low results more likely, so they are redrawn.
+     * The threshold is 2^32 mod bound, which is less than half of the range. */
+    uint32_t threshold = (0U - bound) % bound;
+    uint32_t value;
+
+    do
+    {
+        value = mqttsn_entropy_u32_get();
+    } while (value < threshold);
+
+    return value % bound;
+}
@@ -0,0 +1,88 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/**@file mqttsn_entropy.h
+ *
+ * @brief Entropy pool used by the MQTT-SN platform's random number generator.
+ *
+ * @details The pool is a ring of random bytes topped up from a platform-supplied source that
+ *          must never block. Draws never wait for the source: when the ring runs dry, output
+ *          comes from a generator reseeded from the last bytes taken out of the ring. The module
+ *          has no hardware dependencies, so it can run on a host with a fake source.
+ */
+
+#ifndef MQTTSN_ENTROPY_H
+#define MQTTSN_ENTROPY_H
+
+#include <stdint.h>
+
+/**@brief Size of the entropy ring in bytes. Must be a power of two. */
+#ifndef MQTTSN_ENTROPY_POOL_SIZE
+#define MQTTSN_ENTROPY_POOL_SIZE 32
+#endif
+
+/**@brief Entropy source.
+ *
+ * @details Copies up to @p len random bytes that are available right now into @p p_buf. Must not
+ *          wait for new bytes to be generated.
+ *
+ * @param[out]   p_buf       Buffer for the random bytes.
+ * @param[in]    len         Maximum number of bytes to copy.
+ *
+ * @return       Number of bytes copied.
+ */
+typedef uint32_t (*mqttsn_entropy_source_t)(uint8_t * p_buf, uint32_t len);
+
+
+/**@brief Initializes the entropy pool and fills it from the source.
+ *
+ * @param[in]    source      Entropy source.
+ *
+ * @return       NRF_SUCCESS if the pool has been initialized.
+ *               NRF_ERROR_NULL if the source is NULL.
+ */
+uint32_t mqttsn_entropy_init(mqttsn_entropy_source_t source);
+
+
+/**@brief Tops the pool up with the bytes the source has available. Does not block.
+ *
+ * @note Draws refill the pool themselves. Calling this from an idle loop or a scheduler event
+ *       keeps the pool full between draws.
+ */
+void mqttsn_entropy_refill(void);
+
+
+/**@brief Gets number of bytes currently in the pool.
+ *
+ * @return       Number of buffered random bytes.
+ */
+uint32_t mqttsn_entropy_available(void);
+
+
+/**@brief Gets a 32-bit random value. Does not block.
+ *
+ * @return       Random value.
+ */
+uint32_t mqttsn_entropy_u32_get(void);
+
+
+/**@brief Gets a uniformly distributed random value in range [0, @p bound). Does not block.
+ *
+ * @details Uses rejection sampling, so every value in range is equally likely.
+ *
+ * @param[in]    bound       Exclusive upper bound.
+ *
+ * @return       Random value, or 0 if @p bound is 0.
+ */
+uint32_t mqttsn_entropy_bounded_get(uint32_t bound);
+
+#endif // MQTTSN_ENTROPY_H
@@ -0,0 +1,376 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "mqttsn_packet_internal.h"
+
+/**@brief Value of topic_index while CONNACK message is awaited. */
+#define MQTTSN_FAILOVER_CONNECTING MQTTSN_TOPIC_TABLE_MAX_LENGTH
+
+/**@brief Gets the next message ID.
+ *
+ * @param[inout] p_client    Pointer to MQTT-SN client instance.
+ *
+ * @return       Message ID.
+ */
+static uint16_t packet_id_next(mqttsn_client_t * p_client)
+{
+    mqttsn_retained_changed(p_client, MQTTSN_RETAINED_IN_FLIGHT);
+
+    p_client->message_id = (p_client->message_id == MQTTSN_MAX_PACKET_ID) ? 1 : p_client->message_id + 1;
+
+    return p_client->message_id;
+}
+
+/**@brief Gets PUBLISH message header of a queued packet.
+ *
+ * @param[in]    p_packet    Queued packet.
+ *
+ * @return       Pointer to the Message Type field, or NULL if the packet is not a PUBLISH message
+ *               with a normal topic ID.
+ */
+static uint8_t * publish_header_get(const mqttsn_packet_t * p_packet)
+{
+    uint8_t * p_data = mqttsn_packet_data_get(p_packet);
+    uint32_t  index  = mqttsn_packet_msgtype_index_get(p_data);
+    uint8_t * p_type = &(p_data[index]);
+
+    if (p_packet->len < index + MQTTSN_OFFSET_PUBLISH_TOPIC_ID + 2 ||
+        p_type[0] != MQTTSN_PUBLISH                        ||
+        (p_type[MQTTSN_OFFSET_PUBLISH_FLAGS] & MQTTSN_FLAG_TOPIC_ID_TYPE_MASK) != MQTTSN_TOPIC_TYPE_NORMAL)
+    {
+        return NULL;
+    }
+
+    return p_type;
+}
+
+/**@brief Replaces topic ID of PUBLISH message.
+ *
+ * @param[inout] p_header    Pointer to the Message Type field.
+ * @param[in]    translate   Topic ID translation.
+ * @param[in]    p_client    Pointer to MQTT-SN client instance.
+ */
+static void publish_topic_id_translate(uint8_t               * p_header,
+                                       uint16_t             (* translate)(const mqttsn_client_t *, uint16_t),
+                                       const mqttsn_client_t * p_client)
+{
+    uint8_t * p_topic_id = &(p_header[MQTTSN_OFFSET_PUBLISH_TOPIC_ID]);
+    uint16_t  topic_id   = translate(p_client, (p_topic_id[0] << 8) | p_topic_id[1]);
+
+    p_topic_id[0] = topic_id >> 8;
+    p_topic_id[1] = topic_id & 0xff;
+}
+
+/**@brief Holds queued messages until the new gateway is ready. Topic IDs in PUBLISH messages are
+ *        replaced with the ones known to the application, as the old gateway's IDs are about to
+ *        be forgotten.
+ *
+ * @param[inout] p_client    Pointer to MQTT-SN client instance.
+ */
+static void packets_hold(mqttsn_client_t * p_client)
+{
+    for (int i = 0; i < p_client->packet_queue.num_of_elements; i++)
+    {
+        mqttsn_packet_t * p_packet = &(p_client->packet_queue.packet[i]);
+        uint8_t         * p_header = publish_header_get(p_packet);
+
+        if (p_header != NULL)
+        {
+            publish_topic_id_translate(p_header, mqttsn_topic_table_app_id_get, p_client);
+        }
+
+        p_packet->timeout            = MQTTSN_CLOCK_DEADLINE_NONE;
+        p_packet->retransmission_cnt = MQTTSN_DEFAULT_RETRANSMISSION_CNT;
+    }
+}
+
+/**@brief Releases queued messages held during the gateway switch. Topic IDs in PUBLISH messages
+ *        are replaced with the ones of the current gateway.
+ *
+ * @param[inout] p_client    Pointer to MQTT-SN client instance.
+ * @param[in]    resend      True to resend the messages at once, false to leave them to the
+ *                           retransmission timer.
+ */
+static void packets_release(mqttsn_client_t * p_client, bool resend)
+{
+    for (int i = 0; i < p_client->packet_queue.num_of_elements; i++)
+    {
+        mqttsn_packet_t * p_packet = &(p_client->packet_queue.packet[i]);
+        uint8_t         * p_header = publish_header_get(p_packet);
+
+        if (p_header != NULL)
+        {
+            publish_topic_id_translate(p_header, mqttsn_topic_table_gateway_id_get, p_client);
+
+            /* The old gateway may have forwarded the message before it went silent. */
+            p_header[MQTTSN_OFFSET_PUBLISH_FLAGS] |= MQTTSN_FLAG_DUP;
+        }
+
+        p_packet->timeout = mqttsn_platform_timer_set_in_ms(MQTTSN_DEFAULT_RETRANSMISSION_TIME_IN_MS);
+
+        if (resend)
+        {
+            mqttsn_packet_sender_retransmit(p_client, &(p_client->gateway_info.addr), p_packet);
+        }
+    }
+}
+
+/**@brief Sends the message prepared in the failover message buffer.
+ *
+ * @param[inout] p_client    Pointer to MQTT-SN client instance.
+ * @param[in]    datalen     Length of the message.
+ * @param[in]    id          Message ID, 0 for CONNECT message.
+ *
+ * @return       NRF_SUCCESS if the message has been sent successfully.
+ *               Otherwise error code is returned.
+ */
+static uint32_t message_send(mqttsn_client_t * p_client, uint16_t datalen, uint16_t id)
+{
+    mqttsn_packet_t * p_message = &(p_client->failover.message);
+
+    p_message->p_data             = p_client->failover.p_msg;
+    p_message->len                = datalen;
+    p_message->id                 = id;
+    p_message->retransmission_cnt = MQTTSN_DEFAULT_RETRANSMISSION_CNT;
+    p_message->timeout            = mqttsn_platform_timer_set_in_ms(MQTTSN_DEFAULT_RETRANSMISSION_TIME_IN_MS);
+
+    mqttsn_client_timer_reschedule(p_client);
+
+    return mqttsn_packet_sender_retransmit(p_client, &(p_client->gateway_info.addr), p_message);
+}
+
+/**@brief Sends CONNECT message with the options of the original connection.
+ *
+ * @param[inout] p_client    Pointer to MQTT-SN client instance.
+ *
+ * @return       NRF_SUCCESS if the message has been sent successfully.
+ *               Otherwise error code is returned.
+ */
+static uint32_t connect_send(mqttsn_client_t * p_client)
+{
+    char                     p_buf[MQTTSN_CLIENT_ID_MAX_LENGTH + 1];
+    MQTTSNPacket_connectData options = MQTTSNPacket_connectData_initializer;
+    options.clientID.cstring         = p_buf;
+
+    memset(p_buf, 0, sizeof(p_buf));
+    memcpy(p_buf, p_client->connect_info.p_client_id, p_client->connect_info.client_id_len);
+    options.willFlag     = p_client->connect_info.will_flag;
+    options.duration     = p_client->connect_info.alive_duration;
+    options.cleansession = p_client->connect_info.clean_session;
+
+    uint16_t datalen = MQTTSNSerialize_connect(p_client->failover.p_msg, MQTTSN_FAILOVER_MSG_MAX_LENGTH, &options);
+    if (datalen == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    p_client->failover.topic_index = MQTTSN_FAILOVER_CONNECTING;
+
+    return message_send(p_client, datalen, 0);
+}
+
+/**@brief Finishes the gateway switch: resends held messages and restarts keep-alive.
+ *
+ * @param[inout] p_client    Pointer to MQTT-SN client instance.
+ */
+static void failover_complete(mqttsn_client_t * p_client)
+{
+    p_client->failover.in_progress     = false;
+    p_client->failover.message.timeout = MQTTSN_CLOCK_DEADLINE_NONE;
+    p_client->client_state             = MQTTSN_CLIENT_CONNECTED;
+
+    p_client->keep_alive.timeout                    = mqttsn_platform_timer_set_in_ms(p_client->keep_alive.duration);
+    p_client->keep_alive.response_arrived           = 1;
+    p_client->keep_alive.message.retransmission_cnt = MQTTSN_DEFAULT_RETRANSMISSION_CNT + 1;
+
+    packets_release(p_client, true);
+    mqttsn_client_timer_reschedule(p_client);
+
+    mqttsn_event_t evt =
+    {
+        .event_id             = MQTTSN_EVENT_GATEWAY_SWITCHED,
+        .event_data.connected =
+        {
+            .gateway_id     = p_client->gateway_info.id,
+            .p_gateway_addr = &(p_client->gateway_info.addr),
+        },
+    };
+    p_client->evt_handler(p_client, &evt);
+
+    /* Publications made during the switch go out now. */
+    mqttsn_client_deferred_process(p_client);
+}
+
+/**@brief Gives up the gateway switch as no gateway is left to try. Held messages are released to
+ *        time out, and the application is notified of the lost connection.
+ *
+ * @param[inout] p_client    Pointer to MQTT-SN client instance.
+ */
+static void failover_abort(mqttsn_client_t * p_client)
+{
+    p_client->failover.in_progress     = false;
+    p_client->failover.message.timeout = MQTTSN_CLOCK_DEADLINE_NONE;
+    p_client->client_state             = MQTTSN_CLIENT_CONNECTED;
+
+    packets_release(p_client, false);
+    mqttsn_client_timer_reschedule(p_client);
+
+    mqttsn_event_t evt =
+    {
+        .event_id = MQTTSN_EVENT_TIMEOUT,
+        .event_data.error =
+        {
+            .error    = MQTTSN_ERROR_TIMEOUT,
+            .msg_type = MQTTSN_PACKET_PINGREQ,
+        },
+    };
+    p_client->evt_handler(p_client, &evt);
+}
+
+/**@brief Registers the next remembered topic with the new gateway, or finishes the switch when
+ *        all topics are registered.
+ *
+ * @param[inout] p_client    Pointer to MQTT-SN client instance.
+ * @param[in]    first_index Index in the topic table to start looking from.
+ */
+static void register_next(mqttsn_client_t * p_client, uint8_t first_index)
+{
+    for (uint8_t i = first_index; i < MQTTSN_TOPIC_TABLE_MAX_LENGTH; i++)
+    {
+        mqttsn_topic_entry_t * p_entry = &(p_client->topic_table.topic[i]);
+
+        if (p_entry->topic_name_len == 0)
+        {
+            continue;
+        }
+
+        uint16_t packet_id = packet_id_next(p_client);
+        uint16_t datalen   = mqttsn_codec_register_encode(p_client->failover.p_msg,
+                                                          MQTTSN_FAILOVER_MSG_MAX_LENGTH,
+                                                          0,
+                                                          packet_id,
+                                                          p_entry->p_topic_name,
+                                                          p_entry->topic_name_len);
+        if (datalen == 0)
+        {
+            continue;
+        }
+
+        p_client->failover.topic_index = i;
+        message_send(p_client, datalen, packet_id);
+        return;
+    }
+
+    failover_complete(p_client);
+}
+
+void mqttsn_failover_init(mqttsn_client_t * p_client)
+{
+    memset(&(p_client->failover), 0, sizeof(mqttsn_failover_t));
+    p_client->failover.message.timeout = MQTTSN_CLOCK_DEADLINE_NONE;
+}
+
+uint32_t mqttsn_failover_start(mqttsn_client_t * p_client)
+{
+    mqttsn_gateway_table_remove(p_client, p_client->gateway_info.id);
+
+    const mqttsn_gateway_entry_t * p_gateway = mqttsn_gateway_table_best_get(p_client,
+                                                                             mqttsn_platform_time_ms_get());
+    if (p_gateway == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    if (!p_client->failover.in_progress)
+    {
+        packets_hold(p_client);
+        p_client->failover.in_progress = true;
+    }
+
+    mqttsn_topic_table_registrations_clear(p_client);
+
+    NRF_LOG_INFO("Switching to gateway %d\r\n", p_gateway->info.id);
+
+    memcpy(&(p_client->gateway_info), &(p_gateway->info), sizeof(mqttsn_gw_info_t));
+    mqttsn_retained_changed(p_client, MQTTSN_RETAINED_SESSION);
+    p_client->client_state       = MQTTSN_CLIENT_ESTABLISHING_CONNECTION;
+    p_client->keep_alive.timeout = MQTTSN_CLOCK_DEADLINE_NONE;
+
+    return connect_send(p_client);
+}
+
+uint32_t mqttsn_failover_connack_handle(mqttsn_client_t * p_client, uint8_t return_code)
+{
+    if (p_client->failover.topic_index != MQTTSN_FAILOVER_CONNECTING)
+    {
+        NRF_LOG_ERROR("CONNACK packet was not expected.\r\n");
+        return NRF_ERROR_INTERNAL;
+    }
+
+    if (return_code != MQTTSN_RC_ACCEPTED)
+    {
+        NRF_LOG_INFO("Gateway rejected connection. Reason: %d\r\n", return_code);
+        if (mqttsn_failover_start(p_client) != NRF_SUCCESS)
+        {
+            failover_abort(p_client);
+        }
+        return NRF_SUCCESS;
+    }
+
+    register_next(p_client, 0);
+    return NRF_SUCCESS;
+}
+
+uint32_t mqttsn_failover_regack_handle(mqttsn_client_t * p_client,
+                                       uint16_t          topic_id,
+                                       uint16_t          packet_id,
+                                       uint8_t           return_code)
+{
+    uint8_t index = p_client->failover.topic_index;
+
+    if (index == MQTTSN_FAILOVER_CONNECTING || packet_id != p_client->failover.message.id)
+    {
+        NRF_LOG_ERROR("REGACK packet ID had unexpected value.\r\n");
+        return NRF_ERROR_INTERNAL;
+    }
+
+    if (return_code == MQTTSN_RC_ACCEPTED)
+    {
+        mqttsn_topic_table_gateway_id_set(p_client, index, topic_id);
+    }
+    else
+    {
+        NRF_LOG_ERROR("Register message was rejected. Reason: %d\r\n", return_code);
+    }
+
+    register_next(p_client, index + 1);
+    return NRF_SUCCESS;
+}
+
+void mqttsn_failover_timeout_handle(mqttsn_client_t * p_client)
+{
+    mqttsn_packet_t * p_message = &(p_client->failover.message);
+
+    if (p_message->retransmission_cnt == 0)
+    {
+        /* The new gateway does not answer either. */
+        if (mqttsn_failover_start(p_client) != NRF_SUCCESS)
+        {
+            failover_abort(p_client);
+        }
+        return;
+    }
+
+    --(p_message->retransmission_cnt);
+    p_message->timeout = mqttsn_platform_timer_set_in_ms(MQTTSN_DEFAULT_RETRANSMISSION_TIME_IN_MS);
+    mqttsn_packet_sender_retransmit(p_client, &(p_client->gateway_info.addr), p_message);
+}
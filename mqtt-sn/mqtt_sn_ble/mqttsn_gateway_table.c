@@ -0,0 +1,135 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "mqttsn_packet_internal.h"
+
+/**@brief Checks if a gateway is still considered reachable.
+ *
+ * @param[in]    p_entry     Gateway entry.
+ * @param[in]    now         Current time in milliseconds.
+ *
+ * @retval       true        If the gateway has been heard from recently enough.
+ * @retval       false       Otherwise.
+ */
+static bool is_live(const mqttsn_gateway_entry_t * p_entry, uint64_t now)
+{
+    uint64_t validity = (p_entry->duration != 0) ?
+                        (uint64_t)p_entry->duration * 1000 * MQTTSN_GATEWAY_ADVERTISE_TOLERANCE :
+                        (uint64_t)MQTTSN_GATEWAY_INFO_VALIDITY * 1000;
+
+    return p_entry->in_use && now - p_entry->last_seen <= validity;
+}
+
+/**@brief Checks if one gateway should be preferred over another.
+ *
+ * @param[in]    p_entry     Candidate gateway entry.
+ * @param[in]    p_best      Best gateway entry so far.
+ *
+ * @retval       true        If the candidate is better.
+ * @retval       false       Otherwise.
+ */
+static bool is_better(const mqttsn_gateway_entry_t * p_entry, const mqttsn_gateway_entry_t * p_best)
+{
+    if (p_entry->rtt != p_best->rtt)
+    {
+        return p_entry->rtt < p_best->rtt;
+    }
+
+    return p_entry->last_seen > p_best->last_seen;
+}
+
+void mqttsn_gateway_table_init(mqttsn_client_t * p_client)
+{
+    memset(&(p_client->gateway_table), 0, sizeof(mqttsn_gateway_table_t));
+    p_client->gateway_table.searchgw_sent = MQTTSN_CLOCK_DEADLINE_NONE;
+}
+
+void mqttsn_gateway_table_update(mqttsn_client_t       * p_client,
+                                 uint8_t                 gateway_id,
+                                 const mqttsn_remote_t * p_remote,
+                                 uint16_t                duration,
+                                 uint32_t                rtt)
+{
+    mqttsn_gateway_entry_t * p_entry  = NULL;
+    mqttsn_gateway_entry_t * p_oldest = NULL;
+
+    for (int i = 0; i < MQTTSN_GATEWAY_TABLE_MAX_LENGTH; i++)
+    {
+        mqttsn_gateway_entry_t * p_candidate = &(p_client->gateway_table.gateway[i]);
+
+        if (p_candidate->in_use && p_candidate->info.id == gateway_id)
+        {
+            p_entry = p_candidate;
+            break;
+        }
+
+        if (p_oldest == NULL || !p_candidate->in_use ||
+            (p_oldest->in_use && p_candidate->last_seen < p_oldest->last_seen))
+        {
+            p_oldest = p_candidate;
+        }
+    }
+
+    if (p_entry == NULL)
+    {
+        p_entry = p_oldest;
+        memset(p_entry, 0, sizeof(mqttsn_gateway_entry_t));
+        p_entry->in_use  = true;
+        p_entry->info.id = gateway_id;
+        p_entry->rtt     = UINT32_MAX;
+    }
+
+    if (p_remote != NULL)
+    {
+        memcpy(&(p_entry->info.addr), p_remote, sizeof(mqttsn_remote_t));
+    }
+
+    if (duration != 0)
+    {
+        p_entry->duration = duration;
+    }
+
+    if (rtt != UINT32_MAX)
+    {
+        p_entry->rtt = rtt;
+    }
+
+    p_entry->last_seen = mqttsn_platform_time_ms_get();
+}
+
+void mqttsn_gateway_table_remove(mqttsn_client_t * p_client, uint8_t gateway_id)
+{
+    for (int i = 0; i < MQTTSN_GATEWAY_TABLE_MAX_LENGTH; i++)
+    {
+        if (p_client->gateway_table.gateway[i].in_use && p_client->gateway_table.gateway[i].info.id == gateway_id)
+        {
+            p_client->gateway_table.gateway[i].in_use = false;
+        }
+    }
+}
+
+const mqttsn_gateway_entry_t * mqttsn_gateway_table_best_get(const mqttsn_client_t * p_client, uint64_t now)
+{
+    const mqttsn_gateway_entry_t * p_best = NULL;
+
+    for (int i = 0; i < MQTTSN_GATEWAY_TABLE_MAX_LENGTH; i++)
+    {
+        const mqttsn_gateway_entry_t * p_entry = &(p_client->gateway_table.gateway[i]);
+
+        if (is_live(p_entry, now) && (p_best == NULL || is_better(p_entry, p_best)))
+        {
+            p_best = p_entry;
+        }
+    }
+
+    return p_best;
+}
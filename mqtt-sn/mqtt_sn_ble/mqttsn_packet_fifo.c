@@ -34,6 +34,7 @@ uint32_t mqttsn_packet_fifo_elem_add(mqttsn_client_t * p_client, mqttsn_packet_t
         p_client->packet_queue.packet[p_client->packet_queue.num_of_elements] = *packet;
 
         p_client->packet_queue.num_of_elements++;
+        mqttsn_retained_changed(p_client, MQTTSN_RETAINED_IN_FLIGHT);
         return NRF_SUCCESS;
     }
 }
@@ -47,14 +48,23 @@ uint32_t mqttsn_packet_fifo_elem_dequeue(mqttsn_client_t * p_client, uint16_t ms
         return NRF_ERROR_NOT_FOUND;
     }
 
-    nrf_free(p_client->packet_queue.packet[elem_to_dequeue].p_data);
+    if (p_client->packet_queue.packet[elem_to_dequeue].p_data != NULL)
+    {
+        nrf_free(p_client->packet_queue.packet[elem_to_dequeue].p_data);
+    }
+
+    if (p_client->packet_queue.packet[elem_to_dequeue].p_payload != NULL)
+    {
+        nrf_free(p_client->packet_queue.packet[elem_to_dequeue].p_payload);
+    }
 
-    for (int i = elem_to_dequeue; i < p_client->packet_queue.num_of_elements; i++)
+    for (int i = elem_to_dequeue; i < p_client->packet_queue.num_of_elements - 1; i++)
     {
         p_client->packet_queue.packet[i] = p_client->packet_queue.packet[i+1];
     }
 
     p_client->packet_queue.num_of_elements--;
+    mqttsn_retained_changed(p_client, MQTTSN_RETAINED_IN_FLIGHT);
 
     return NRF_SUCCESS;
 }
@@ -76,15 +86,18 @@ uint32_t mqttsn_packet_fifo_elem_find(mqttsn_client_t * p_client, uint16_t msg_t
                 break;
 
             case MQTTSN_MESSAGE_TYPE:
+            {
+                const uint8_t * p_data = mqttsn_packet_data_get(&(p_client->packet_queue.packet[i]));
 
-                type_offset = p_client->packet_queue.packet[i].p_data[0] == MQTTSN_TWO_BYTE_LENGTH_CODE ? 
+                type_offset = p_data[0] == MQTTSN_TWO_BYTE_LENGTH_CODE ? 
                               MQTTSN_OFFSET_TWO_BYTE_LENGTH : MQTTSN_OFFSET_ONE_BYTE_LENGTH;
                 
-                if (p_client->packet_queue.packet[i].p_data[type_offset] == msg_to_dequeue)
+                if (p_data[type_offset] == msg_to_dequeue)
                 {
                     return i;
                 }
                 break;
+            }
 
             default:
                 break;
@@ -21,6 +21,7 @@
 #include "mqttsn_transport.h"
 #include "mqttsn_platform.h"
 #include "mqttsn_client.h"
+#include "mqttsn_codec.h"
 #include "MQTTSNConnect.h"
 #include "MQTTSNPacket.h"
 #include "nrf_error.h"
@@ -42,8 +43,8 @@
 /**@brief Maximum MQTT-SN packet ID. */
 #define MQTTSN_MAX_PACKET_ID                  65535
 
-/**@brief Offset of Gateway ID in GWINFO message. */
-#define MQTTSN_OFFSET_GATEWAY_INFO_ID         2
+/**@brief Offset of Gateway ID field from Message Type field in GWINFO message. */
+#define MQTTSN_OFFSET_GATEWAY_INFO_ID         1
 
 /**@brief Offset of Message Type field when Message Length is two byte long. */
 #define MQTTSN_OFFSET_TWO_BYTE_LENGTH         3
@@ -57,16 +58,6 @@
 /**@brief Maximum value of SEARCHGW message delay. */
 #define MQTTSN_SEARCH_GATEWAY_MAX_DELAY_IN_MS 2000
 
-/**@brief Values of message types eligible for retransmission. For retransmission purpose only. */
-#define MQTTSN_MSGTYPE_CONNECT      0x04
-#define MQTTSN_MSGTYPE_REGISTER     0x0a
-#define MQTTSN_MSGTYPE_PUBLISH      0x0c
-#define MQTTSN_MSGTYPE_SUBSCRIBE    0x12
-#define MQTTSN_MSGTYPE_UNSUBSCRIBE  0x14
-#define MQTTSN_MSGTYPE_PINGREQ      0x16
-#define MQTTSN_MSGTYPE_WILLTOPICUPD 0x1a
-#define MQTTSN_MSGTYPE_WILLMSGUPD   0x1c
-
 /**@brief Search mode in packet_dequeue. */
 typedef enum mqttsn_packet_dequeue_t
 {
@@ -79,6 +70,17 @@ typedef enum mqttsn_packet_dequeue_t
  * @section FIFO
  **************************************************************************************************/
 
+/**@brief Gets the message content of a packet, or its header if the payload is separate.
+ *
+ * @param[in]    p_packet    Pointer to MQTT-SN packet.
+ *
+ * @return       Pointer to the first byte of the message.
+ */
+static inline uint8_t * mqttsn_packet_data_get(const mqttsn_packet_t * p_packet)
+{
+    return (p_packet->p_data != NULL) ? p_packet->p_data : (uint8_t *)p_packet->header;
+}
+
 /**@brief Initializes packet queue.
  *
  * @param[inout] p_client    Pointer to MQTT-SN client.
@@ -127,6 +129,416 @@ uint32_t mqttsn_packet_fifo_elem_find(mqttsn_client_t        * p_client,
                                       mqttsn_packet_dequeue_t  mode);
 
 
+/***************************************************************************************************
+ * @section GATEWAY TABLE
+ **************************************************************************************************/
+
+/**@brief Initializes table of known gateways.
+ *
+ * @param[inout] p_client    Pointer to MQTT-SN client.
+ */
+void mqttsn_gateway_table_init(mqttsn_client_t * p_client);
+
+/**@brief Adds a gateway to the table or refreshes its entry.
+ *
+ * @details When the table is full, the gateway heard from least recently is replaced.
+ *
+ * @param[inout] p_client    Pointer to initialized client.
+ * @param[in]    gateway_id  Gateway ID.
+ * @param[in]    p_remote    Gateway address. NULL if the transport has no addressing.
+ * @param[in]    duration    Advertised ADVERTISE interval in seconds. 0 keeps the known value.
+ * @param[in]    rtt         Measured round trip time in milliseconds. UINT32_MAX keeps the known value.
+ */
+void mqttsn_gateway_table_update(mqttsn_client_t       * p_client,
+                                 uint8_t                 gateway_id,
+                                 const mqttsn_remote_t * p_remote,
+                                 uint16_t                duration,
+                                 uint32_t                rtt);
+
+/**@brief Removes a gateway from the table.
+ *
+ * @param[inout] p_client    Pointer to initialized client.
+ * @param[in]    gateway_id  Gateway ID.
+ */
+void mqttsn_gateway_table_remove(mqttsn_client_t * p_client, uint8_t gateway_id);
+
+/**@brief Finds the best live gateway.
+ *
+ * @details Gateways with a lower measured round trip time are preferred, then the ones heard from
+ *          most recently.
+ *
+ * @param[in]    p_client    Pointer to initialized client.
+ * @param[in]    now         Current time in milliseconds.
+ *
+ * @return       Pointer to the gateway entry, or NULL if no live gateway is known.
+ */
+const mqttsn_gateway_entry_t * mqttsn_gateway_table_best_get(const mqttsn_client_t * p_client, uint64_t now);
+
+
+/***************************************************************************************************
+ * @section TOPIC TABLE
+ **************************************************************************************************/
+
+/**@brief Initializes table of registered topics.
+ *
+ * @param[inout] p_client    Pointer to MQTT-SN client.
+ */
+void mqttsn_topic_table_init(mqttsn_client_t * p_client);
+
+/**@brief Remembers a registered topic, or updates the topic ID of a known one.
+ *
+ * @details The topic ID of a new topic becomes the one known to the application as well. A known
+ *          topic keeps the topic ID known to the application, so that it stays valid across
+ *          connections. Topics which do not fit the table are not registered again after a
+ *          gateway switch.
+ *
+ * @param[inout] p_client       Pointer to initialized client.
+ * @param[in]    p_topic_name   Topic name.
+ * @param[in]    topic_name_len Length of the topic name.
+ * @param[in]    topic_id       Topic ID assigned by the gateway.
+ */
+void mqttsn_topic_table_add(mqttsn_client_t * p_client,
+                            const uint8_t   * p_topic_name,
+                            uint16_t          topic_name_len,
+                            uint16_t          topic_id);
+
+/**@brief Remembers a topic before it is registered, under a topic ID chosen by the client.
+ *
+ * @details The topic ID is taken from the range starting at @ref MQTTSN_TOPIC_LOCAL_ID_FIRST. It
+ *          is kept by @ref mqttsn_topic_table_add once the topic has been registered.
+ *
+ * @param[inout] p_client       Pointer to initialized client.
+ * @param[in]    p_topic_name   Topic name.
+ * @param[in]    topic_name_len Length of the topic name.
+ * @param[out]   p_app_id       Topic ID known to the application. The one already given to the
+ *                              topic if it is remembered.
+ *
+ * @retval       NRF_SUCCESS              If the topic is remembered.
+ * @retval       NRF_ERROR_INVALID_LENGTH If the topic name is empty or longer than
+ *                                        MQTTSN_TOPIC_NAME_MAX_LENGTH.
+ * @retval       NRF_ERROR_NO_MEM         If the table is full.
+ */
+uint32_t mqttsn_topic_table_local_add(mqttsn_client_t * p_client,
+                                      const uint8_t   * p_topic_name,
+                                      uint16_t          topic_name_len,
+                                      uint16_t        * p_app_id);
+
+/**@brief Sets the topic ID assigned by the current gateway and rebuilds the PUBLISH header template.
+ *
+ * @param[inout] p_client    Pointer to initialized client.
+ * @param[in]    index       Index of the topic in the table.
+ * @param[in]    gateway_id  Topic ID assigned by the current gateway, 0 if not registered.
+ */
+void mqttsn_topic_table_gateway_id_set(mqttsn_client_t * p_client, uint8_t index, uint16_t gateway_id);
+
+/**@brief Forgets the topic IDs assigned by the current gateway, until the topics are registered again.
+ *
+ * @param[inout] p_client    Pointer to initialized client.
+ */
+void mqttsn_topic_table_registrations_clear(mqttsn_client_t * p_client);
+
+/**@brief Checks if a topic can be published to.
+ *
+ * @param[in]    p_client    Pointer to initialized client.
+ * @param[in]    app_id      Topic ID known to the application.
+ *
+ * @retval       true        If the topic is registered with the current gateway, or not remembered.
+ * @retval       false       If the topic is remembered, but not registered with the current gateway.
+ */
+bool mqttsn_topic_table_is_registered(const mqttsn_client_t * p_client, uint16_t app_id);
+
+/**@brief Gets the PUBLISH header template of a topic registered with the current gateway.
+ *
+ * @param[in]    p_client    Pointer to initialized client.
+ * @param[in]    gateway_id  Topic ID assigned by the current gateway.
+ *
+ * @return       Template to be patched with @ref mqttsn_codec_publish_header_patch, or NULL if the
+ *               topic is not known.
+ */
+const uint8_t * mqttsn_topic_table_publish_template_get(const mqttsn_client_t * p_client, uint16_t gateway_id);
+
+/**@brief Translates a topic ID known to the application to the one of the current gateway.
+ *
+ * @param[in]    p_client    Pointer to initialized client.
+ * @param[in]    app_id      Topic ID known to the application.
+ *
+ * @return       Topic ID assigned by the current gateway, or app_id if the topic is not known.
+ */
+uint16_t mqttsn_topic_table_gateway_id_get(const mqttsn_client_t * p_client, uint16_t app_id);
+
+/**@brief Translates a topic ID of the current gateway to the one known to the application.
+ *
+ * @param[in]    p_client    Pointer to initialized client.
+ * @param[in]    gateway_id  Topic ID assigned by the current gateway.
+ *
+ * @return       Topic ID known to the application, or gateway_id if the topic is not known.
+ */
+uint16_t mqttsn_topic_table_app_id_get(const mqttsn_client_t * p_client, uint16_t gateway_id);
+
+
+/***************************************************************************************************
+ * @section FAILOVER
+ **************************************************************************************************/
+
+/**@brief Initializes gateway switch state.
+ *
+ * @param[inout] p_client    Pointer to MQTT-SN client.
+ */
+void mqttsn_failover_init(mqttsn_client_t * p_client);
+
+/**@brief Switches to the best live gateway other than the current one.
+ *
+ * @details The current gateway is removed from the gateway table. Queued messages are held until
+ *          the new gateway has accepted the connection and remembered topics are registered again.
+ *
+ * @param[inout] p_client    Pointer to initialized client.
+ *
+ * @retval       NRF_SUCCESS         If CONNECT message has been sent to another gateway.
+ * @retval       NRF_ERROR_NOT_FOUND If no other live gateway is known.
+ * @retval       Otherwise, appropriate error code is returned.
+ */
+uint32_t mqttsn_failover_start(mqttsn_client_t * p_client);
+
+/**@brief Handles CONNACK message received while switching gateways.
+ *
+ * @param[inout] p_client    Pointer to initialized client.
+ * @param[in]    return_code Return code of CONNACK message.
+ *
+ * @retval       NRF_SUCCESS        If CONNACK message has been processed successfully.
+ * @retval       NRF_ERROR_INTERNAL If CONNACK message was not expected.
+ */
+uint32_t mqttsn_failover_connack_handle(mqttsn_client_t * p_client, uint8_t return_code);
+
+/**@brief Handles REGACK message received while switching gateways.
+ *
+ * @param[inout] p_client    Pointer to initialized client.
+ * @param[in]    topic_id    Topic ID assigned by the new gateway.
+ * @param[in]    packet_id   Message ID of REGACK message.
+ * @param[in]    return_code Return code of REGACK message.
+ *
+ * @retval       NRF_SUCCESS        If REGACK message has been processed successfully.
+ * @retval       NRF_ERROR_INTERNAL If REGACK message was not expected.
+ */
+uint32_t mqttsn_failover_regack_handle(mqttsn_client_t * p_client,
+                                       uint16_t          topic_id,
+                                       uint16_t          packet_id,
+                                       uint8_t           return_code);
+
+/**@brief Retransmits the message awaiting acknowledgement, or moves on to the next gateway once
+ *        the retransmission limit has been reached.
+ *
+ * @param[inout] p_client    Pointer to initialized client.
+ */
+void mqttsn_failover_timeout_handle(mqttsn_client_t * p_client);
+
+
+/***************************************************************************************************
+ * @section DEFERRED QUEUE
+ **************************************************************************************************/
+
+/**@brief Initializes queue of publications held back while the client cannot send them.
+ *
+ * @param[inout] p_client    Pointer to MQTT-SN client.
+ */
+void mqttsn_deferred_queue_init(mqttsn_client_t * p_client);
+
+/**@brief Enqueues publication.
+ *
+ * @details A high priority publication is enqueued behind the other high priority ones, ahead of
+ *          normal priority ones. If the queue is full, it replaces the newest normal priority one.
+ *
+ * @param[inout] p_client         Pointer to initialized client.
+ * @param[in]    topic_id         Topic ID of the publication.
+ * @param[in]    p_payload        Payload of the publication.
+ * @param[in]    payload_len      Length of the payload.
+ * @param[in]    priority         Priority class of the publication.
+ *
+ * @retval       NRF_SUCCESS              If the publication has been enqueued successfully.
+ * @retval       NRF_ERROR_INVALID_LENGTH If the payload does not fit a queue slot.
+ * @retval       NRF_ERROR_NO_MEM         If the queue is full.
+ */
+uint32_t mqttsn_deferred_queue_elem_add(mqttsn_client_t * p_client,
+                                        uint16_t          topic_id,
+                                        const uint8_t   * p_payload,
+                                        uint16_t          payload_len,
+                                        mqttsn_priority_t priority);
+
+/**@brief Gets the publication to be sent first without removing it.
+ *
+ * @param[inout] p_client    Pointer to initialized client.
+ *
+ * @return       Pointer to the publication, or NULL if the queue is empty.
+ */
+mqttsn_deferred_publish_t * mqttsn_deferred_queue_front_get(mqttsn_client_t * p_client);
+
+/**@brief Gets a publication by its position in the queue without removing it.
+ *
+ * @param[inout] p_client    Pointer to initialized client.
+ * @param[in]    position    Position of the publication, 0 for the one to be sent first.
+ *
+ * @return       Pointer to the publication, or NULL if the queue is shorter.
+ */
+mqttsn_deferred_publish_t * mqttsn_deferred_queue_elem_get(mqttsn_client_t * p_client, uint8_t position);
+
+/**@brief Removes a publication, keeping the others in order.
+ *
+ * @param[inout] p_client    Pointer to initialized client.
+ * @param[in]    position    Position of the publication, 0 for the one to be sent first.
+ */
+void mqttsn_deferred_queue_elem_drop(mqttsn_client_t * p_client, uint8_t position);
+
+/**@brief Checks if the queue is full.
+ *
+ * @param[in]    p_client    Pointer to initialized client.
+ *
+ * @retval       true        If no more publications can be enqueued.
+ * @retval       false       Otherwise.
+ */
+bool mqttsn_deferred_queue_is_full(const mqttsn_client_t * p_client);
+
+
+/***************************************************************************************************
+ * @section AGGREGATOR
+ **************************************************************************************************/
+
+/**@brief Initializes aggregated publications.
+ *
+ * @param[inout] p_client    Pointer to MQTT-SN client.
+ */
+void mqttsn_aggregator_init(mqttsn_client_t * p_client);
+
+/**@brief Appends a record to the aggregated publication of a topic, publishing it when full.
+ *
+ * @param[inout] p_client    Pointer to initialized client.
+ * @param[in]    topic_id    Topic ID known to the application.
+ * @param[in]    p_record    Record.
+ * @param[in]    record_len  Length of the record.
+ *
+ * @retval       NRF_SUCCESS              If the record has been staged successfully.
+ * @retval       NRF_ERROR_INVALID_LENGTH If the record does not fit an aggregated publication.
+ * @retval       NRF_ERROR_NO_MEM         If no slot is free, or the staged records could not be
+ *                                        published for lack of memory to make room for the record.
+ *                                        They stay staged.
+ * @retval       Other                    Error code of @ref mqttsn_client_publish if the staged
+ *                                        records have been dropped instead. The record is not
+ *                                        staged either.
+ */
+uint32_t mqttsn_aggregator_append(mqttsn_client_t * p_client,
+                                  uint16_t          topic_id,
+                                  const uint8_t   * p_record,
+                                  uint16_t          record_len);
+
+/**@brief Publishes aggregated publications whose deadline has passed.
+ *
+ * @param[inout] p_client    Pointer to initialized client.
+ * @param[in]    now         Current time in milliseconds, or MQTTSN_CLOCK_DEADLINE_NONE to publish
+ *                           all of them.
+ *
+ * @return       NRF_SUCCESS, or error code of the first publication which could not be sent.
+ *               Publications are kept if memory is short, dropped on other errors.
+ */
+uint32_t mqttsn_aggregator_flush(mqttsn_client_t * p_client, uint64_t now);
+
+/**@brief Gets the earliest deadline of aggregated publications.
+ *
+ * @param[in]    p_client    Pointer to initialized client.
+ *
+ * @return       Deadline in milliseconds, or MQTTSN_CLOCK_DEADLINE_NONE if nothing is staged.
+ */
+uint64_t mqttsn_aggregator_deadline_get(const mqttsn_client_t * p_client);
+
+
+/***************************************************************************************************
+ * @section DELIVERY QUEUE
+ **************************************************************************************************/
+
+/**@brief Initializes queue of received publications.
+ *
+ * @param[inout] p_client    Pointer to MQTT-SN client.
+ */
+void mqttsn_delivery_queue_init(mqttsn_client_t * p_client);
+
+/**@brief Enqueues received publication, applying the delivery policy if the queue is full.
+ *
+ * @details PUBACK message is sent at once, unless the backpressure policy defers it to delivery
+ *          or withholds it for a publication which does not fit. A retransmission of a QoS 1
+ *          publication received recently is acknowledged again, but not queued.
+ *
+ * @param[inout] p_client    Pointer to initialized client.
+ * @param[in]    topic_id    Topic ID of the publication.
+ * @param[in]    packet_id   Message ID of the publication.
+ * @param[in]    ack         True if the publication has to be acknowledged (QoS 1).
+ * @param[in]    dup         True if the DUP flag of the publication is set.
+ * @param[in]    p_payload   Payload of the publication.
+ * @param[in]    payload_len Length of the payload.
+ *
+ * @return       NRF_SUCCESS, or error code returned by @ref mqttsn_packet_sender_puback.
+ */
+uint32_t mqttsn_delivery_queue_elem_add(mqttsn_client_t * p_client,
+                                        uint16_t          topic_id,
+                                        uint16_t          packet_id,
+                                        bool              ack,
+                                        bool              dup,
+                                        const uint8_t   * p_payload,
+                                        uint16_t          payload_len);
+
+/**@brief Delivers the publications queued when called to the application.
+ *
+ * @param[inout] p_client    Pointer to initialized client.
+ */
+void mqttsn_delivery_queue_process(mqttsn_client_t * p_client);
+
+
+/***************************************************************************************************
+ * @section RETAINED
+ **************************************************************************************************/
+
+/**@brief Takes a retained image for the client and restores the state it holds.
+ *
+ * @details Images are keyed to clients by port. The client takes the valid image saved for its
+ *          port, else an invalid one, else the image of a port no client has taken since startup.
+ *          If the image is valid, the message ID, the gateway, the topic table and the deferred
+ *          queue are restored, and publications awaiting PUBACK are queued again with the DUP flag
+ *          set. They are held until @ref mqttsn_retained_release. If all images are taken by
+ *          other clients, the client runs without one and its state is lost on reset.
+ *
+ * @param[inout] p_client    Pointer to MQTT-SN client, with the packet queue and the memory
+ *                           manager initialized.
+ * @param[in]    port        Port the client is bound to.
+ */
+void mqttsn_retained_init(mqttsn_client_t * p_client, uint16_t port);
+
+/**@brief Invalidates the retained image and releases it.
+ *
+ * @param[in]    p_client    Pointer to initialized client.
+ */
+void mqttsn_retained_uninit(const mqttsn_client_t * p_client);
+
+/**@brief Marks parts of the client state as changed since the last save.
+ *
+ * @param[inout] p_client    Pointer to MQTT-SN client.
+ * @param[in]    parts       Parts changed, see @ref mqttsn_retained_part_t.
+ */
+static inline void mqttsn_retained_changed(mqttsn_client_t * p_client, uint8_t parts)
+{
+    p_client->retained_dirty |= parts;
+}
+
+/**@brief Copies the parts of the client state changed since the last save to the retained image.
+ *
+ * @details Returns at once if nothing has changed.
+ *
+ * @param[inout] p_client    Pointer to initialized client.
+ */
+void mqttsn_retained_save(mqttsn_client_t * p_client);
+
+/**@brief Resends restored publications whose topic is registered with the current gateway.
+ *
+ * @param[inout] p_client    Pointer to connected client.
+ */
+void mqttsn_retained_release(mqttsn_client_t * p_client);
+
+
 /***************************************************************************************************
  * @section SENDER
  **************************************************************************************************/
@@ -135,16 +547,14 @@ uint32_t mqttsn_packet_fifo_elem_find(mqttsn_client_t        * p_client,
  *
  * @param[inout] p_client    Pointer to initialized client.
  * @param[in]    p_remote    Pointer to remote endpoint.
- * @param[in]    p_data      Pointer to the data to be retransmitted.
- * @param[in]    datalen     Length of the data to be retransmitted.
+ * @param[in]    p_packet    Message to be retransmitted, with its payload if held separately.
  *
  * @return       NRF_SUCCESS if the message has been sent successfully.
  *               Otherwise error code is returned.
  */
 uint32_t mqttsn_packet_sender_retransmit(mqttsn_client_t       * p_client,
                                          const mqttsn_remote_t * p_remote,
-                                         const uint8_t         * p_data,
-                                         uint16_t                datalen);
+                                         const mqttsn_packet_t * p_packet);
 
 /**@brief Sends SEARCHGW message.
  *
@@ -332,10 +742,42 @@ uint32_t mqttsn_packet_msgtype_index_get(const uint8_t * p_buffer);
  */
 mqttsn_ack_error_t mqttsn_packet_msgtype_error_get(const uint8_t * p_buffer);
 
+/**@brief Postpones the next PINGREQ, as the gateway has just proven the connection alive.
+ *
+ * @details Called when a message answering one sent by the client is received, and when the
+ *          client answers REGISTER or PUBLISH with REGACK or PUBACK.
+ *
+ * @param[inout] p_client Pointer to MQTT-SN client instance.
+ */
+void mqttsn_client_keep_alive_refresh(mqttsn_client_t * p_client);
+
 /**@brief Handles timer timeout.
  *
  * @param[inout] p_client Pointer to MQTT-SN client instance.
  */
 void mqttsn_client_timer_timeout_handle(mqttsn_client_t * p_client);
 
+/**@brief Restarts the platform timer for the earliest pending retransmission or keep-alive deadline.
+ *
+ * @param[inout] p_client Pointer to MQTT-SN client instance.
+ *
+ * @return       NRF_SUCCESS if the timer has been restarted or no deadline is pending.
+ *               Otherwise error code is returned.
+ */
+uint32_t mqttsn_client_timer_reschedule(mqttsn_client_t * p_client);
+
+/**@brief Selects a gateway and raises @ref MQTTSN_EVENT_GATEWAY_FOUND.
+ *
+ * @param[inout] p_client  Pointer to MQTT-SN client instance.
+ * @param[in]    p_gateway Gateway to select.
+ */
+void mqttsn_client_gateway_select(mqttsn_client_t * p_client, const mqttsn_gw_info_t * p_gateway);
+
+/**@brief Sends held back publications the packet queue has room for. While the client is awake,
+ *        also returns it to sleep once PINGRESP has arrived and all its messages are acknowledged.
+ *
+ * @param[inout] p_client Pointer to MQTT-SN client instance.
+ */
+void mqttsn_client_deferred_process(mqttsn_client_t * p_client);
+
 #endif // MQTTSN_PACKET_INTERNAL_H
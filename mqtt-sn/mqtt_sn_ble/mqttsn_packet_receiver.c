@@ -13,10 +13,29 @@
 #include <string.h>
 #include "mqttsn_packet_internal.h"
 
-#define MQTTSN_PACKET_PINGREQ_LENGTH 2
+/**@brief Handler of a received message.
+ *
+ * @param[inout] p_client    Pointer to an MQTT-SN client instance.
+ * @param[in]    p_remote    Pointer to remote endpoint.
+ * @param[in]    p_data      Received data, at least as long as the fixed fields of its type.
+ * @param[in]    datalen     Length of the received data.
+ *
+ * @return       NRF_SUCCESS if the message has been processed successfully.
+ *               Otherwise error code is returned.
+ */
+typedef uint32_t (*mqttsn_message_handler_t)(mqttsn_client_t       * p_client,
+                                             const mqttsn_remote_t * p_remote,
+                                             const uint8_t         * p_data,
+                                             uint16_t                datalen);
 
-/**@brief PINGREQ message buffer. */
-static uint8_t mp_pingreq_msg[MQTTSN_PACKET_PINGREQ_LENGTH + MQTTSN_CLIENT_ID_MAX_LENGTH];
+/**@brief Handling of a message type. */
+typedef struct mqttsn_message_type_t
+{
+    mqttsn_message_handler_t handler;         /**< Handler of received messages, NULL if the type is not received by the client. */
+    uint8_t                  fixed_len;       /**< Length of the fixed fields from Message Type field on. Shorter messages are dropped. */
+    bool                     answers_client;  /**< The message answers one sent by the client, so receiving it proves that the connection is alive. */
+    uint8_t                  ack_error;       /**< @ref mqttsn_ack_error_t reported when the message, or its acknowledgement, fails. */
+} mqttsn_message_type_t;
 
 uint32_t mqttsn_packet_msgtype_index_get(const uint8_t * p_buffer)
 {
@@ -30,69 +49,26 @@ uint32_t mqttsn_packet_msgtype_index_get(const uint8_t * p_buffer)
     }
 }
 
-mqttsn_ack_error_t mqttsn_packet_msgtype_error_get(const uint8_t * p_buffer)
-{
-    uint32_t msg_type = p_buffer[mqttsn_packet_msgtype_index_get(p_buffer)];
-    
-    switch (msg_type)
-    {
-        case 0x04:
-            return MQTTSN_PACKET_CONNACK;
-
-        case 0x0a:
-            return MQTTSN_PACKET_REGACK;
-
-        case 0x0c:
-            return MQTTSN_PACKET_PUBACK;
-
-        case 0x12:
-            return MQTTSN_PACKET_SUBACK;
-
-        case 0x14:
-            return MQTTSN_PACKET_UNSUBACK;
-
-        case 0x16:
-            return MQTTSN_PACKET_PINGREQ;
-
-        case 0x1a:
-            return MQTTSN_PACKET_WILLTOPICUPD;
-
-        case 0x1c:
-            return MQTTSN_PACKET_WILLMSGUPD;
-
-        default:
-            return MQTTSN_PACKET_INCORRECT;
-    }
-}
-
 /**@brief Creates keep-alive PINGREQ packet.  
  *
  * @param[inout] p_client Pointer to an MQTT-SN client instance. 
  */
 static void pingreq_packet_create(mqttsn_client_t * p_client)
 {
-    MQTTSNString client_id = MQTTSNString_initializer;
-    client_id.cstring      = nrf_malloc(MQTTSN_CLIENT_ID_MAX_LENGTH);
-    if (client_id.cstring == NULL)
-    {
-        return;
-    }
-
-    memset(client_id.cstring, 0, MQTTSN_CLIENT_ID_MAX_LENGTH);
-    memcpy(client_id.cstring, p_client->connect_info.p_client_id, p_client->connect_info.client_id_len);
-    uint16_t pingreq_len = MQTTSN_PACKET_PINGREQ_LENGTH + p_client->connect_info.client_id_len;
-    uint16_t datalen     = MQTTSNSerialize_pingreq(mp_pingreq_msg, pingreq_len, client_id);
+    uint16_t datalen = mqttsn_codec_pingreq_encode(p_client->keep_alive.p_pingreq_msg,
+                                                   MQTTSN_PINGREQ_MAX_LENGTH,
+                                                   p_client->connect_info.p_client_id,
+                                                   p_client->connect_info.client_id_len);
     if (datalen == 0)
     {
-        nrf_free(client_id.cstring);
         return;
     }
     
     p_client->keep_alive.message.retransmission_cnt = MQTTSN_DEFAULT_RETRANSMISSION_CNT + 1;
-    p_client->keep_alive.message.p_data             = mp_pingreq_msg;
+    p_client->keep_alive.message.p_data             = p_client->keep_alive.p_pingreq_msg;
     p_client->keep_alive.message.len                = datalen;
-
-    nrf_free(client_id.cstring);
+    p_client->keep_alive.message.p_payload          = NULL;
+    p_client->keep_alive.message.payload_len        = 0;
 }
 
 /**@brief Handles sleep permission received from the gateway. 
@@ -105,41 +81,92 @@ static void sleep_handle(mqttsn_client_t * p_client)
     p_client->evt_handler(p_client, &evt);
 }
 
+void mqttsn_client_keep_alive_refresh(mqttsn_client_t * p_client)
+{
+    p_client->keep_alive.timeout                    = mqttsn_platform_timer_set_in_ms(p_client->keep_alive.duration);
+    p_client->keep_alive.response_arrived           = 1;
+    p_client->keep_alive.message.retransmission_cnt = MQTTSN_DEFAULT_RETRANSMISSION_CNT + 1;
+}
+
+/**@brief Handles ADVERTISE message received from the gateway.
+ *
+ * @details The gateway is added to the table of known gateways, so that a later search can
+ *          select it without broadcasting SEARCHGW.
+ *
+ * @param[inout] p_client    Pointer to an MQTT-SN client instance.
+ * @param[in]    p_remote    Pointer to remote endpoint - the gateway's address.
+ * @param[in]    p_data      Received data.
+ * @param[in]    datalen     Length of the received data.
+ *
+ * @retval       NRF_SUCCESS        If ADVERTISE message was processed successfully.
+ * @retval       NRF_ERROR_INTERNAL Otherwise.
+ */
+static uint32_t advertise_handle(mqttsn_client_t        * p_client,
+                                 const mqttsn_remote_t  * p_remote,
+                                 const uint8_t          * p_data,
+                                 uint16_t                 datalen)
+{
+    unsigned char  gateway_id = 0;
+    unsigned short duration   = 0;
+
+    if (MQTTSNDeserialize_advertise(&gateway_id, &duration, (unsigned char *)(p_data), datalen) == 0)
+    {
+        NRF_LOG_ERROR("ADVERTISE packet cannot be deserialized.\r\n");
+        return NRF_ERROR_INTERNAL;
+    }
+
+    mqttsn_gateway_table_update(p_client, gateway_id, p_remote, duration, UINT32_MAX);
+
+    return NRF_SUCCESS;
+}
+
 /**@brief Handles GWINFO message received from the gateway. 
  *
- * @note Unless client is searching for gateway, GWINFO message is ignored.
+ * @details The gateway is added to the table of known gateways together with the round trip
+ *          time of the last SEARCHGW. Unless client is searching for gateway, GWINFO message is
+ *          not processed further.
  *
  * @param[inout] p_client    Pointer to an MQTT-SN client instance.
  * @param[in]    p_remote    Pointer to remote endpoint - the gateway's address.
  * @param[in]    p_data      Received data.
  * @param[in]    datalen     Length of the received data.
  *
- * @retval       NRF_SUCCESS In all cases.
+ * @retval       NRF_SUCCESS        If GWINFO message was processed successfully.
+ * @retval       NRF_ERROR_INTERNAL Otherwise.
  */
 static uint32_t gwinfo_handle(mqttsn_client_t        * p_client,
                               const mqttsn_remote_t  * p_remote,
                               const uint8_t          * p_data,
                               uint16_t                 datalen)
 {
-    if (p_client->client_state == MQTTSN_CLIENT_SEARCHING_GATEWAY)
+    UNUSED_PARAMETER(datalen);
+
+    uint32_t offset        = mqttsn_packet_msgtype_index_get(p_data);
+    uint8_t  gateway_id    = p_data[offset + MQTTSN_OFFSET_GATEWAY_INFO_ID];
+    uint64_t searchgw_sent = p_client->gateway_table.searchgw_sent;
+    uint32_t rtt           = UINT32_MAX;
+
+    if (searchgw_sent != MQTTSN_CLOCK_DEADLINE_NONE)
     {
-        mqttsn_remote_t temp_remote;
-        memset(&temp_remote, 0,        sizeof(mqttsn_remote_t));
-        memcpy(&temp_remote, p_remote, sizeof(mqttsn_remote_t));
+        uint64_t elapsed = mqttsn_platform_time_ms_get() - searchgw_sent;
+        rtt              = (elapsed < UINT32_MAX) ? (uint32_t)elapsed : UINT32_MAX - 1;
+    }
+
+    mqttsn_gateway_table_update(p_client, gateway_id, p_remote, 0, rtt);
 
-        p_client->client_state = MQTTSN_CLIENT_GATEWAY_FOUND;
+    if (p_client->client_state == MQTTSN_CLIENT_SEARCHING_GATEWAY)
+    {
+        mqttsn_gw_info_t gateway;
+        memset(&gateway, 0, sizeof(mqttsn_gw_info_t));
 
-        mqttsn_event_t evt =
+        gateway.id = gateway_id;
+        if (p_remote != NULL)
         {
-            .event_id             = MQTTSN_EVENT_GATEWAY_FOUND,
-            .event_data.connected = 
-            {
-                .gateway_id     = p_data[MQTTSN_OFFSET_GATEWAY_INFO_ID],
-                .p_gateway_addr = &temp_remote,
-            },
-        };
+            memcpy(&(gateway.addr), p_remote, sizeof(mqttsn_remote_t));
+        }
 
-        p_client->evt_handler(p_client, &evt);
+        p_client->gateway_table.searchgw_sent = MQTTSN_CLOCK_DEADLINE_NONE;
+        mqttsn_client_gateway_select(p_client, &gateway);
     }
 
     return NRF_SUCCESS;
@@ -147,25 +174,46 @@ static uint32_t gwinfo_handle(mqttsn_client_t        * p_client,
 
 /**@brief Handles WILLTOPICREQ message received from the gateway.  
  *
- * @param[inout] p_client Pointer to an MQTT-SN client instance. 
+ * @param[inout] p_client    Pointer to an MQTT-SN client instance.
+ * @param[in]    p_remote    Pointer to remote endpoint.
+ * @param[in]    p_data      Received data.
+ * @param[in]    datalen     Length of the received data.
  */
-static uint32_t willtopicreq_handle(mqttsn_client_t * p_client)
+static uint32_t willtopicreq_handle(mqttsn_client_t       * p_client,
+                                    const mqttsn_remote_t * p_remote,
+                                    const uint8_t         * p_data,
+                                    uint16_t                datalen)
 {
+    UNUSED_PARAMETER(p_remote);
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(datalen);
+
     return mqttsn_packet_sender_willtopic(p_client);
 }
 
 /**@brief Handles WILLMSGREQ message received from the gateway.  
  *
- * @param[inout] p_client Pointer to an MQTT-SN client instance. 
+ * @param[inout] p_client    Pointer to an MQTT-SN client instance.
+ * @param[in]    p_remote    Pointer to remote endpoint.
+ * @param[in]    p_data      Received data.
+ * @param[in]    datalen     Length of the received data.
  */
-static uint32_t willmsgreq_handle(mqttsn_client_t * p_client)
+static uint32_t willmsgreq_handle(mqttsn_client_t       * p_client,
+                                  const mqttsn_remote_t * p_remote,
+                                  const uint8_t         * p_data,
+                                  uint16_t                datalen)
 {
+    UNUSED_PARAMETER(p_remote);
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(datalen);
+
     return mqttsn_packet_sender_willmsg(p_client);
 }
 
 /**@brief Handles CONNACK message received from the gateway.  
  *
  * @param[inout] p_client    Pointer to an MQTT-SN client instance. 
+ * @param[in]    p_remote    Pointer to remote endpoint.
  * @param[in]    p_data      Received data.
  * @param[in]    datalen     Length of the received data.
  *
@@ -173,10 +221,13 @@ static uint32_t willmsgreq_handle(mqttsn_client_t * p_client)
  *                                  and processed successfully.
  * @retval       NRF_ERROR_INTERNAL Otherwise.
  */
-static uint32_t connack_handle(mqttsn_client_t * p_client,
-                               const uint8_t   * p_data,
-                               uint16_t          datalen)
+static uint32_t connack_handle(mqttsn_client_t       * p_client,
+                               const mqttsn_remote_t * p_remote,
+                               const uint8_t         * p_data,
+                               uint16_t                datalen)
 {
+    UNUSED_PARAMETER(p_remote);
+
     uint32_t return_code = 0;
     if (p_client->client_state != MQTTSN_CLIENT_ESTABLISHING_CONNECTION)
     {
@@ -190,6 +241,11 @@ static uint32_t connack_handle(mqttsn_client_t * p_client,
         return NRF_ERROR_INTERNAL;
     }
     
+    if (p_client->failover.in_progress)
+    {
+        return mqttsn_failover_connack_handle(p_client, return_code);
+    }
+
     // Change: Moved declarations out of switch to avoid compile warnings
     mqttsn_event_t evt_rc;
     mqttsn_event_t evt_acc;
@@ -197,16 +253,19 @@ static uint32_t connack_handle(mqttsn_client_t * p_client,
     switch(return_code)
     {
         case MQTTSN_RC_ACCEPTED:
-            mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_MSGTYPE_CONNECT, MQTTSN_MESSAGE_TYPE);
+            mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_CONNECT, MQTTSN_MESSAGE_TYPE);
         
             pingreq_packet_create(p_client);
             p_client->keep_alive.duration = p_client->connect_info.alive_duration * 1000;
             p_client->keep_alive.timeout  = mqttsn_platform_timer_set_in_ms(p_client->keep_alive.duration);
-            mqttsn_platform_timer_start(p_client, p_client->keep_alive.timeout);
+            mqttsn_client_timer_reschedule(p_client);
         
             p_client->client_state = MQTTSN_CLIENT_CONNECTED;
             evt_rc.event_id = MQTTSN_EVENT_CONNECTED;
             p_client->evt_handler(p_client, &evt_rc);
+
+            /* Publications queued during an earlier sleep go out on the new connection. */
+            mqttsn_client_deferred_process(p_client);
             return NRF_SUCCESS;
 
         case MQTTSN_RC_REJECTED_CONGESTED:
@@ -216,7 +275,7 @@ static uint32_t connack_handle(mqttsn_client_t * p_client,
             evt_acc.event_data.error.msg_type = mqttsn_packet_msgtype_error_get(p_data);
             evt_acc.event_data.error.msg_id   = 0;
         
-            mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_MSGTYPE_CONNECT, MQTTSN_MESSAGE_TYPE);
+            mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_CONNECT, MQTTSN_MESSAGE_TYPE);
             p_client->evt_handler(p_client, &evt_acc);
             return NRF_SUCCESS;
 
@@ -229,22 +288,27 @@ static uint32_t connack_handle(mqttsn_client_t * p_client,
 /**@brief Handles REGISTER message received from the gateway.  
  *
  * @param[inout] p_client    Pointer to an MQTT-SN client instance. 
+ * @param[in]    p_remote    Pointer to remote endpoint.
  * @param[in]    p_data      Received data.
  * @param[in]    datalen     Length of the received data.
  *
  * @retval       NRF_SUCCESS        If REGACK message was sent successfully in response.
  * @retval       NRF_ERROR_INTERNAL Otherwise.
  */
-static uint32_t register_handle(mqttsn_client_t * p_client,
-                                const uint8_t   * p_data,
-                                uint16_t          datalen)
+static uint32_t register_handle(mqttsn_client_t       * p_client,
+                                const mqttsn_remote_t * p_remote,
+                                const uint8_t         * p_data,
+                                uint16_t                datalen)
 {
-    uint32_t err_code  = NRF_ERROR_INVALID_STATE;
-    uint16_t packet_id = 0;
-    uint16_t topic_id  = 0;
-    MQTTSNString ret_topic;
+    UNUSED_PARAMETER(p_remote);
+
+    uint32_t        err_code       = NRF_ERROR_INVALID_STATE;
+    uint16_t        packet_id      = 0;
+    uint16_t        topic_id       = 0;
+    const uint8_t * p_topic_name   = NULL;
+    uint16_t        topic_name_len = 0;
 
-    if (MQTTSNDeserialize_register(&topic_id, &packet_id, &ret_topic, (unsigned char *)p_data, datalen) == 0)
+    if (!mqttsn_codec_register_decode(p_data, datalen, &topic_id, &packet_id, &p_topic_name, &topic_name_len))
     {
         NRF_LOG_ERROR("REGISTER packet cannot be deserialized\r\n");
         return NRF_ERROR_INTERNAL;
@@ -252,10 +316,15 @@ static uint32_t register_handle(mqttsn_client_t * p_client,
 
     err_code = mqttsn_packet_sender_regack(p_client, topic_id, packet_id, MQTTSN_RC_ACCEPTED);
 
+    if (err_code == NRF_SUCCESS && p_client->client_state == MQTTSN_CLIENT_CONNECTED)
+    {
+        mqttsn_client_keep_alive_refresh(p_client);
+    }
+
     mqttsn_topic_t topic =
     {
         .topic_id = topic_id,
-        .p_topic_name = (unsigned char *)ret_topic.cstring,
+        .p_topic_name = p_topic_name,
     };
     mqttsn_event_t evt =
     {
@@ -263,7 +332,8 @@ static uint32_t register_handle(mqttsn_client_t * p_client,
         .event_data.registered =
             {
                 .packet = { .id    = packet_id,
-                            .topic = topic },
+                            .topic = topic,
+                            .len   = topic_name_len },
             },
     };
     p_client->evt_handler(p_client, &evt);
@@ -274,6 +344,7 @@ static uint32_t register_handle(mqttsn_client_t * p_client,
 /**@brief Handles REGACK message received from the gateway.  
  *
  * @param[inout] p_client    Pointer to an MQTT-SN client instance. 
+ * @param[in]    p_remote    Pointer to remote endpoint.
  * @param[in]    p_data      Received data.
  * @param[in]    datalen     Length of the received data.
  *
@@ -281,10 +352,13 @@ static uint32_t register_handle(mqttsn_client_t * p_client,
  *                                  and processed successfully.
  * @retval       NRF_ERROR_INTERNAL Otherwise.
  */
-static uint32_t regack_handle(mqttsn_client_t * p_client,
-                              const uint8_t   * p_data,
-                              uint16_t          datalen)
+static uint32_t regack_handle(mqttsn_client_t       * p_client,
+                              const mqttsn_remote_t * p_remote,
+                              const uint8_t         * p_data,
+                              uint16_t                datalen)
 {
+    UNUSED_PARAMETER(p_remote);
+
     uint16_t topic_id    = 0;
     uint16_t packet_id   = 0;
     uint8_t  return_code = 0;
@@ -294,14 +368,22 @@ static uint32_t regack_handle(mqttsn_client_t * p_client,
     mqttsn_event_t evt_rc;
     mqttsn_event_t evt_acc;
     mqttsn_topic_t topic;
+    const uint8_t * p_topic_name         = NULL;
+    uint16_t        topic_name_len       = 0;
+    uint16_t        registered_id        = 0;
+    uint16_t        registered_packet_id = 0;
 
-    if (MQTTSNDeserialize_regack(&topic_id, &packet_id, (unsigned char *)(&return_code), (unsigned char *)p_data, datalen) == 0)
+    if (!mqttsn_codec_ack_decode(p_data, datalen, MQTTSN_REGACK, &topic_id, &packet_id, &return_code))
     {
         NRF_LOG_ERROR("REGACK packet cannot be deserialized.\r\n");
         return NRF_ERROR_INTERNAL;
     }
 
-    
+    if (p_client->failover.in_progress)
+    {
+        return mqttsn_failover_regack_handle(p_client, topic_id, packet_id, return_code);
+    }
+
     switch (return_code)
     {
         case MQTTSN_RC_REJECTED_CONGESTED:
@@ -323,16 +405,32 @@ static uint32_t regack_handle(mqttsn_client_t * p_client,
                 return NRF_ERROR_INTERNAL;
             }
 
-            mqttsn_packet_fifo_elem_dequeue(p_client, packet_id, MQTTSN_MESSAGE_ID);
-
-            topic.topic_id     = topic_id;
             topic.p_topic_name = p_client->packet_queue.packet[index].topic.p_topic_name;
+
+            /* The topic is remembered, so that it can be registered again with another gateway. */
+            if (mqttsn_codec_register_decode(p_client->packet_queue.packet[index].p_data,
+                                             p_client->packet_queue.packet[index].len,
+                                             &registered_id,
+                                             &registered_packet_id,
+                                             &p_topic_name,
+                                             &topic_name_len))
+            {
+                mqttsn_topic_table_add(p_client, p_topic_name, topic_name_len, topic_id);
+            }
+
+            /* A topic registered again keeps the ID the application knows it by. */
+            topic.topic_id = mqttsn_topic_table_app_id_get(p_client, topic_id);
+
+            mqttsn_packet_fifo_elem_dequeue(p_client, packet_id, MQTTSN_MESSAGE_ID);
             
             evt_acc.event_id = MQTTSN_EVENT_REGISTERED,
             evt_acc.event_data.registered.packet.id = packet_id; 
             evt_acc.event_data.registered.packet.topic = topic;
             
             p_client->evt_handler(p_client, &evt_acc);
+
+            /* Publications queued for the topic while it was not registered can be sent now. */
+            mqttsn_client_deferred_process(p_client);
             return NRF_SUCCESS;
 
         default:
@@ -344,64 +442,50 @@ static uint32_t regack_handle(mqttsn_client_t * p_client,
 /**@brief Handles PUBLISH message received from the gateway.  
  *
  * @param[inout] p_client    Pointer to an MQTT-SN client instance. 
+ * @param[in]    p_remote    Pointer to remote endpoint.
  * @param[in]    p_data      Received data.
  * @param[in]    datalen     Length of the received data.
  *
- * @retval       NRF_SUCCESS        If the message is processed successfully and (valid for QoS > 0)
- *                                  PUBACK message was sent successfully in response.
- * @retval       NRF_ERROR_INTERNAL Otherwise.
+ * @retval       NRF_SUCCESS        If the message has been queued or dropped as the delivery policy
+ *                                  says, and PUBACK message, if due now, has been sent successfully.
+ * @retval       NRF_ERROR_INTERNAL If the message cannot be deserialized.
+ * @retval       Otherwise, error code returned by the PUBACK sender.
  */
-static uint32_t publish_handle(mqttsn_client_t * p_client,
-                               const uint8_t   * p_data,
-                               uint16_t          datalen)
+static uint32_t publish_handle(mqttsn_client_t       * p_client,
+                               const mqttsn_remote_t * p_remote,
+                               const uint8_t         * p_data,
+                               uint16_t                datalen)
 {
-    uint32_t  err_code    = NRF_SUCCESS;
-    uint16_t  packet_id   = 0;
-    uint32_t  payload_len = 0;
-    uint8_t   qos         = 0;
-    uint8_t   dup         = 0;
-    uint8_t   retained    = 0;
-    uint8_t * p_payload;
-    MQTTSN_topicid ret_topic;
-
-    if (MQTTSNDeserialize_publish(&dup,
-                                  (int *)(&qos),
-                                  &retained,
-                                  (short unsigned int *)(&packet_id),
-                                  &ret_topic,
-                                  &p_payload,
-                                  (int *)(&payload_len),
-                                  (unsigned char *)p_data,
-                                  datalen) != 1)
+    UNUSED_PARAMETER(p_remote);
+
+    uint16_t        packet_id   = 0;
+    uint16_t        topic_id    = 0;
+    uint16_t        payload_len = 0;
+    uint8_t         flags       = 0;
+    const uint8_t * p_payload   = NULL;
+
+    if (!mqttsn_codec_publish_decode(p_data, datalen, &flags, &topic_id, &packet_id, &p_payload, &payload_len))
     {
         NRF_LOG_ERROR("PUBLISH packet cannot be deserialized.\r\n");
         return NRF_ERROR_INTERNAL;
     }
 
-    if (qos > 0)
-    {
-        err_code = mqttsn_packet_sender_puback(p_client, ret_topic.data.id, packet_id, MQTTSN_RC_ACCEPTED);
-    }
+    bool ack = (flags & MQTTSN_FLAG_QOS_MASK) != 0 && (flags & MQTTSN_FLAG_QOS_MASK) != MQTTSN_FLAG_QOS_MASK;
 
-    mqttsn_topic_t topic = { .topic_id = ret_topic.data.id };
-    mqttsn_event_t evt =
-    {
-        .event_id = MQTTSN_EVENT_RECEIVED,
-        .event_data.published =
-            {
-                .packet    = { .id    = packet_id,
-                               .topic = topic,
-                               .len   = (uint16_t)payload_len},
-                .p_payload = p_payload,
-            },
-    };
-    p_client->evt_handler(p_client, &evt);
-    return err_code;
+    /* Delivered to the application by mqttsn_client_process. */
+    return mqttsn_delivery_queue_elem_add(p_client,
+                                          topic_id,
+                                          packet_id,
+                                          ack,
+                                          (flags & MQTTSN_FLAG_DUP) != 0,
+                                          p_payload,
+                                          payload_len);
 }
 
 /**@brief Handles PUBACK message received from the gateway.  
  *
  * @param[inout] p_client    Pointer to an MQTT-SN client instance. 
+ * @param[in]    p_remote    Pointer to remote endpoint.
  * @param[in]    p_data      Received data.
  * @param[in]    datalen     Length of the received data.
  *
@@ -409,10 +493,13 @@ static uint32_t publish_handle(mqttsn_client_t * p_client,
  *                                  and processed successfully.
  * @retval       NRF_ERROR_INTERNAL Otherwise.
  */
-static uint32_t puback_handle(mqttsn_client_t * p_client,
-                              const uint8_t   * p_data,
-                              uint16_t          datalen)
+static uint32_t puback_handle(mqttsn_client_t       * p_client,
+                              const mqttsn_remote_t * p_remote,
+                              const uint8_t         * p_data,
+                              uint16_t                datalen)
 {
+    UNUSED_PARAMETER(p_remote);
+
     uint16_t topic_id    = 0;
     uint16_t packet_id   = 0;
     uint8_t  return_code = 0;
@@ -421,7 +508,7 @@ static uint32_t puback_handle(mqttsn_client_t * p_client,
     mqttsn_event_t evt_rc;
     mqttsn_event_t evt_acc;
 
-    if (MQTTSNDeserialize_puback(&topic_id, &packet_id, (unsigned char *)(&return_code), (unsigned char *)(p_data), datalen) == 0)
+    if (!mqttsn_codec_ack_decode(p_data, datalen, MQTTSN_PUBACK, &topic_id, &packet_id, &return_code))
     {
         NRF_LOG_ERROR("PUBACK packet cannot be deserialized.\r\n");
         return NRF_ERROR_INTERNAL;
@@ -438,6 +525,7 @@ static uint32_t puback_handle(mqttsn_client_t * p_client,
         
             mqttsn_packet_fifo_elem_dequeue(p_client, packet_id, MQTTSN_MESSAGE_ID);
             p_client->evt_handler(p_client, &evt_rc);
+            mqttsn_client_deferred_process(p_client);
             return NRF_SUCCESS;
 
         case MQTTSN_RC_ACCEPTED:
@@ -450,6 +538,7 @@ static uint32_t puback_handle(mqttsn_client_t * p_client,
             mqttsn_packet_fifo_elem_dequeue(p_client, packet_id, MQTTSN_MESSAGE_ID);
             evt_acc.event_id = MQTTSN_EVENT_PUBLISHED;
             p_client->evt_handler(p_client, &evt_acc);
+            mqttsn_client_deferred_process(p_client);
             return NRF_SUCCESS;
 
         default:
@@ -461,6 +550,7 @@ static uint32_t puback_handle(mqttsn_client_t * p_client,
 /**@brief Handles SUBACK message received from the gateway.  
  *
  * @param[inout] p_client    Pointer to an MQTT-SN client instance. 
+ * @param[in]    p_remote    Pointer to remote endpoint.
  * @param[in]    p_data      Received data.
  * @param[in]    datalen     Length of the received data.
  *
@@ -468,25 +558,23 @@ static uint32_t puback_handle(mqttsn_client_t * p_client,
  *                                  and processed successfully.
  * @retval       NRF_ERROR_INTERNAL Otherwise.
  */
-static uint32_t suback_handle(mqttsn_client_t * p_client,
-                              const uint8_t   * p_data,
-                              uint16_t          datalen)
+static uint32_t suback_handle(mqttsn_client_t       * p_client,
+                              const mqttsn_remote_t * p_remote,
+                              const uint8_t         * p_data,
+                              uint16_t                datalen)
 {
+    UNUSED_PARAMETER(p_remote);
+
     uint16_t topic_id    = 0;
     uint16_t packet_id   = 0;
     uint8_t  return_code = 0;
-    uint8_t  qos         = 0;
+    uint8_t  flags       = 0;
     
     // Fix: Moved declarations out of switch to avoid warnings
     mqttsn_event_t evt_rc;
     mqttsn_event_t evt_acc;
 
-    if (MQTTSNDeserialize_suback((int *)(&qos),
-                                 &topic_id,
-                                 &packet_id,
-                                 (unsigned char *)(&return_code),
-                                 (unsigned char *)p_data,
-                                 datalen) == 0)
+    if (!mqttsn_codec_suback_decode(p_data, datalen, &flags, &topic_id, &packet_id, &return_code))
     {
         NRF_LOG_ERROR("SUBACK packet cannot be deserialized.\r\n");
         return NRF_ERROR_INTERNAL;
@@ -527,16 +615,20 @@ static uint32_t suback_handle(mqttsn_client_t * p_client,
 /**@brief Handles UNSUBACK message received from the gateway.  
  *
  * @param[inout] p_client    Pointer to an MQTT-SN client instance. 
+ * @param[in]    p_remote    Pointer to remote endpoint.
  * @param[in]    p_data      Received data.
  * @param[in]    datalen     Length of the received data.
  *
  * @retval       NRF_SUCCESS        If UNSUBACK message was processed successfully.
  * @retval       NRF_ERROR_INTERNAL Otherwise.
  */
-static uint32_t unsuback_handle(mqttsn_client_t * p_client,
-                                const uint8_t   * p_data,
-                                uint16_t          datalen)
+static uint32_t unsuback_handle(mqttsn_client_t       * p_client,
+                                const mqttsn_remote_t * p_remote,
+                                const uint8_t         * p_data,
+                                uint16_t                datalen)
 {
+    UNUSED_PARAMETER(p_remote);
+
     uint16_t packet_id = 0;
 
     if (MQTTSNDeserialize_unsuback(&packet_id, (unsigned char *)p_data, datalen) == 0)
@@ -560,34 +652,58 @@ static uint32_t unsuback_handle(mqttsn_client_t * p_client,
 /**@brief Handles PINGRESP message received from the gateway. 
  *
  * @param[inout] p_client    Pointer to an MQTT-SN client instance.
+ * @param[in]    p_remote    Pointer to remote endpoint.
+ * @param[in]    p_data      Received data.
+ * @param[in]    datalen     Length of the received data.
  *
- * @retval       NRF_SUCCESS In all cases.
+ * @retval       NRF_SUCCESS        If PINGRESP message was processed successfully.
+ * @retval       NRF_ERROR_INTERNAL If PINGRESP message is malformed.
  */
-static uint32_t pingresp_handle(mqttsn_client_t * p_client)
+static uint32_t pingresp_handle(mqttsn_client_t       * p_client,
+                                const mqttsn_remote_t * p_remote,
+                                const uint8_t         * p_data,
+                                uint16_t                datalen)
 {
-    p_client->keep_alive.timeout = mqttsn_platform_timer_set_in_ms(p_client->keep_alive.duration);
-    p_client->keep_alive.response_arrived = 1;
-    p_client->keep_alive.message.retransmission_cnt = MQTTSN_DEFAULT_RETRANSMISSION_CNT + 1;
-    if (p_client->client_state == MQTTSN_CLIENT_ASLEEP)
+    UNUSED_PARAMETER(p_remote);
+
+    if (!mqttsn_codec_pingresp_decode(p_data, datalen))
     {
-        sleep_handle(p_client);
+        NRF_LOG_ERROR("PINGRESP packet cannot be deserialized.\r\n");
+        return NRF_ERROR_INTERNAL;
     }
+
+    mqttsn_client_keep_alive_refresh(p_client);
+
+    /* PINGRESP closes the wake window of a sleeping client. */
+    mqttsn_client_deferred_process(p_client);
     return NRF_SUCCESS;
 }
 
 /**@brief Handles DISCONNECT message received from the gateway. 
  *
  * @param[inout] p_client    Pointer to an MQTT-SN client instance.
+ * @param[in]    p_remote    Pointer to remote endpoint.
+ * @param[in]    p_data      Received data.
+ * @param[in]    datalen     Length of the received data.
  *
  * @retval       NRF_SUCCESS If the message is a response to a DISCONNECT message sent by the
  *                           gateway or if CONNECT message is sent successfully in the opposite case.
  * @retval       Otherwise, error code is returned.
  */
-static uint32_t disconnect_handle(mqttsn_client_t * p_client)
+static uint32_t disconnect_handle(mqttsn_client_t       * p_client,
+                                  const mqttsn_remote_t * p_remote,
+                                  const uint8_t         * p_data,
+                                  uint16_t                datalen)
 {
+    UNUSED_PARAMETER(p_remote);
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(datalen);
+
     if (p_client->client_state == MQTTSN_CLIENT_WAITING_FOR_SLEEP)
     {
+        p_client->client_state       = MQTTSN_CLIENT_ASLEEP;
         p_client->keep_alive.timeout = mqttsn_platform_timer_set_in_ms(p_client->keep_alive.duration);
+        mqttsn_client_timer_reschedule(p_client);
         sleep_handle(p_client);
         return NRF_SUCCESS;
     }
@@ -608,6 +724,7 @@ static uint32_t disconnect_handle(mqttsn_client_t * p_client)
 /**@brief Handles WILLTOPICRESP message received from the gateway.  
  *
  * @param[inout] p_client    Pointer to an MQTT-SN client instance. 
+ * @param[in]    p_remote    Pointer to remote endpoint.
  * @param[in]    p_data      Received data.
  * @param[in]    datalen     Length of the received data.
  *
@@ -615,10 +732,13 @@ static uint32_t disconnect_handle(mqttsn_client_t * p_client)
  *                                  and processed successfully.
  * @retval       NRF_ERROR_INTERNAL Otherwise.
  */
-static uint32_t willtopicresp_handle(mqttsn_client_t * p_client,
-                                     const uint8_t   * p_data,
-                                     uint16_t          datalen)
+static uint32_t willtopicresp_handle(mqttsn_client_t       * p_client,
+                                     const mqttsn_remote_t * p_remote,
+                                     const uint8_t         * p_data,
+                                     uint16_t                datalen)
 {
+    UNUSED_PARAMETER(p_remote);
+
     uint32_t return_code = 0;
     
     // Fix: Moved declarations out of switch to avoid warnings
@@ -640,12 +760,12 @@ static uint32_t willtopicresp_handle(mqttsn_client_t * p_client,
             evt_rc.event_data.error.msg_type = mqttsn_packet_msgtype_error_get(p_data);
             evt_rc.event_data.error.msg_id   = 0;
 
-            mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_MSGTYPE_WILLTOPICUPD, MQTTSN_MESSAGE_TYPE);
+            mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_WILLTOPICUPD, MQTTSN_MESSAGE_TYPE);
             p_client->evt_handler(p_client, &evt_rc);
             return NRF_SUCCESS;
 
         case MQTTSN_RC_ACCEPTED:
-            mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_MSGTYPE_WILLTOPICUPD, MQTTSN_MESSAGE_TYPE);
+            mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_WILLTOPICUPD, MQTTSN_MESSAGE_TYPE);
             evt_acc.event_id = MQTTSN_EVENT_WILL_TOPIC_UPD;
             p_client->evt_handler(p_client, &evt_acc);
             return NRF_SUCCESS;
@@ -659,6 +779,7 @@ static uint32_t willtopicresp_handle(mqttsn_client_t * p_client,
 /**@brief Handles WILLMSGRESP message received from the gateway.  
  *
  * @param[inout] p_client    Pointer to an MQTT-SN client instance. 
+ * @param[in]    p_remote    Pointer to remote endpoint.
  * @param[in]    p_data      Received data.
  * @param[in]    datalen     Length of the received data.
  *
@@ -666,10 +787,13 @@ static uint32_t willtopicresp_handle(mqttsn_client_t * p_client,
  *                                  and processed successfully.
  * @retval       NRF_ERROR_INTERNAL Otherwise.
  */
-static uint32_t willmsgresp_handle(mqttsn_client_t * p_client,
-                                   const uint8_t   * p_data,
-                                   uint16_t          datalen)
+static uint32_t willmsgresp_handle(mqttsn_client_t       * p_client,
+                                   const mqttsn_remote_t * p_remote,
+                                   const uint8_t         * p_data,
+                                   uint16_t                datalen)
 {
+    UNUSED_PARAMETER(p_remote);
+
     uint32_t return_code = 0;
     
     // Fix: Moved declarations out of switch to avoid warnings
@@ -691,12 +815,12 @@ static uint32_t willmsgresp_handle(mqttsn_client_t * p_client,
             evt_rc.event_data.error.msg_type    = mqttsn_packet_msgtype_error_get(p_data);
             evt_rc.event_data.error.msg_id      = 0;
         
-            mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_MSGTYPE_WILLMSGUPD, MQTTSN_MESSAGE_TYPE);
+            mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_WILLMSGUPD, MQTTSN_MESSAGE_TYPE);
             p_client->evt_handler(p_client, &evt_rc);
             return NRF_SUCCESS;
 
         case MQTTSN_RC_ACCEPTED:
-            mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_MSGTYPE_WILLMSGUPD, MQTTSN_MESSAGE_TYPE);
+            mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_WILLMSGUPD, MQTTSN_MESSAGE_TYPE);
             evt_acc.event_id = MQTTSN_EVENT_WILL_MSG_UPD;
             p_client->evt_handler(p_client, &evt_acc); 
             return NRF_SUCCESS;
@@ -707,104 +831,103 @@ static uint32_t willmsgresp_handle(mqttsn_client_t * p_client,
     }
 }
 
-/**@brief Handles message received from the gateway.  
- *
- * @param[inout] p_client     Pointer to an MQTT-SN client instance.
- * @param[in]    p_port       Pointer to local port that received the message.
- * @param[in]    p_remote     Pointer to remote endpoint.
- * @param[in]    p_data       Received data.
- * @param[in]    datalen      Length of the received data.
- * @param[in]    message_type Message Type field value.
- *
- * @retval       NRF_SUCCESS             If message is processed successfully.
- * @retval       NRF_ERROR_NOT_SUPPORTED If message of unsupported type has been received.
- * @retval       Otherwise, appropriate error code is returned.
- */
-static uint32_t message_handle(mqttsn_client_t        * p_client,
-                               const mqttsn_port_t    * p_port,
-                               const mqttsn_remote_t  * p_remote,
-                               const uint8_t          * p_data,
-                               uint16_t                 datalen,
-                               MQTTSN_msgTypes          message_type)
+/**@brief Message type handling. */
+static const mqttsn_message_type_t m_message_types[MQTTSN_MSGTYPE_COUNT] =
 {
-    uint32_t err_code = NRF_ERROR_INVALID_STATE;
-
-    switch(message_type)
-    {
-        case MQTTSN_ADVERTISE:
-            break;
-
-        case MQTTSN_GWINFO:
-            err_code = gwinfo_handle(p_client, p_remote, p_data, datalen);
-            break;
+    [MQTTSN_ADVERTISE]     = { advertise_handle,     4, false, MQTTSN_PACKET_INCORRECT    },
+    [MQTTSN_SEARCHGW]      = { NULL,                 0, false, MQTTSN_PACKET_INCORRECT    },
+    [MQTTSN_GWINFO]        = { gwinfo_handle,        2, false, MQTTSN_PACKET_INCORRECT    },
+    [MQTTSN_RESERVED1]     = { NULL,                 0, false, MQTTSN_PACKET_INCORRECT    },
+    [MQTTSN_CONNECT]       = { NULL,                 0, false, MQTTSN_PACKET_CONNACK      },
+    [MQTTSN_CONNACK]       = { connack_handle,       2, false, MQTTSN_PACKET_CONNACK      },
+    [MQTTSN_WILLTOPICREQ]  = { willtopicreq_handle,  1, false, MQTTSN_PACKET_INCORRECT    },
+    [MQTTSN_WILLTOPIC]     = { NULL,                 0, false, MQTTSN_PACKET_INCORRECT    },
+    [MQTTSN_WILLMSGREQ]    = { willmsgreq_handle,    1, false, MQTTSN_PACKET_INCORRECT    },
+    [MQTTSN_WILLMSG]       = { NULL,                 0, false, MQTTSN_PACKET_INCORRECT    },
+    [MQTTSN_REGISTER]      = { register_handle,      5, false, MQTTSN_PACKET_REGACK       },
+    [MQTTSN_REGACK]        = { regack_handle,        6, true,  MQTTSN_PACKET_REGACK       },
+    [MQTTSN_PUBLISH]       = { publish_handle,       6, false, MQTTSN_PACKET_PUBACK       },
+    [MQTTSN_PUBACK]        = { puback_handle,        6, true,  MQTTSN_PACKET_PUBACK       },
+    [MQTTSN_PUBCOMP]       = { NULL,                 0, false, MQTTSN_PACKET_INCORRECT    },
+    [MQTTSN_PUBREC]        = { NULL,                 0, false, MQTTSN_PACKET_INCORRECT    },
+    [MQTTSN_PUBREL]        = { NULL,                 0, false, MQTTSN_PACKET_INCORRECT    },
+    [MQTTSN_RESERVED2]     = { NULL,                 0, false, MQTTSN_PACKET_INCORRECT    },
+    [MQTTSN_SUBSCRIBE]     = { NULL,                 0, false, MQTTSN_PACKET_SUBACK       },
+    [MQTTSN_SUBACK]        = { suback_handle,        7, true,  MQTTSN_PACKET_SUBACK       },
+    [MQTTSN_UNSUBSCRIBE]   = { NULL,                 0, false, MQTTSN_PACKET_UNSUBACK     },
+    [MQTTSN_UNSUBACK]      = { unsuback_handle,      3, true,  MQTTSN_PACKET_UNSUBACK     },
+    [MQTTSN_PINGREQ]       = { NULL,                 0, false, MQTTSN_PACKET_PINGREQ      },
+    [MQTTSN_PINGRESP]      = { pingresp_handle,      1, false, MQTTSN_PACKET_PINGREQ      },
+    [MQTTSN_DISCONNECT]    = { disconnect_handle,    1, false, MQTTSN_PACKET_INCORRECT    },
+    [MQTTSN_RESERVED3]     = { NULL,                 0, false, MQTTSN_PACKET_INCORRECT    },
+    [MQTTSN_WILLTOPICUPD]  = { NULL,                 0, false, MQTTSN_PACKET_WILLTOPICUPD },
+    [MQTTSN_WILLTOPICRESP] = { willtopicresp_handle, 2, true,  MQTTSN_PACKET_WILLTOPICUPD },
+    [MQTTSN_WILLMSGUPD]    = { NULL,                 0, false, MQTTSN_PACKET_WILLMSGUPD   },
+    [MQTTSN_WILLMSGRESP]   = { willmsgresp_handle,   2, true,  MQTTSN_PACKET_WILLMSGUPD   },
+};
 
-        case MQTTSN_WILLTOPICREQ:
-            err_code = willtopicreq_handle(p_client);
-            break;
-
-        case MQTTSN_WILLMSGREQ:
-            err_code = willmsgreq_handle(p_client);
-            break;
+mqttsn_ack_error_t mqttsn_packet_msgtype_error_get(const uint8_t * p_buffer)
+{
+    uint8_t msg_type = p_buffer[mqttsn_packet_msgtype_index_get(p_buffer)];
 
-        case MQTTSN_CONNACK:
-            err_code = connack_handle(p_client, p_data, datalen);
-            break;
+    return (msg_type < MQTTSN_MSGTYPE_COUNT) ?
+           (mqttsn_ack_error_t)m_message_types[msg_type].ack_error : MQTTSN_PACKET_INCORRECT;
+}
 
-        case MQTTSN_REGISTER:
-            err_code = register_handle(p_client, p_data, datalen);
-            break;
+uint32_t mqttsn_packet_receiver(mqttsn_client_t        * p_client,
+                                const mqttsn_port_t    * p_port,
+                                const mqttsn_remote_t  * p_remote,
+                                const uint8_t          * p_data,
+                                uint16_t                datalen)
+{
+    UNUSED_PARAMETER(p_port);
 
-        case MQTTSN_REGACK:
-            err_code = regack_handle(p_client, p_data, datalen);
-            break;
+    uint16_t offset = 0;
+    uint16_t length = mqttsn_codec_length_read(p_data, datalen, &offset);
 
-        case MQTTSN_PUBLISH:
-            err_code = publish_handle(p_client, p_data, datalen);
-            break;
+    /* Truncated writes must not reach the deserializers, which trust the Length field. */
+    if (length == 0)
+    {
+        p_client->rx_stats.invalid++;
+        NRF_LOG_ERROR("Malformed message has been received.\r\n");
+        return NRF_ERROR_INVALID_LENGTH;
+    }
 
-        case MQTTSN_PUBACK:
-            err_code = puback_handle(p_client, p_data, datalen);
-            break;
+    uint8_t msg_type = p_data[offset];
 
-        case MQTTSN_SUBACK:
-            err_code = suback_handle(p_client, p_data, datalen);
-            break;
-        
-        case MQTTSN_UNSUBACK:
-            err_code = unsuback_handle(p_client, p_data, datalen);
-            break;
+    if (msg_type >= MQTTSN_MSGTYPE_COUNT || m_message_types[msg_type].handler == NULL)
+    {
+        p_client->rx_stats.invalid++;
+        NRF_LOG_ERROR("Message of unsupported type has been received.\r\n");
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
 
-        case MQTTSN_PINGRESP:
-            err_code = pingresp_handle(p_client);
-            break;
+    const mqttsn_message_type_t * p_type = &m_message_types[msg_type];
 
-        case MQTTSN_DISCONNECT:
-            err_code = disconnect_handle(p_client);
-            break;
+    if (length - offset < p_type->fixed_len)
+    {
+        p_client->rx_stats.malformed[msg_type]++;
+        NRF_LOG_ERROR("Message too short for its type has been received.\r\n");
+        return NRF_ERROR_INVALID_LENGTH;
+    }
 
-        case MQTTSN_WILLTOPICRESP:
-            err_code = willtopicresp_handle(p_client, p_data, datalen);
-            break;
+    p_client->rx_stats.received[msg_type]++;
 
-        case MQTTSN_WILLMSGRESP:
-            err_code = willmsgresp_handle(p_client, p_data, datalen);
-            break;
+    uint32_t err_code = p_type->handler(p_client, p_remote, p_data, length);
 
-        default:
-            err_code = NRF_ERROR_NOT_SUPPORTED;
-            NRF_LOG_ERROR("Message of unsupported type has been received.\r\n");
-            break;
+    if (err_code != NRF_SUCCESS)
+    {
+        p_client->rx_stats.rejected[msg_type]++;
+    }
+    /* An answer to the client replaces the PINGREQ/PINGRESP exchange of this keep-alive period.
+     * REGISTER and PUBLISH only do once REGACK or PUBACK has been sent back, as a gateway which
+     * keeps sending cannot tell whether the client still listens. */
+    else if (p_client->client_state == MQTTSN_CLIENT_CONNECTED && p_type->answers_client)
+    {
+        mqttsn_client_keep_alive_refresh(p_client);
     }
 
-    return err_code;
-}
+    mqttsn_retained_save(p_client);
 
-uint32_t mqttsn_packet_receiver(mqttsn_client_t        * p_client,
-                                const mqttsn_port_t    * p_port,
-                                const mqttsn_remote_t  * p_remote,
-                                const uint8_t          * p_data,
-                                uint16_t                datalen)
-{
-    MQTTSN_msgTypes msg_type = (MQTTSN_msgTypes)p_data[mqttsn_packet_msgtype_index_get(p_data)];
-    return message_handle(p_client, p_port, p_remote, p_data, datalen, msg_type);
+    return err_code;
 }
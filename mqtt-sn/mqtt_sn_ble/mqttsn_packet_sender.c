@@ -11,6 +11,9 @@
  */
 
 #include "mqttsn_packet_internal.h"
+#include "app_util.h"
+
+STATIC_ASSERT(MQTTSN_PACKET_HEADER_MAX_LENGTH >= MQTTSN_CODEC_PUBLISH_HEADER_MAX_LENGTH);
 
 #define MQTTSN_PACKET_SEARCHGW_LENGTH     3
 #define MQTTSN_PACKET_CONNECT_LENGTH     (6 + MQTTSN_CLIENT_ID_MAX_LENGTH)
@@ -18,7 +21,6 @@
 #define MQTTSN_PACKET_WILLMSG_LENGTH      2
 #define MQTTSN_PACKET_REGISTER_LENGTH     6
 #define MQTTSN_PACKET_REGACK_LENGTH       7
-#define MQTTSN_PACKET_PUBLISH_LENGTH      7
 #define MQTTSN_PACKET_PUBACK_LENGTH       7
 #define MQTTSN_PACKET_SUBSCRIBE_LENGTH    5
 #define MQTTSN_PACKET_UNSUBSCRIBE_LENGTH  5
@@ -35,6 +37,8 @@
  */
 static uint16_t next_packet_id_get(mqttsn_client_t * p_client)
 {
+    mqttsn_retained_changed(p_client, MQTTSN_RETAINED_IN_FLIGHT);
+
     return (p_client->message_id == MQTTSN_MAX_PACKET_ID) ? 1 : (++(p_client->message_id));
 }
 
@@ -60,10 +64,20 @@ static uint32_t mqttsn_packet_sender_send(mqttsn_client_t       * p_client,
 
 uint32_t mqttsn_packet_sender_retransmit(mqttsn_client_t       * p_client,
                                          const mqttsn_remote_t * p_remote,
-                                         const uint8_t         * p_data,
-                                         uint16_t                datalen)
+                                         const mqttsn_packet_t * p_packet)
 {
-    return mqttsn_packet_sender_send(p_client, p_remote, p_data, datalen);
+    if (p_packet->p_payload == NULL)
+    {
+        return mqttsn_packet_sender_send(p_client, p_remote, mqttsn_packet_data_get(p_packet), p_packet->len);
+    }
+
+    const mqttsn_iovec_t iov[] =
+    {
+        { .p_data = mqttsn_packet_data_get(p_packet), .len = p_packet->len },
+        { .p_data = p_packet->p_payload,              .len = p_packet->payload_len },
+    };
+
+    return mqttsn_transport_writev(p_client, p_remote, iov, sizeof(iov) / sizeof(iov[0]));
 }
 
 uint32_t mqttsn_packet_sender_searchgw(mqttsn_client_t * p_client)
@@ -95,6 +109,7 @@ uint32_t mqttsn_packet_sender_searchgw(mqttsn_client_t * p_client)
             .addr        = MQTTSN_BROADCAST_ADDR,
             .port_number = MQTTSN_DEFAULT_CLIENT_PORT,
         };
+        p_client->gateway_table.searchgw_sent = mqttsn_platform_time_ms_get();
         err_code = mqttsn_packet_sender_send(p_client, &broadcast_search, p_data, datalen);
     }
 
@@ -253,9 +268,9 @@ uint32_t mqttsn_packet_sender_connect(mqttsn_client_t * p_client)
 
     if (err_code == NRF_SUCCESS)
     {
-        if (mqttsn_platform_timer_start(p_client, retransmission_packet.timeout) != NRF_SUCCESS)
+        if (mqttsn_client_timer_reschedule(p_client) != NRF_SUCCESS)
         {
-            mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_MSGTYPE_CONNECT, MQTTSN_MESSAGE_TYPE);
+            mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_CONNECT, MQTTSN_MESSAGE_TYPE);
             err_code = NRF_ERROR_INTERNAL;
         }
     }
@@ -295,19 +310,12 @@ uint32_t mqttsn_packet_sender_register(mqttsn_client_t * p_client,
     uint16_t datalen = 0;
     if (err_code == NRF_SUCCESS)
     {
-        MQTTSNString topic_name =
-        {
-            .lenstring =
-            {
-                .data = (char *)(p_topic->p_topic_name),
-                .len  = topic_name_len,
-            },
-        };
-        datalen = MQTTSNSerialize_register(p_data,
-                                           packet_len,
-                                           0,
-                                           next_packet_id_get(p_client),
-                                           &topic_name);
+        datalen = mqttsn_codec_register_encode(p_data,
+                                               packet_len,
+                                               0,
+                                               next_packet_id_get(p_client),
+                                               p_topic->p_topic_name,
+                                               topic_name_len);
         if (datalen == 0)
         {
             err_code = NRF_ERROR_INVALID_PARAM;
@@ -347,7 +355,7 @@ uint32_t mqttsn_packet_sender_register(mqttsn_client_t * p_client,
 
     if (err_code == NRF_SUCCESS)
     {
-        if (mqttsn_platform_timer_start(p_client, retransmission_packet.timeout) != NRF_SUCCESS)
+        if (mqttsn_client_timer_reschedule(p_client) != NRF_SUCCESS)
         {
             mqttsn_packet_fifo_elem_dequeue(p_client, p_client->message_id, MQTTSN_MESSAGE_ID);
             err_code = NRF_ERROR_INTERNAL;
@@ -389,11 +397,12 @@ uint32_t mqttsn_packet_sender_regack(mqttsn_client_t * p_client,
     uint16_t datalen = 0;
     if (err_code == NRF_SUCCESS)
     {
-        datalen = MQTTSNSerialize_regack(p_data,
-                                         MQTTSN_PACKET_REGACK_LENGTH,
-                                         topic_id,
-                                         packet_id,
-                                         ret_code);
+        datalen = mqttsn_codec_ack_encode(p_data,
+                                          MQTTSN_PACKET_REGACK_LENGTH,
+                                          MQTTSN_REGACK,
+                                          topic_id,
+                                          packet_id,
+                                          ret_code);
         if (datalen == 0)
         {
             err_code = NRF_ERROR_INVALID_PARAM;
@@ -418,96 +427,104 @@ uint32_t mqttsn_packet_sender_publish(mqttsn_client_t * p_client,
                                       const uint8_t   * payload,
                                       uint16_t          payload_len)
 {
-    uint32_t err_code       = NRF_SUCCESS;
+    uint32_t  err_code      = NRF_SUCCESS;
+    bool      queued        = false;
 
-    unsigned char dup       = 0;
-    unsigned char retained  = 0;
-    uint8_t  qos            = 1;
+    uint8_t   flags         = (1 << MQTTSN_FLAG_QOS_POS) | MQTTSN_TOPIC_TYPE_NORMAL;
 
-    uint32_t  packet_len    = MQTTSN_PACKET_PUBLISH_LENGTH + payload_len;
-    uint8_t * p_data        = nrf_malloc(packet_len);
+    uint8_t * p_payload     = NULL;
 
-    if (p_data == NULL)
+    /* The header is kept in the packet, so that a publication takes a single memory block. */
+    mqttsn_packet_t retransmission_packet = 
     {
-        err_code = NRF_ERROR_NO_MEM;
-        NRF_LOG_ERROR("PUBLISH message cannot be allocated\r\n");
+        .retransmission_cnt = MQTTSN_DEFAULT_RETRANSMISSION_CNT,
+        .p_data             = NULL,
+        .payload_len        = payload_len,
+        .topic              = *p_topic, 
+        .timeout            = mqttsn_platform_timer_set_in_ms(MQTTSN_DEFAULT_RETRANSMISSION_TIME_IN_MS),
+    };
+
+    const uint8_t * p_template = mqttsn_topic_table_publish_template_get(p_client, p_topic->topic_id);
+
+    if (p_template != NULL)
+    {
+        retransmission_packet.len = mqttsn_codec_publish_header_patch(retransmission_packet.header,
+                                                                      MQTTSN_PACKET_HEADER_MAX_LENGTH,
+                                                                      p_template,
+                                                                      next_packet_id_get(p_client),
+                                                                      payload_len,
+                                                                      false);
     }
-    
-    uint16_t datalen = 0;
-    if (err_code == NRF_SUCCESS)
+    else
     {
-        MQTTSN_topicid topic = 
-        {
-            .type = MQTTSN_TOPIC_TYPE_NORMAL,
-            .data.id = p_topic->topic_id,
-        };
-        datalen = MQTTSNSerialize_publish(p_data,
-                                          packet_len,
-                                          dup,
-                                          qos,
-                                          retained,
-                                          next_packet_id_get(p_client),
-                                          topic,
-                                          (uint8_t *)payload,
-                                          payload_len);
-        if (datalen == 0)
-        {
-            err_code = NRF_ERROR_INVALID_PARAM;
-        }
+        retransmission_packet.len = mqttsn_codec_publish_header_encode(retransmission_packet.header,
+                                                                       MQTTSN_PACKET_HEADER_MAX_LENGTH,
+                                                                       flags,
+                                                                       p_topic->topic_id,
+                                                                       next_packet_id_get(p_client),
+                                                                       payload_len);
     }
+    retransmission_packet.id = p_client->message_id;
 
-    uint8_t * packet_copy = nrf_malloc(datalen);
-    if (err_code == NRF_SUCCESS)
+    if (retransmission_packet.len == 0)
     {
-        if (packet_copy == NULL)
+        err_code = NRF_ERROR_INVALID_PARAM;
+    }
+
+    /* The payload is copied once, into the buffer kept for retransmissions. The header and the
+     * payload are handed to the transport as separate segments. */
+    if (err_code == NRF_SUCCESS && payload_len != 0)
+    {
+        p_payload = nrf_malloc(payload_len);
+        if (p_payload == NULL)
         {
             err_code = NRF_ERROR_NO_MEM;
+            NRF_LOG_ERROR("PUBLISH payload cannot be allocated\r\n");
         }
         else
         {
-            memcpy(packet_copy, p_data, datalen);
+            memcpy(p_payload, payload, payload_len);
         }
     }
 
-    mqttsn_packet_t retransmission_packet = 
-    {
-        .retransmission_cnt = MQTTSN_DEFAULT_RETRANSMISSION_CNT,
-        .p_data             = packet_copy,
-        .id                 = p_client->message_id,
-        .topic              = *p_topic, 
-        .len                = datalen,
-        .timeout            = mqttsn_platform_timer_set_in_ms(MQTTSN_DEFAULT_RETRANSMISSION_TIME_IN_MS),
-    };
+    retransmission_packet.p_payload = p_payload;
+
     if (err_code == NRF_SUCCESS)
     {
         if (mqttsn_packet_fifo_elem_add(p_client, &retransmission_packet) != NRF_SUCCESS)
         {
             err_code = NRF_ERROR_NO_MEM;
         }
+        else
+        {
+            queued = true;
+        }
     }
 
     if (err_code == NRF_SUCCESS)
     {
-        if (mqttsn_platform_timer_start(p_client, retransmission_packet.timeout) != NRF_SUCCESS)
+        if (mqttsn_client_timer_reschedule(p_client) != NRF_SUCCESS)
         {
-            mqttsn_packet_fifo_elem_dequeue(p_client, p_client->message_id, MQTTSN_MESSAGE_ID);
             err_code = NRF_ERROR_INTERNAL;
         }
     }
 
     if (err_code == NRF_SUCCESS)
     {
-        err_code = mqttsn_packet_sender_send(p_client, &(p_client->gateway_info.addr), p_data, datalen);
-    }
-
-    if (p_data)
-    {
-        nrf_free(p_data);
+        err_code = mqttsn_packet_sender_retransmit(p_client, &(p_client->gateway_info.addr), &retransmission_packet);
     }
 
-    if (packet_copy && err_code != NRF_SUCCESS)
+    if (err_code != NRF_SUCCESS)
     {
-        nrf_free(packet_copy);
+        if (queued)
+        {
+            /* Frees the payload. */
+            mqttsn_packet_fifo_elem_dequeue(p_client, retransmission_packet.id, MQTTSN_MESSAGE_ID);
+        }
+        else if (p_payload)
+        {
+            nrf_free(p_payload);
+        }
     }
 
     return err_code;
@@ -530,7 +547,7 @@ uint32_t mqttsn_packet_sender_puback(mqttsn_client_t * p_client,
     uint16_t datalen = 0;
     if (err_code == NRF_SUCCESS)
     {
-        datalen = MQTTSNSerialize_puback(p_data, MQTTSN_PACKET_PUBACK_LENGTH, topic_id, packet_id, ret_code);
+        datalen = mqttsn_codec_ack_encode(p_data, MQTTSN_PACKET_PUBACK_LENGTH, MQTTSN_PUBACK, topic_id, packet_id, ret_code);
         if (datalen == 0)
         {
             err_code = NRF_ERROR_INVALID_PARAM;
@@ -620,7 +637,7 @@ uint32_t mqttsn_packet_sender_subscribe(mqttsn_client_t * p_client,
 
     if (err_code == NRF_SUCCESS)
     {
-        if (mqttsn_platform_timer_start(p_client, retransmission_packet.timeout) != NRF_SUCCESS)
+        if (mqttsn_client_timer_reschedule(p_client) != NRF_SUCCESS)
         {
             mqttsn_packet_fifo_elem_dequeue(p_client, p_client->message_id, MQTTSN_MESSAGE_ID);
             err_code = NRF_ERROR_INTERNAL;
@@ -711,7 +728,7 @@ uint32_t mqttsn_packet_sender_unsubscribe(mqttsn_client_t * p_client,
 
     if (err_code == NRF_SUCCESS)
     {
-        if (mqttsn_platform_timer_start(p_client, retransmission_packet.timeout) != NRF_SUCCESS)
+        if (mqttsn_client_timer_reschedule(p_client) != NRF_SUCCESS)
         {
             mqttsn_packet_fifo_elem_dequeue(p_client, p_client->message_id, MQTTSN_MESSAGE_ID);
             err_code = NRF_ERROR_INTERNAL;
@@ -856,9 +873,9 @@ uint32_t mqttsn_packet_sender_willtopicupd(mqttsn_client_t * p_client)
 
     if (err_code == NRF_SUCCESS)
     {
-        if (mqttsn_platform_timer_start(p_client, retransmission_packet.timeout) != NRF_SUCCESS)
+        if (mqttsn_client_timer_reschedule(p_client) != NRF_SUCCESS)
         {
-            mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_MSGTYPE_WILLTOPICUPD, MQTTSN_MESSAGE_TYPE);
+            mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_WILLTOPICUPD, MQTTSN_MESSAGE_TYPE);
             err_code = NRF_ERROR_INTERNAL;
         }
     }
@@ -938,9 +955,9 @@ uint32_t mqttsn_packet_sender_willmsgupd(mqttsn_client_t * p_client)
 
     if (err_code == NRF_SUCCESS)
     {
-        if (mqttsn_platform_timer_start(p_client, retransmission_packet.timeout) != NRF_SUCCESS)
+        if (mqttsn_client_timer_reschedule(p_client) != NRF_SUCCESS)
         {
-            mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_MSGTYPE_WILLMSGUPD, MQTTSN_MESSAGE_TYPE);
+            mqttsn_packet_fifo_elem_dequeue(p_client, MQTTSN_WILLMSGUPD, MQTTSN_MESSAGE_TYPE);
             err_code = NRF_ERROR_INTERNAL;
         }
     }
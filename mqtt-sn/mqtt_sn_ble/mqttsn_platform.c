@@ -12,57 +12,173 @@
 
 #include "nrf_drv_rng.h"
 #include "mqttsn_platform.h"
+#include "mqttsn_entropy.h"
 #include "mqttsn_packet_internal.h"
+#include "mqttsn_profile.h"
 #include "app_timer.h"
+#include "app_util_platform.h"
+#include "app_scheduler.h"
 //#include "openthread/platform/random.h"   // Change: removed dependency of openthread library
 
-/* Available timer is 17-bit. 1FFFF is the biggest 17-bit long number. */
-#define MQTTSN_PLATFORM_TIMER_MAX_MS 0x1ffff
+/* app_timer runs on the 24-bit RTC counter. */
+#define MQTTSN_PLATFORM_RTC_BITS      24
 
-APP_TIMER_DEF(m_timer_id);
+/* RTC counter period in milliseconds. */
+#define MQTTSN_PLATFORM_RTC_PERIOD_MS ((uint32_t)(((1ULL << MQTTSN_PLATFORM_RTC_BITS) * 1000 *             \
+                                                   (APP_TIMER_CONFIG_RTC_FREQUENCY + 1)) /            \
+                                                  APP_TIMER_CLOCK_FREQ))
+
+/* Single timer runs are kept below half of the RTC period, so app_timer never sees a wrapped
+ * timeout. The clock timer runs at the same interval, so every wrap is seen by the clock. */
+#define MQTTSN_PLATFORM_TIMER_MAX_MS  (MQTTSN_PLATFORM_RTC_PERIOD_MS / 2)
+
+STATIC_ASSERT(sizeof(app_timer_t) <= MQTTSN_PLATFORM_TIMER_DATA_SIZE);
+
+APP_TIMER_DEF(m_clock_timer_id);
+
+/**@brief RTC counter extended to 64 bits. */
+static mqttsn_clock_counter_t m_rtc_counter;
+
+/**@brief Client state kept across soft resets. The .non_init section is not zeroed at startup. */
+static mqttsn_retained_t m_retained[MQTTSN_RETAINED_MAX_CLIENTS] __attribute__((section(".non_init")));
 
 typedef app_timer_event_t mqttsn_timer_event_t;
 
+/**@brief Gets the app_timer instance stored in a client. */
+static inline app_timer_id_t timer_id_get(mqttsn_client_t * p_client)
+{
+    return (app_timer_id_t)p_client->timer.data;
+}
+
+/**@brief Handles client's timer expiry in thread mode. */
+static void timer_timeout_process(void * p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(event_size);
+
+    mqttsn_client_t * p_client = *(mqttsn_client_t **)p_event_data;
+    mqttsn_client_timer_timeout_handle(p_client);    
+}
+
+/**@brief Handles client's timer expiry in RTC interrupt context by queueing it for thread mode. */
 static void timer_timeout_handler(void * p_context)
 {
     mqttsn_client_t * p_client = (mqttsn_client_t *)p_context;
-    mqttsn_client_timer_timeout_handle(p_client);    
+
+    if (app_sched_event_put(&p_client, sizeof(p_client), timer_timeout_process) != NRF_SUCCESS)
+    {
+        /* Scheduler queue is full. Try again once it had a chance to drain. */
+        (void)app_timer_start(timer_id_get(p_client), APP_TIMER_MIN_TIMEOUT_TICKS, p_client);
+    }
+}
+
+/**@brief Reads the clock, so that the extended RTC counter sees every counter wrap. */
+static void clock_timeout_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+    (void)mqttsn_platform_time_ms_get();
+}
+
+/**@brief Copies the bytes already collected by the RNG driver. The driver's pool is filled from
+ *        RNG interrupts, so reading it never waits for the peripheral.
+ */
+static uint32_t entropy_source(uint8_t * p_buf, uint32_t len)
+{
+    uint8_t available;
+    nrf_drv_rng_bytes_available(&available);
+
+    if (len > available)
+    {
+        len = available;
+    }
+
+    if (len == 0 || nrf_drv_rng_rand(p_buf, (uint8_t)len) != NRF_SUCCESS)
+    {
+        return 0;
+    }
+
+    return len;
 }
 
 uint32_t mqttsn_platform_init()
 {
+    static bool initialized = false;
+
+    if (initialized)
+    {
+        return NRF_SUCCESS;
+    }
+
     nrf_drv_rng_config_t rng_cfg = NRF_DRV_RNG_DEFAULT_CONFIG;
     uint32_t err_code = nrf_drv_rng_init(&rng_cfg);
     APP_ERROR_CHECK(err_code);
-    
-    return mqttsn_platform_timer_init();
+
+    err_code = mqttsn_entropy_init(entropy_source);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_init();
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code = app_timer_create(&m_clock_timer_id, APP_TIMER_MODE_REPEATED, clock_timeout_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code = app_timer_start(m_clock_timer_id, APP_TIMER_TICKS(MQTTSN_PLATFORM_TIMER_MAX_MS), NULL);
+    if (err_code == NRF_SUCCESS)
+    {
+        initialized = true;
+    }
+
+    return err_code;
+}
+
+uint32_t mqttsn_platform_timer_init(mqttsn_client_t * p_client)
+{
+    app_timer_id_t timer_id = timer_id_get(p_client);
+
+    memset(&(p_client->timer), 0, sizeof(p_client->timer));
+    return app_timer_create(&timer_id, APP_TIMER_MODE_SINGLE_SHOT, &timer_timeout_handler);
 }
 
-uint32_t mqttsn_platform_timer_init()
+uint32_t mqttsn_platform_timer_uninit(mqttsn_client_t * p_client)
 {
-    app_timer_init();
-    return app_timer_create(&m_timer_id, APP_TIMER_MODE_SINGLE_SHOT, &timer_timeout_handler);
+    return app_timer_stop(timer_id_get(p_client));
 }
 
 uint32_t mqttsn_platform_timer_start(mqttsn_client_t * p_client, uint32_t timeout_ms)
 {
+    if (timeout_ms > MQTTSN_PLATFORM_TIMER_MAX_MS)
+    {
+        timeout_ms = MQTTSN_PLATFORM_TIMER_MAX_MS;
+    }
+
     uint32_t timeout_ticks = APP_TIMER_TICKS(timeout_ms);
-    return app_timer_start(m_timer_id, timeout_ticks, p_client);
+    if (timeout_ticks < APP_TIMER_MIN_TIMEOUT_TICKS)
+    {
+        timeout_ticks = APP_TIMER_MIN_TIMEOUT_TICKS;
+    }
+    return app_timer_start(timer_id_get(p_client), timeout_ticks, p_client);
 }
 
-uint32_t mqttsn_platform_timer_stop()
+uint32_t mqttsn_platform_timer_stop(mqttsn_client_t * p_client)
 {
-    return app_timer_stop(m_timer_id);
+    return app_timer_stop(timer_id_get(p_client));
 }
 
-uint32_t mqttsn_platform_timer_cnt_get()
+uint64_t mqttsn_platform_time_ms_get()
 {
-    uint32_t timeout_ticks = app_timer_cnt_get();
-    uint32_t timeout_ms =
-        ((uint32_t)ROUNDED_DIV(timeout_ticks * 1000 * (APP_TIMER_CONFIG_RTC_FREQUENCY + 1),
-                               (uint32_t)APP_TIMER_CLOCK_FREQ));
+    uint64_t ticks;
+
+    /* Called from both the timer interrupt and thread mode. */
+    CRITICAL_REGION_ENTER();
+    ticks = mqttsn_clock_counter_extend(&m_rtc_counter, app_timer_cnt_get(), MQTTSN_PLATFORM_RTC_BITS);
+    CRITICAL_REGION_EXIT();
 
-    return timeout_ms;
+    return (ticks * 1000 * (APP_TIMER_CONFIG_RTC_FREQUENCY + 1)) / APP_TIMER_CLOCK_FREQ;
 }
 
 uint32_t mqttsn_platform_timer_resolution_get()
@@ -75,18 +191,31 @@ uint32_t mqttsn_platform_timer_ms_to_ticks(uint32_t timeout_ms)
     return APP_TIMER_TICKS(timeout_ms);
 }
 
-uint32_t mqttsn_platform_timer_set_in_ms(uint32_t timeout_ms)
+uint64_t mqttsn_platform_timer_set_in_ms(uint32_t timeout_ms)
+{
+    return mqttsn_clock_deadline_get(mqttsn_platform_time_ms_get(), timeout_ms);
+}
+
+
+void mqttsn_platform_cycle_counter_init(void)
 {
-    return mqttsn_platform_timer_cnt_get() + timeout_ms;
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT       = 0;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
 }
 
+uint32_t mqttsn_platform_cycle_counter_get(void)
+{
+    return DWT->CYCCNT;
+}
+
+mqttsn_retained_t * mqttsn_platform_retained_get(uint32_t index)
+{
+    return &m_retained[index];
+}
 
 // Change: Removed openthread dependency for random number generation
 uint16_t mqttsn_platform_rand(uint16_t max_val)
 {
-    uint8_t rng_buf[4];
-    nrf_drv_rng_rand(rng_buf, sizeof(rng_buf));
-    uint32_t random = (rng_buf[0] << 24) + (rng_buf[1] << 16) + (rng_buf[2] << 8) + (rng_buf[3]);
-    
-    return random % max_val;
+    return (uint16_t)mqttsn_entropy_bounded_get(max_val);
 }
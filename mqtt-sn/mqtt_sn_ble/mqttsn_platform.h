@@ -16,22 +16,36 @@
 #include <stdint.h>
 
 #include "mqttsn_client.h"
+#include "mqttsn_clock.h"
 
 typedef void (*timer_timeout_handler_t)(void * p_context);
 
 
 /**@brief Initializes the MQTT-SN client's platform.  
+ *
+ * @details Resources shared by all client instances are initialized on the first call only.
  *
  * @return NRF_SUCCESS if the initialization has been successful. Otherwise error code is returned.
  */
 uint32_t mqttsn_platform_init(void);
 
 
-/**@brief Initializes the MQTT-SN platform's timer.  
+/**@brief Initializes the MQTT-SN platform's timer of a client instance.  
+ *
+ * @param[inout] p_client            Pointer to MQTT-SN client instance.
  *
  * @return NRF_SUCCESS if the initialization has been successful. Otherwise error code is returned.
  */
-uint32_t mqttsn_platform_timer_init(void);
+uint32_t mqttsn_platform_timer_init(mqttsn_client_t * p_client);
+
+
+/**@brief Uninitializes the MQTT-SN platform's timer of a client instance.  
+ *
+ * @param[inout] p_client            Pointer to MQTT-SN client instance.
+ *
+ * @return NRF_SUCCESS if the uninitialization has been successful. Otherwise error code is returned.
+ */
+uint32_t mqttsn_platform_timer_uninit(mqttsn_client_t * p_client);
 
 
 /**@brief Starts the MQTT-SN platform's timer. 
@@ -47,22 +61,28 @@ uint32_t mqttsn_platform_timer_start(mqttsn_client_t * p_client, uint32_t timeou
 
 
 /**@brief Stops the MQTT-SN platform's timer.  
+ *
+ * @param[in]    p_client            Pointer to MQTT-SN client instance.
  *
  * @return NRF_SUCCESS if the stop operation has been successful. Otherwise error code is returned.
  */
-uint32_t mqttsn_platform_timer_stop(void);
+uint32_t mqttsn_platform_timer_stop(mqttsn_client_t * p_client);
 
 
-/**@brief Gets the current MQTT-SN platform's timer value.  
+/**@brief Gets the MQTT-SN platform's monotonic time.  
  *
- * @return       Current timer value in milliseconds.
+ * @details The time is counted in 64 bits from platform initialization and does not wrap.
+ *
+ * @return       Current time in milliseconds.
  */
-uint32_t mqttsn_platform_timer_cnt_get(void);
+uint64_t mqttsn_platform_time_ms_get(void);
 
 
-/**@brief Gets the MQTT-SN platform's timer max value in milliseconds.  
+/**@brief Gets the longest timeout the MQTT-SN platform's timer can be started with.  
+ *
+ * @details Longer waits are split into several timer runs.
  *
- * @return       Maximum timer value in milliseconds.
+ * @return       Maximum timeout in milliseconds.
  */
 uint32_t mqttsn_platform_timer_resolution_get(void);
 
@@ -76,20 +96,35 @@ uint32_t mqttsn_platform_timer_resolution_get(void);
 uint32_t mqttsn_platform_timer_ms_to_ticks(uint32_t timeout_ms);
 
 
-/**@brief Sets the MQTT-SN platform's timer timeout.  
+/**@brief Calculates a deadline on the MQTT-SN platform's monotonic time.  
  *
- * @param[in]    timeout_ms Timeout in milliseconds, calculated with current timer value.
+ * @param[in]    timeout_ms Timeout in milliseconds, counted from now.
  *
- * @return       Calculated timeout in ticks.
+ * @return       Absolute deadline in milliseconds.
  */
-uint32_t mqttsn_platform_timer_set_in_ms(uint32_t timeout_ms);
+uint64_t mqttsn_platform_timer_set_in_ms(uint32_t timeout_ms);
+
+
+/**@brief Gets an image of client state kept across soft resets.
+ *
+ * @details There are MQTTSN_RETAINED_MAX_CLIENTS images, placed in RAM which is not initialized at
+ *          startup, so their content is arbitrary after power-on.
+ *
+ * @param[in]    index       Index of the image, lower than MQTTSN_RETAINED_MAX_CLIENTS.
+ *
+ * @return       Pointer to the image.
+ */
+mqttsn_retained_t * mqttsn_platform_retained_get(uint32_t index);
 
 
 /**@brief MQTT-SN platform's random number generator.  
  *
- * @param[in]    max_val  The maximum value of the generated random number.
+ * @details Draws from the entropy pool and never waits for the RNG peripheral. Every value in
+ *          range is equally likely.
+ *
+ * @param[in]    max_val  Exclusive upper bound of the generated random number.
  *
- * @return       Calculated random number. 
+ * @return       Calculated random number in range [0, max_val), or 0 if max_val is 0. 
  */
 uint16_t mqttsn_platform_rand(uint16_t max_val);
 
@@ -0,0 +1,374 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "mqttsn_platform.h"
+#include "mqttsn_platform_posix.h"
+#include "mqttsn_entropy.h"
+#include "mqttsn_packet_internal.h"
+#include "mqttsn_profile.h"
+
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/random.h>
+#include <sys/timerfd.h>
+
+/* Longest single timer run. Longer waits are split by the client. */
+#define MQTTSN_PLATFORM_TIMER_MAX_MS INT32_MAX
+
+/* Number of expired timers handled per epoll_wait call. */
+#define MQTTSN_PLATFORM_POSIX_EVENTS 16
+
+/**@brief Per-client timer, kept in the client's platform timer storage. */
+typedef struct posix_timer_t
+{
+    int      fd;          /**< Timer file descriptor. Valid for the monotonic clock only. */
+    bool     running;     /**< True if the timer is running. */
+    uint64_t deadline_ms; /**< Absolute expiry time of the running timer in milliseconds. */
+} posix_timer_t;
+
+_Static_assert(sizeof(posix_timer_t) <= MQTTSN_PLATFORM_TIMER_DATA_SIZE, "Timer storage too small");
+
+/**@brief Clock driving the timers. */
+static mqttsn_platform_posix_clock_t m_clock = MQTTSN_PLATFORM_POSIX_CLOCK_MONOTONIC;
+
+/**@brief Current value of the virtual clock in milliseconds. */
+static uint64_t m_virtual_now_ms;
+
+/**@brief Clock value at initialization, in milliseconds. */
+static uint64_t m_epoch_ms;
+
+/**@brief epoll instance watching the timer file descriptors of all clients. */
+static int m_epoll_fd = -1;
+
+/**@brief Clients with an initialized timer, linked through their platform timer storage. */
+static mqttsn_client_t * mp_timers;
+
+/**@brief Client state kept across simulated resets, which reinitialize the client only. */
+static mqttsn_retained_t m_retained[MQTTSN_RETAINED_MAX_CLIENTS];
+
+/**@brief Gets the timer stored in a client. */
+static inline posix_timer_t * timer_get(mqttsn_client_t * p_client)
+{
+    return (posix_timer_t *)p_client->timer.data;
+}
+
+/**@brief Gets current time in milliseconds from the selected clock. */
+static uint64_t clock_ms_get(void)
+{
+    if (m_clock == MQTTSN_PLATFORM_POSIX_CLOCK_VIRTUAL)
+    {
+        return m_virtual_now_ms;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+/**@brief Handles timer expiry. */
+static void timer_timeout_handler(void * p_context)
+{
+    mqttsn_client_t * p_client = (mqttsn_client_t *)p_context;
+    mqttsn_client_timer_timeout_handle(p_client);
+}
+
+/**@brief Fires the running timer of a client. */
+static void timer_fire(mqttsn_client_t * p_client)
+{
+    timer_get(p_client)->running = false;
+    timer_timeout_handler(p_client);
+}
+
+/**@brief Finds the client whose running timer expires first, not later than given time. */
+static mqttsn_client_t * timer_earliest_find(uint64_t limit_ms)
+{
+    mqttsn_client_t * p_earliest = NULL;
+
+    for (mqttsn_client_t * p_client = mp_timers; p_client != NULL; p_client = p_client->timer.p_next)
+    {
+        posix_timer_t * p_timer = timer_get(p_client);
+
+        if (p_timer->running && p_timer->deadline_ms <= limit_ms)
+        {
+            if (p_earliest == NULL || p_timer->deadline_ms < timer_get(p_earliest)->deadline_ms)
+            {
+                p_earliest = p_client;
+            }
+        }
+    }
+
+    return p_earliest;
+}
+
+void mqttsn_platform_posix_clock_set(mqttsn_platform_posix_clock_t clock, uint64_t start_ms)
+{
+    m_clock          = clock;
+    m_virtual_now_ms = start_ms;
+}
+
+int mqttsn_platform_posix_fd_get(void)
+{
+    return m_epoll_fd;
+}
+
+uint32_t mqttsn_platform_posix_process(void)
+{
+    struct epoll_event events[MQTTSN_PLATFORM_POSIX_EVENTS];
+
+    if (m_clock != MQTTSN_PLATFORM_POSIX_CLOCK_MONOTONIC)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    int count = epoll_wait(m_epoll_fd, events, MQTTSN_PLATFORM_POSIX_EVENTS, 0);
+    if (count < 0)
+    {
+        return (errno == EINTR) ? NRF_SUCCESS : NRF_ERROR_INTERNAL;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        mqttsn_client_t * p_client = (mqttsn_client_t *)events[i].data.ptr;
+        uint64_t          expirations;
+
+        if (read(timer_get(p_client)->fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        {
+            continue;
+        }
+
+        if (timer_get(p_client)->running)
+        {
+            timer_fire(p_client);
+        }
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t mqttsn_platform_posix_time_advance(uint32_t delta_ms)
+{
+    if (m_clock != MQTTSN_PLATFORM_POSIX_CLOCK_VIRTUAL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    uint64_t          target_ms = m_virtual_now_ms + delta_ms;
+    mqttsn_client_t * p_client;
+
+    /* Handlers may restart timers, so keep firing until no expiry is left in the window. */
+    while ((p_client = timer_earliest_find(target_ms)) != NULL)
+    {
+        m_virtual_now_ms = timer_get(p_client)->deadline_ms;
+        timer_fire(p_client);
+    }
+
+    m_virtual_now_ms = target_ms;
+
+    return NRF_SUCCESS;
+}
+
+/**@brief Copies random bytes from the kernel without waiting for its pool to be initialized. */
+static uint32_t entropy_source(uint8_t * p_buf, uint32_t len)
+{
+    ssize_t copied = getrandom(p_buf, len, GRND_NONBLOCK);
+
+    return (copied > 0) ? (uint32_t)copied : 0;
+}
+
+uint32_t mqttsn_platform_init()
+{
+    static bool initialized = false;
+
+    if (initialized)
+    {
+        return NRF_SUCCESS;
+    }
+
+    /* Virtual time is reported as set, so tests can start it right below a counter boundary. */
+    m_epoch_ms = (m_clock == MQTTSN_PLATFORM_POSIX_CLOCK_VIRTUAL) ? 0 : clock_ms_get();
+
+    if (mqttsn_entropy_init(entropy_source) != NRF_SUCCESS)
+    {
+        return NRF_ERROR_INTERNAL;
+    }
+
+    if (m_clock == MQTTSN_PLATFORM_POSIX_CLOCK_MONOTONIC)
+    {
+        m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (m_epoll_fd < 0)
+        {
+            return NRF_ERROR_INTERNAL;
+        }
+    }
+
+    initialized = true;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t mqttsn_platform_timer_init(mqttsn_client_t * p_client)
+{
+    posix_timer_t * p_timer = timer_get(p_client);
+
+    memset(&(p_client->timer), 0, sizeof(p_client->timer));
+    p_timer->fd = -1;
+
+    if (m_clock == MQTTSN_PLATFORM_POSIX_CLOCK_MONOTONIC)
+    {
+        p_timer->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (p_timer->fd < 0)
+        {
+            return NRF_ERROR_INTERNAL;
+        }
+
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = p_client };
+        if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, p_timer->fd, &event) != 0)
+        {
+            close(p_timer->fd);
+            p_timer->fd = -1;
+            return NRF_ERROR_INTERNAL;
+        }
+    }
+
+    p_client->timer.p_next = mp_timers;
+    mp_timers              = p_client;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t mqttsn_platform_timer_uninit(mqttsn_client_t * p_client)
+{
+    posix_timer_t * p_timer = timer_get(p_client);
+
+    for (mqttsn_client_t ** pp_client = &mp_timers; *pp_client != NULL; pp_client = (mqttsn_client_t **)&((*pp_client)->timer.p_next))
+    {
+        if (*pp_client == p_client)
+        {
+            *pp_client = p_client->timer.p_next;
+            break;
+        }
+    }
+
+    p_timer->running = false;
+
+    if (p_timer->fd >= 0)
+    {
+        /* Closing the descriptor removes it from the epoll set. */
+        close(p_timer->fd);
+        p_timer->fd = -1;
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t mqttsn_platform_timer_start(mqttsn_client_t * p_client, uint32_t timeout_ms)
+{
+    posix_timer_t * p_timer = timer_get(p_client);
+
+    if (p_timer->running)
+    {
+        return NRF_SUCCESS;
+    }
+
+    if (timeout_ms > MQTTSN_PLATFORM_TIMER_MAX_MS)
+    {
+        timeout_ms = MQTTSN_PLATFORM_TIMER_MAX_MS;
+    }
+
+    p_timer->deadline_ms = clock_ms_get() + timeout_ms;
+    p_timer->running     = true;
+
+    if (m_clock == MQTTSN_PLATFORM_POSIX_CLOCK_VIRTUAL)
+    {
+        return NRF_SUCCESS;
+    }
+
+    /* A zero it_value would disarm the timerfd, so expire at least one nanosecond from now. */
+    struct itimerspec spec =
+    {
+        .it_interval = { 0, 0 },
+        .it_value    = { .tv_sec  = timeout_ms / 1000,
+                         .tv_nsec = (timeout_ms % 1000) * 1000000 + 1 },
+    };
+
+    if (timerfd_settime(p_timer->fd, 0, &spec, NULL) != 0)
+    {
+        p_timer->running = false;
+        return NRF_ERROR_INTERNAL;
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t mqttsn_platform_timer_stop(mqttsn_client_t * p_client)
+{
+    posix_timer_t * p_timer = timer_get(p_client);
+
+    p_timer->running = false;
+
+    if (m_clock == MQTTSN_PLATFORM_POSIX_CLOCK_VIRTUAL)
+    {
+        return NRF_SUCCESS;
+    }
+
+    const struct itimerspec spec = { { 0, 0 }, { 0, 0 } };
+
+    return (timerfd_settime(p_timer->fd, 0, &spec, NULL) == 0) ? NRF_SUCCESS : NRF_ERROR_INTERNAL;
+}
+
+uint64_t mqttsn_platform_time_ms_get()
+{
+    return clock_ms_get() - m_epoch_ms;
+}
+
+uint32_t mqttsn_platform_timer_resolution_get()
+{
+    return MQTTSN_PLATFORM_TIMER_MAX_MS;
+}
+
+uint32_t mqttsn_platform_timer_ms_to_ticks(uint32_t timeout_ms)
+{
+    /* Timer tick is one millisecond. */
+    return timeout_ms;
+}
+
+uint64_t mqttsn_platform_timer_set_in_ms(uint32_t timeout_ms)
+{
+    return mqttsn_clock_deadline_get(mqttsn_platform_time_ms_get(), timeout_ms);
+}
+
+uint16_t mqttsn_platform_rand(uint16_t max_val)
+{
+    return (uint16_t)mqttsn_entropy_bounded_get(max_val);
+}
+
+mqttsn_retained_t * mqttsn_platform_retained_get(uint32_t index)
+{
+    return &m_retained[index];
+}
+
+void mqttsn_platform_cycle_counter_init(void)
+{
+    /* CLOCK_MONOTONIC needs no setup. */
+}
+
+uint32_t mqttsn_platform_cycle_counter_get(void)
+{
+    struct timespec now;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec);
+}
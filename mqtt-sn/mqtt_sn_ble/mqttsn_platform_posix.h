@@ -0,0 +1,73 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#ifndef MQTTSN_PLATFORM_POSIX_H
+#define MQTTSN_PLATFORM_POSIX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mqttsn_platform.h"
+
+/**@brief POSIX platform's timer mode. */
+typedef enum mqttsn_platform_posix_clock_t
+{
+    MQTTSN_PLATFORM_POSIX_CLOCK_MONOTONIC = 0, /**< Timer driven by CLOCK_MONOTONIC and a timerfd. */
+    MQTTSN_PLATFORM_POSIX_CLOCK_VIRTUAL        /**< Timer driven by mqttsn_platform_posix_time_advance. */
+} mqttsn_platform_posix_clock_t;
+
+
+/**@brief Selects the clock driving the POSIX platform's timer.
+ *
+ * @note Must be called before @ref mqttsn_platform_init.
+ *
+ * @param[in]    clock       Clock to use.
+ * @param[in]    start_ms    Initial value of the virtual clock in milliseconds. Platform time
+ *                           starts at this value, so deadlines crossing a 32-bit boundary can
+ *                           be reproduced. Ignored for the monotonic clock.
+ */
+void mqttsn_platform_posix_clock_set(mqttsn_platform_posix_clock_t clock, uint64_t start_ms);
+
+
+/**@brief Gets the file descriptor signalled when any client's timer expires.
+ *
+ * @details The descriptor is an epoll instance watching the timers of all client instances. It
+ *          becomes readable on expiry and can be added to the application's poll or epoll set.
+ *          @ref mqttsn_platform_posix_process shall be called when it is.
+ *
+ * @return       Timer file descriptor, or -1 if the virtual clock is in use.
+ */
+int mqttsn_platform_posix_fd_get(void);
+
+
+/**@brief Processes the platform's timer expiries.
+ *
+ * @details Calls the timeout handler of every MQTT-SN client whose timer has expired. Does not block.
+ *
+ * @return NRF_SUCCESS if the timer has been processed. Otherwise error code is returned.
+ */
+uint32_t mqttsn_platform_posix_process(void);
+
+
+/**@brief Advances the virtual clock.
+ *
+ * @details Every timer expiry falling within the advanced period is handled in order, with the
+ *          clock set to the expiry time while the client's timeout handler runs.
+ *
+ * @param[in]    delta_ms    Time in milliseconds to advance the clock by.
+ *
+ * @return NRF_SUCCESS if the clock has been advanced.
+ *         NRF_ERROR_INVALID_STATE if the virtual clock is not in use.
+ */
+uint32_t mqttsn_platform_posix_time_advance(uint32_t delta_ms);
+
+#endif // MQTTSN_PLATFORM_POSIX_H
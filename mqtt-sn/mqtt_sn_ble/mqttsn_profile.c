@@ -0,0 +1,94 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "mqttsn_profile.h"
+#include "nrf_log.h"
+#include <string.h>
+
+static mqttsn_profile_entry_t m_profile_table[MQTTSN_PROFILE_TABLE_MAX_LENGTH];
+
+/**@brief Number of calls dropped because the table was full. */
+static uint32_t m_profile_dropped;
+
+void mqttsn_profile_init(void)
+{
+    mqttsn_platform_cycle_counter_init();
+
+    memset(m_profile_table, 0, sizeof(m_profile_table));
+    m_profile_dropped = 0;
+}
+
+void mqttsn_profile_record(const char * p_name, uint32_t start)
+{
+    uint32_t cycles = mqttsn_platform_cycle_counter_get() - start;
+
+    for (int i = 0; i < MQTTSN_PROFILE_TABLE_MAX_LENGTH; i++)
+    {
+        mqttsn_profile_entry_t * p_entry = &m_profile_table[i];
+
+        if (p_entry->p_name == NULL)
+        {
+            p_entry->p_name = p_name;
+        }
+
+        if (p_entry->p_name == p_name)
+        {
+            p_entry->calls++;
+            p_entry->total += cycles;
+
+            if (cycles > p_entry->max)
+            {
+                p_entry->max = cycles;
+            }
+
+            return;
+        }
+    }
+
+    m_profile_dropped++;
+}
+
+const mqttsn_profile_entry_t * mqttsn_profile_entry_get(uint32_t index)
+{
+    if (index >= MQTTSN_PROFILE_TABLE_MAX_LENGTH || m_profile_table[index].p_name == NULL)
+    {
+        return NULL;
+    }
+
+    return &m_profile_table[index];
+}
+
+void mqttsn_profile_dump(void)
+{
+    NRF_LOG_INFO("Profile: function, calls, average, max\r\n");
+
+    for (int i = 0; i < MQTTSN_PROFILE_TABLE_MAX_LENGTH; i++)
+    {
+        const mqttsn_profile_entry_t * p_entry = &m_profile_table[i];
+
+        if (p_entry->p_name == NULL)
+        {
+            break;
+        }
+
+        NRF_LOG_INFO("%s, %d, %d, %d\r\n",
+                     (uint32_t)p_entry->p_name,
+                     p_entry->calls,
+                     (uint32_t)(p_entry->total / p_entry->calls),
+                     p_entry->max);
+    }
+
+    if (m_profile_dropped != 0)
+    {
+        NRF_LOG_WARNING("Profile table full, %d calls dropped\r\n", m_profile_dropped);
+    }
+}
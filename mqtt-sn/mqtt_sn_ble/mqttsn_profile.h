@@ -0,0 +1,105 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/**@file mqttsn_profile.h
+ *
+ * @brief Per-function cycle counting for the MQTT-SN codec.
+ *
+ * @details Built with MQTTSN_PROFILE_ENABLED set to 1, the Paho FUNC_ENTRY and FUNC_EXIT_RC
+ *          macros in StackTrace.h count the cycles spent in each function into a fixed table.
+ *          Cycles come from @ref mqttsn_platform_cycle_counter_get. Otherwise the macros compile
+ *          to nothing and this module adds no code.
+ *
+ *          The table is not protected against concurrent updates, so profiled functions must
+ *          only be called from thread mode.
+ */
+
+#ifndef MQTTSN_PROFILE_H
+#define MQTTSN_PROFILE_H
+
+#include <stdint.h>
+
+/**@brief Enables the cycle counting trace. */
+#ifndef MQTTSN_PROFILE_ENABLED
+#define MQTTSN_PROFILE_ENABLED 0
+#endif
+
+/**@brief Maximum number of functions recorded. Calls of further functions are dropped. */
+#ifndef MQTTSN_PROFILE_TABLE_MAX_LENGTH
+#define MQTTSN_PROFILE_TABLE_MAX_LENGTH 32
+#endif
+
+#if MQTTSN_PROFILE_ENABLED
+
+/**@brief Starts measuring the enclosing function. Must come after its declarations. */
+#define MQTTSN_PROFILE_ENTRY   const uint32_t mqttsn_profile_start = mqttsn_platform_cycle_counter_get()
+
+/**@brief Records the cycles spent since @ref MQTTSN_PROFILE_ENTRY in the enclosing function. */
+#define MQTTSN_PROFILE_EXIT    mqttsn_profile_record(__func__, mqttsn_profile_start)
+
+#else
+
+#define MQTTSN_PROFILE_ENTRY
+#define MQTTSN_PROFILE_EXIT
+
+#endif // MQTTSN_PROFILE_ENABLED
+
+/**@brief Recorded cost of a single function. */
+typedef struct mqttsn_profile_entry_t
+{
+    const char * p_name; /**< Function name. NULL if the entry is free. */
+    uint32_t     calls;  /**< Number of recorded calls. */
+    uint64_t     total;  /**< Cycles spent in all recorded calls. */
+    uint32_t     max;    /**< Cycles spent in the most expensive call. */
+} mqttsn_profile_entry_t;
+
+
+/**@brief Gets the platform's free-running cycle counter.
+ *
+ * @details Counts CPU cycles on the target and nanoseconds on the POSIX platform. The counter
+ *          wraps, so only differences between two readings are meaningful.
+ *
+ * @return       Current counter value.
+ */
+uint32_t mqttsn_platform_cycle_counter_get(void);
+
+
+/**@brief Starts the platform's cycle counter. Called by @ref mqttsn_profile_init. */
+void mqttsn_platform_cycle_counter_init(void);
+
+
+/**@brief Starts the cycle counter and clears the table. */
+void mqttsn_profile_init(void);
+
+
+/**@brief Adds a call to the table.
+ *
+ * @param[in]    p_name      Function name. Entries are matched by pointer, so it must be a string
+ *                           with static storage, like __func__.
+ * @param[in]    start       Cycle counter value at function entry.
+ */
+void mqttsn_profile_record(const char * p_name, uint32_t start);
+
+
+/**@brief Gets a table entry.
+ *
+ * @param[in]    index       Entry index.
+ *
+ * @return       Pointer to the entry, or NULL if @p index is out of range or the entry is free.
+ */
+const mqttsn_profile_entry_t * mqttsn_profile_entry_get(uint32_t index);
+
+
+/**@brief Logs the table. With the RTT log backend the output is read over RTT. */
+void mqttsn_profile_dump(void);
+
+#endif // MQTTSN_PROFILE_H
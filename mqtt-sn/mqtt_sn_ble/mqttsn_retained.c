@@ -0,0 +1,513 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "mqttsn_packet_internal.h"
+#include <stddef.h>
+
+/**@brief Marker of a valid image. The image size is mixed in, so that an image left behind by
+ *        firmware with another layout is not restored. */
+#define RETAINED_MAGIC          (0x4D51534EUL ^ (uint32_t)sizeof(mqttsn_retained_t))
+
+/**@brief Number of bytes summed before the Fletcher sums have to be reduced. */
+#define FLETCHER_BLOCK_LENGTH   4096
+
+/**@brief Clients which have taken each image since startup. */
+static const mqttsn_client_t * mp_owners[MQTTSN_RETAINED_MAX_CLIENTS];
+
+/**@brief Computes Fletcher-32 checksum.
+ *
+ * @param[in]    p_data      Data to be summed.
+ * @param[in]    len         Length of the data.
+ *
+ * @return       Checksum of the data.
+ */
+static uint32_t checksum_compute(const uint8_t * p_data, uint32_t len)
+{
+    uint32_t sum1 = 0xFFFF;
+    uint32_t sum2 = 0xFFFF;
+
+    while (len > 0)
+    {
+        uint32_t block = (len > FLETCHER_BLOCK_LENGTH) ? FLETCHER_BLOCK_LENGTH : len;
+
+        len -= block;
+
+        while (block-- > 0)
+        {
+            sum1 += *p_data++;
+            sum2 += sum1;
+        }
+
+        sum1 = (sum1 & 0xFFFF) + (sum1 >> 16);
+        sum2 = (sum2 & 0xFFFF) + (sum2 >> 16);
+    }
+
+    sum1 = (sum1 & 0xFFFF) + (sum1 >> 16);
+    sum2 = (sum2 & 0xFFFF) + (sum2 >> 16);
+
+    return (sum2 << 16) | sum1;
+}
+
+/**@brief Computes checksum of the session part of an image.
+ *
+ * @param[in]    p_session   Session part.
+ *
+ * @return       Checksum of the part past the checksum field.
+ */
+static uint32_t session_checksum_compute(const mqttsn_retained_session_t * p_session)
+{
+    return checksum_compute((const uint8_t *)&(p_session->port),
+                            sizeof(mqttsn_retained_session_t) - offsetof(mqttsn_retained_session_t, port));
+}
+
+/**@brief Computes checksum of the deferred part of an image.
+ *
+ * @param[in]    p_deferred  Deferred part, holding at most MQTTSN_DEFERRED_QUEUE_MAX_LENGTH
+ *                           publications.
+ *
+ * @return       Checksum of the part past the checksum field, up to the last publication.
+ */
+static uint32_t deferred_checksum_compute(const mqttsn_retained_deferred_t * p_deferred)
+{
+    return checksum_compute((const uint8_t *)&(p_deferred->replay_interval),
+                            offsetof(mqttsn_retained_deferred_t, publish)
+                            - offsetof(mqttsn_retained_deferred_t, replay_interval)
+                            + p_deferred->num_of_elements * sizeof(mqttsn_deferred_publish_t));
+}
+
+/**@brief Computes checksum of the in-flight part of an image.
+ *
+ * @param[in]    p_in_flight In-flight part, holding at most MQTTSN_PACKET_FIFO_MAX_LENGTH
+ *                           publications.
+ *
+ * @return       Checksum of the part past the checksum field, up to the last publication.
+ */
+static uint32_t in_flight_checksum_compute(const mqttsn_retained_in_flight_t * p_in_flight)
+{
+    return checksum_compute((const uint8_t *)&(p_in_flight->message_id),
+                            offsetof(mqttsn_retained_in_flight_t, publish)
+                            - offsetof(mqttsn_retained_in_flight_t, message_id)
+                            + p_in_flight->num_of_elements * sizeof(mqttsn_retained_publish_t));
+}
+
+/**@brief Checks if an image holds a valid client state.
+ *
+ * @param[in]    p_image     Retained image.
+ *
+ * @return       True if the image is valid.
+ */
+static bool image_is_valid(const mqttsn_retained_t * p_image)
+{
+    return p_image->magic == RETAINED_MAGIC                                         &&
+           p_image->deferred.num_of_elements <= MQTTSN_DEFERRED_QUEUE_MAX_LENGTH    &&
+           p_image->in_flight.num_of_elements <= MQTTSN_PACKET_FIFO_MAX_LENGTH      &&
+           p_image->session.checksum == session_checksum_compute(&(p_image->session))  &&
+           p_image->deferred.checksum == deferred_checksum_compute(&(p_image->deferred)) &&
+           p_image->in_flight.checksum == in_flight_checksum_compute(&(p_image->in_flight));
+}
+
+/**@brief Gets the image taken by a client.
+ *
+ * @param[in]    p_client    Pointer to MQTT-SN client.
+ *
+ * @return       Pointer to the image, or NULL if the client has not taken one.
+ */
+static mqttsn_retained_t * image_get(const mqttsn_client_t * p_client)
+{
+    for (uint32_t i = 0; i < MQTTSN_RETAINED_MAX_CLIENTS; i++)
+    {
+        if (mp_owners[i] == p_client)
+        {
+            return mqttsn_platform_retained_get(i);
+        }
+    }
+
+    return NULL;
+}
+
+/**@brief Chooses the image a client takes.
+ *
+ * @param[in]    p_client    Pointer to MQTT-SN client.
+ * @param[in]    port        Port the client is bound to.
+ *
+ * @return       Index of the image, or MQTTSN_RETAINED_MAX_CLIENTS if all are taken by other
+ *               clients.
+ */
+static uint32_t image_choose(const mqttsn_client_t * p_client, uint16_t port)
+{
+    uint32_t invalid = MQTTSN_RETAINED_MAX_CLIENTS;
+    uint32_t other   = MQTTSN_RETAINED_MAX_CLIENTS;
+
+    for (uint32_t i = 0; i < MQTTSN_RETAINED_MAX_CLIENTS; i++)
+    {
+        const mqttsn_retained_t * p_image = mqttsn_platform_retained_get(i);
+
+        if (mp_owners[i] != NULL && mp_owners[i] != p_client)
+        {
+            continue;
+        }
+
+        if (!image_is_valid(p_image))
+        {
+            invalid = (invalid == MQTTSN_RETAINED_MAX_CLIENTS) ? i : invalid;
+        }
+        else if (p_image->session.port == port)
+        {
+            return i;
+        }
+        else
+        {
+            other = (other == MQTTSN_RETAINED_MAX_CLIENTS) ? i : other;
+        }
+    }
+
+    /* The image of a port no client is bound to since startup is only reused as a last resort. */
+    return (invalid != MQTTSN_RETAINED_MAX_CLIENTS) ? invalid : other;
+}
+
+/**@brief Gets PUBLISH message header of a queued packet.
+ *
+ * @param[in]    p_packet    Queued packet.
+ *
+ * @return       Pointer to the Message Type field, or NULL if the packet is not a PUBLISH message
+ *               with a normal topic ID.
+ */
+static uint8_t * publish_header_get(const mqttsn_packet_t * p_packet)
+{
+    uint8_t * p_data = mqttsn_packet_data_get(p_packet);
+    uint32_t  index  = mqttsn_packet_msgtype_index_get(p_data);
+    uint8_t * p_type = &(p_data[index]);
+
+    if (p_packet->len < index + MQTTSN_CODEC_PUBLISH_FIXED_LENGTH ||
+        p_type[0] != MQTTSN_PUBLISH                                ||
+        (p_type[MQTTSN_OFFSET_PUBLISH_FLAGS] & MQTTSN_FLAG_TOPIC_ID_TYPE_MASK) != MQTTSN_TOPIC_TYPE_NORMAL)
+    {
+        return NULL;
+    }
+
+    return p_type;
+}
+
+/**@brief Copies a queued PUBLISH message to a retained slot.
+ *
+ * @param[in]    p_client    Pointer to initialized client.
+ * @param[in]    p_packet    Queued packet.
+ * @param[out]   p_slot      Retained slot.
+ *
+ * @retval       true        If the message has been copied.
+ * @retval       false       If the packet is not a PUBLISH message or it is too long.
+ */
+static bool publish_retain(const mqttsn_client_t     * p_client,
+                           const mqttsn_packet_t     * p_packet,
+                           mqttsn_retained_publish_t * p_slot)
+{
+    const uint8_t * p_header = publish_header_get(p_packet);
+
+    if (p_header == NULL)
+    {
+        return false;
+    }
+
+    if (p_packet->len + p_packet->payload_len > MQTTSN_RETAINED_PUBLISH_MAX_LENGTH)
+    {
+        NRF_LOG_ERROR("PUBLISH message too long to be retained\r\n");
+        return false;
+    }
+
+    const uint8_t * p_data = mqttsn_packet_data_get(p_packet);
+
+    memcpy(p_slot->p_msg, p_data, p_packet->len);
+    if (p_packet->payload_len != 0)
+    {
+        memcpy(&(p_slot->p_msg[p_packet->len]), p_packet->p_payload, p_packet->payload_len);
+    }
+    p_slot->len = p_packet->len + p_packet->payload_len;
+
+    /* Held messages carry the application's topic ID already. The gateway's one does not survive
+     * the reset. */
+    if (p_packet->timeout != MQTTSN_CLOCK_DEADLINE_NONE)
+    {
+        uint8_t * p_topic_id = &(p_slot->p_msg[(p_header - p_data) + MQTTSN_OFFSET_PUBLISH_TOPIC_ID]);
+
+        mqttsn_codec_uint16_write(p_topic_id,
+                                  mqttsn_topic_table_app_id_get(p_client, mqttsn_codec_uint16_read(p_topic_id)));
+    }
+
+    return true;
+}
+
+/**@brief Queues a retained PUBLISH message again, held until the client is connected.
+ *
+ * @param[inout] p_client    Pointer to MQTT-SN client.
+ * @param[in]    p_slot      Retained slot.
+ *
+ * @retval       true        If the message has been queued.
+ * @retval       false       If the slot is malformed or there is no memory for the message.
+ */
+static bool publish_restore(mqttsn_client_t * p_client, const mqttsn_retained_publish_t * p_slot)
+{
+    uint8_t         flags;
+    uint16_t        topic_id;
+    uint16_t        packet_id;
+    uint16_t        payload_len;
+    const uint8_t * p_payload;
+
+    if (p_slot->len > MQTTSN_RETAINED_PUBLISH_MAX_LENGTH ||
+        !mqttsn_codec_publish_decode(p_slot->p_msg, p_slot->len, &flags, &topic_id, &packet_id,
+                                     &p_payload, &payload_len) ||
+        payload_len == 0)
+    {
+        return false;
+    }
+
+    uint8_t * p_copy = nrf_malloc(payload_len);
+
+    if (p_copy == NULL)
+    {
+        NRF_LOG_ERROR("Retained PUBLISH message cannot be allocated\r\n");
+        return false;
+    }
+
+    memcpy(p_copy, p_payload, payload_len);
+
+    /* The gateway may have received the message before the reset. */
+    mqttsn_packet_t packet =
+    {
+        .retransmission_cnt = MQTTSN_DEFAULT_RETRANSMISSION_CNT,
+        .p_data             = NULL,
+        .p_payload          = p_copy,
+        .payload_len        = payload_len,
+        .id                 = packet_id,
+        .topic              = { .topic_id = topic_id },
+        .timeout            = MQTTSN_CLOCK_DEADLINE_NONE,
+    };
+
+    packet.len = mqttsn_codec_publish_header_encode(packet.header,
+                                                    MQTTSN_PACKET_HEADER_MAX_LENGTH,
+                                                    flags | MQTTSN_FLAG_DUP,
+                                                    topic_id,
+                                                    packet_id,
+                                                    payload_len);
+
+    if (mqttsn_packet_fifo_elem_add(p_client, &packet) != NRF_SUCCESS)
+    {
+        nrf_free(p_copy);
+        return false;
+    }
+
+    return true;
+}
+
+/**@brief Copies the gateway and the topic table to the image.
+ *
+ * @param[in]    p_client    Pointer to initialized client.
+ * @param[inout] p_session   Session part of the image, holding the port already.
+ */
+static void session_save(const mqttsn_client_t * p_client, mqttsn_retained_session_t * p_session)
+{
+    memcpy(&(p_session->gateway_info), &(p_client->gateway_info), sizeof(mqttsn_gw_info_t));
+    memcpy(&(p_session->topic_table), &(p_client->topic_table), sizeof(mqttsn_topic_table_t));
+
+    p_session->checksum = session_checksum_compute(p_session);
+}
+
+/**@brief Copies the deferred queue to the image, oldest publication first.
+ *
+ * @param[in]    p_client    Pointer to initialized client.
+ * @param[out]   p_deferred  Deferred part of the image.
+ */
+static void deferred_save(const mqttsn_client_t * p_client, mqttsn_retained_deferred_t * p_deferred)
+{
+    const mqttsn_deferred_queue_t * p_queue = &(p_client->deferred_queue);
+
+    p_deferred->replay_interval = p_queue->replay_interval;
+    p_deferred->num_of_elements = p_queue->num_of_elements;
+
+    for (uint8_t i = 0; i < p_queue->num_of_elements; i++)
+    {
+        p_deferred->publish[i] = p_queue->publish[(p_queue->head + i) % MQTTSN_DEFERRED_QUEUE_MAX_LENGTH];
+    }
+
+    p_deferred->checksum = deferred_checksum_compute(p_deferred);
+}
+
+/**@brief Copies the message ID and the PUBLISH messages of the packet queue to the image.
+ *
+ * @param[in]    p_client    Pointer to initialized client.
+ * @param[out]   p_in_flight In-flight part of the image.
+ */
+static void in_flight_save(const mqttsn_client_t * p_client, mqttsn_retained_in_flight_t * p_in_flight)
+{
+    uint8_t slot = 0;
+
+    for (int i = 0; i < p_client->packet_queue.num_of_elements; i++)
+    {
+        if (publish_retain(p_client, &(p_client->packet_queue.packet[i]), &(p_in_flight->publish[slot])))
+        {
+            slot++;
+        }
+    }
+
+    p_in_flight->message_id      = p_client->message_id;
+    p_in_flight->num_of_elements = slot;
+    p_in_flight->checksum        = in_flight_checksum_compute(p_in_flight);
+}
+
+void mqttsn_retained_init(mqttsn_client_t * p_client, uint16_t port)
+{
+    uint32_t index = image_choose(p_client, port);
+
+    /* A client initialized again for another port gives up the image it has taken before. */
+    for (uint32_t i = 0; i < MQTTSN_RETAINED_MAX_CLIENTS; i++)
+    {
+        if (i != index && mp_owners[i] == p_client)
+        {
+            mqttsn_platform_retained_get(i)->magic = 0;
+            mp_owners[i]                           = NULL;
+        }
+    }
+
+    if (index == MQTTSN_RETAINED_MAX_CLIENTS)
+    {
+        NRF_LOG_INFO("No retained image left, state of port %d is not kept across resets\r\n", port);
+        return;
+    }
+
+    mp_owners[index] = p_client;
+
+    mqttsn_retained_t * p_image = mqttsn_platform_retained_get(index);
+
+    if (!image_is_valid(p_image) || p_image->session.port != port)
+    {
+        if (image_is_valid(p_image))
+        {
+            NRF_LOG_ERROR("Retained state of port %d discarded\r\n", p_image->session.port);
+        }
+
+        /* Invalid until the first save, which writes every part and keeps the port. */
+        p_image->magic           = 0;
+        p_image->session.port    = port;
+        p_client->retained_dirty = MQTTSN_RETAINED_ALL;
+        return;
+    }
+
+    const mqttsn_retained_deferred_t * p_deferred = &(p_image->deferred);
+
+    p_client->message_id = p_image->in_flight.message_id;
+    memcpy(&(p_client->gateway_info), &(p_image->session.gateway_info), sizeof(mqttsn_gw_info_t));
+    memcpy(&(p_client->topic_table), &(p_image->session.topic_table), sizeof(mqttsn_topic_table_t));
+    memcpy(p_client->deferred_queue.publish,
+           p_deferred->publish,
+           p_deferred->num_of_elements * sizeof(mqttsn_deferred_publish_t));
+    p_client->deferred_queue.head            = 0;
+    p_client->deferred_queue.num_of_elements = p_deferred->num_of_elements;
+    p_client->deferred_queue.replay_interval = p_deferred->replay_interval;
+
+    /* The image holds the restored state already, unless a publication is lost. */
+    p_client->retained_dirty = 0;
+
+    for (uint8_t i = 0; i < p_image->in_flight.num_of_elements; i++)
+    {
+        /* A packet queue slot is left for CONNECT message, or the client could never reconnect. */
+        if (p_client->packet_queue.num_of_elements == MQTTSN_PACKET_FIFO_MAX_LENGTH - 1 ||
+            !publish_restore(p_client, &(p_image->in_flight.publish[i])))
+        {
+            NRF_LOG_ERROR("Retained PUBLISH message lost\r\n");
+            p_client->retained_dirty = MQTTSN_RETAINED_IN_FLIGHT;
+        }
+    }
+
+    NRF_LOG_INFO("Restored %d unacknowledged and %d deferred publications\r\n",
+                 p_client->packet_queue.num_of_elements,
+                 p_client->deferred_queue.num_of_elements);
+}
+
+void mqttsn_retained_uninit(const mqttsn_client_t * p_client)
+{
+    for (uint32_t i = 0; i < MQTTSN_RETAINED_MAX_CLIENTS; i++)
+    {
+        if (mp_owners[i] == p_client)
+        {
+            mqttsn_platform_retained_get(i)->magic = 0;
+            mp_owners[i]                           = NULL;
+        }
+    }
+}
+
+void mqttsn_retained_save(mqttsn_client_t * p_client)
+{
+    if (p_client->retained_dirty == 0)
+    {
+        return;
+    }
+
+    mqttsn_retained_t * p_image = image_get(p_client);
+
+    if (p_image != NULL)
+    {
+        /* A reset before the checksum of a part is written loses the image. */
+        if (p_client->retained_dirty & MQTTSN_RETAINED_SESSION)
+        {
+            session_save(p_client, &(p_image->session));
+        }
+
+        if (p_client->retained_dirty & MQTTSN_RETAINED_DEFERRED)
+        {
+            deferred_save(p_client, &(p_image->deferred));
+        }
+
+        if (p_client->retained_dirty & MQTTSN_RETAINED_IN_FLIGHT)
+        {
+            in_flight_save(p_client, &(p_image->in_flight));
+        }
+
+        p_image->magic = RETAINED_MAGIC;
+    }
+
+    p_client->retained_dirty = 0;
+}
+
+void mqttsn_retained_release(mqttsn_client_t * p_client)
+{
+    bool released = false;
+
+    for (int i = 0; i < p_client->packet_queue.num_of_elements; i++)
+    {
+        mqttsn_packet_t * p_packet = &(p_client->packet_queue.packet[i]);
+        uint8_t         * p_header = publish_header_get(p_packet);
+
+        if (p_packet->timeout != MQTTSN_CLOCK_DEADLINE_NONE || p_header == NULL)
+        {
+            continue;
+        }
+
+        uint8_t * p_topic_id = &(p_header[MQTTSN_OFFSET_PUBLISH_TOPIC_ID]);
+        uint16_t  app_id     = mqttsn_codec_uint16_read(p_topic_id);
+
+        /* Topics dropped by a clean session wait for the application to register them again. */
+        if (!mqttsn_topic_table_is_registered(p_client, app_id))
+        {
+            continue;
+        }
+
+        mqttsn_codec_uint16_write(p_topic_id, mqttsn_topic_table_gateway_id_get(p_client, app_id));
+        p_packet->timeout = mqttsn_platform_timer_set_in_ms(MQTTSN_DEFAULT_RETRANSMISSION_TIME_IN_MS);
+        released          = true;
+
+        mqttsn_packet_sender_retransmit(p_client, &(p_client->gateway_info.addr), p_packet);
+    }
+
+    if (released)
+    {
+        mqttsn_client_timer_reschedule(p_client);
+    }
+}
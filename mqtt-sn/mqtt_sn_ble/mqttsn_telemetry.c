@@ -0,0 +1,283 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "mqttsn_telemetry.h"
+
+/**@brief Bits of a varint byte carrying the value. */
+#define VARINT_VALUE_MASK      0x7F
+
+/**@brief Bit of a varint byte set if another byte follows. */
+#define VARINT_CONTINUATION    0x80
+
+/**@brief Encodes an unsigned varint.
+ *
+ * @param[in]    value       Value.
+ * @param[out]   p_buf       Buffer.
+ * @param[in]    buflen      Length of the buffer.
+ *
+ * @return       Length of the varint, or 0 if it does not fit the buffer.
+ */
+static uint16_t varint_encode(uint32_t value, uint8_t * p_buf, uint16_t buflen)
+{
+    uint16_t len = 0;
+
+    while (value > VARINT_VALUE_MASK)
+    {
+        if (len == buflen)
+        {
+            return 0;
+        }
+
+        p_buf[len++] = (uint8_t)(value & VARINT_VALUE_MASK) | VARINT_CONTINUATION;
+        value >>= 7;
+    }
+
+    if (len == buflen)
+    {
+        return 0;
+    }
+
+    p_buf[len++] = (uint8_t)value;
+
+    return len;
+}
+
+/**@brief Decodes an unsigned varint.
+ *
+ * @param[in]    p_buf       Received data.
+ * @param[in]    buflen      Length of the received data.
+ * @param[out]   p_value     Value.
+ *
+ * @return       Length of the varint, or 0 if it is truncated or longer than 32 bits.
+ */
+static uint16_t varint_decode(const uint8_t * p_buf, uint16_t buflen, uint32_t * p_value)
+{
+    uint32_t value = 0;
+
+    for (uint16_t len = 0; len < buflen && len < MQTTSN_TELEMETRY_FIELD_MAX_LENGTH; len++)
+    {
+        value |= (uint32_t)(p_buf[len] & VARINT_VALUE_MASK) << (7 * len);
+
+        /* The last byte of a 32-bit value carries its 4 most significant bits only. */
+        if (len == MQTTSN_TELEMETRY_FIELD_MAX_LENGTH - 1 && p_buf[len] > 0x0F)
+        {
+            return 0;
+        }
+
+        if ((p_buf[len] & VARINT_CONTINUATION) == 0)
+        {
+            *p_value = value;
+            return len + 1;
+        }
+    }
+
+    return 0;
+}
+
+/**@brief Maps a signed integer to an unsigned one, small magnitudes to small values. */
+static uint32_t zigzag_encode(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+/**@brief Reverses @ref zigzag_encode. */
+static int32_t zigzag_decode(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+/**@brief Converts a real number to a saturated 16-bit fixed-point value. */
+static int16_t fixed16_from_float(float value, uint8_t frac_bits)
+{
+    float scaled = value * (float)(1UL << frac_bits);
+
+    if (scaled >= (float)INT16_MAX)
+    {
+        return INT16_MAX;
+    }
+
+    if (scaled <= (float)INT16_MIN)
+    {
+        return INT16_MIN;
+    }
+
+    return (int16_t)((scaled < 0) ? scaled - 0.5f : scaled + 0.5f);
+}
+
+uint16_t mqttsn_telemetry_encode(const mqttsn_telemetry_schema_t * p_schema,
+                                 const mqttsn_telemetry_value_t  * p_values,
+                                 uint8_t                         * p_buf,
+                                 uint16_t                          buflen)
+{
+    uint16_t offset = 0;
+
+    for (uint8_t i = 0; i < p_schema->field_cnt; i++)
+    {
+        const mqttsn_telemetry_field_t * p_field = &(p_schema->p_fields[i]);
+        uint16_t                         len     = 0;
+
+        switch (p_field->type)
+        {
+            case MQTTSN_TELEMETRY_FIELD_UVARINT:
+                len = varint_encode(p_values[i].u, &p_buf[offset], buflen - offset);
+                break;
+
+            case MQTTSN_TELEMETRY_FIELD_SVARINT:
+                len = varint_encode(zigzag_encode(p_values[i].s), &p_buf[offset], buflen - offset);
+                break;
+
+            case MQTTSN_TELEMETRY_FIELD_FIXED16:
+                if ((uint16_t)(buflen - offset) >= sizeof(int16_t))
+                {
+                    uint16_t fixed = (uint16_t)fixed16_from_float(p_values[i].f, p_field->frac_bits);
+
+                    p_buf[offset]     = (uint8_t)(fixed >> 8);
+                    p_buf[offset + 1] = (uint8_t)fixed;
+                    len               = sizeof(int16_t);
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        if (len == 0)
+        {
+            return 0;
+        }
+
+        offset += len;
+    }
+
+    return offset;
+}
+
+uint16_t mqttsn_telemetry_decode(const mqttsn_telemetry_schema_t * p_schema,
+                                 const uint8_t                   * p_buf,
+                                 uint16_t                          buflen,
+                                 mqttsn_telemetry_value_t        * p_values)
+{
+    uint16_t offset = 0;
+
+    for (uint8_t i = 0; i < p_schema->field_cnt; i++)
+    {
+        const mqttsn_telemetry_field_t * p_field = &(p_schema->p_fields[i]);
+        uint16_t                         len     = 0;
+        uint32_t                         value   = 0;
+
+        switch (p_field->type)
+        {
+            case MQTTSN_TELEMETRY_FIELD_UVARINT:
+                len = varint_decode(&p_buf[offset], buflen - offset, &p_values[i].u);
+                break;
+
+            case MQTTSN_TELEMETRY_FIELD_SVARINT:
+                len = varint_decode(&p_buf[offset], buflen - offset, &value);
+                p_values[i].s = zigzag_decode(value);
+                break;
+
+            case MQTTSN_TELEMETRY_FIELD_FIXED16:
+                if ((uint16_t)(buflen - offset) >= sizeof(int16_t))
+                {
+                    int16_t fixed = (int16_t)((p_buf[offset] << 8) | p_buf[offset + 1]);
+
+                    p_values[i].f = (float)fixed / (float)(1UL << p_field->frac_bits);
+                    len           = sizeof(int16_t);
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        if (len == 0)
+        {
+            return 0;
+        }
+
+        offset += len;
+    }
+
+    return offset;
+}
+
+bool mqttsn_telemetry_deadband_check(mqttsn_telemetry_deadband_t * p_deadband, int32_t value)
+{
+    int64_t change = (int64_t)value - p_deadband->last;
+    bool    within = (change < 0 ? -change : change) <= (int64_t)p_deadband->deadband;
+
+    if (p_deadband->reported && within &&
+        (p_deadband->max_suppressed == 0 || p_deadband->suppressed < p_deadband->max_suppressed))
+    {
+        p_deadband->suppressed++;
+        return false;
+    }
+
+    p_deadband->last       = value;
+    p_deadband->suppressed = 0;
+    p_deadband->reported   = true;
+
+    return true;
+}
+
+uint16_t mqttsn_telemetry_series_encode(const int32_t * p_samples,
+                                        uint16_t        sample_cnt,
+                                        uint8_t       * p_buf,
+                                        uint16_t        buflen)
+{
+    uint16_t offset   = 0;
+    uint32_t previous = 0;
+
+    for (uint16_t i = 0; i < sample_cnt; i++)
+    {
+        /* Differences wrap around, so that any pair of samples is encoded losslessly. */
+        uint32_t delta = (uint32_t)p_samples[i] - previous;
+        uint16_t len   = varint_encode(zigzag_encode((int32_t)delta), &p_buf[offset], buflen - offset);
+
+        if (len == 0)
+        {
+            return 0;
+        }
+
+        offset   += len;
+        previous  = (uint32_t)p_samples[i];
+    }
+
+    return offset;
+}
+
+uint16_t mqttsn_telemetry_series_decode(const uint8_t * p_buf,
+                                        uint16_t        buflen,
+                                        int32_t       * p_samples,
+                                        uint16_t        sample_max)
+{
+    uint16_t offset     = 0;
+    uint16_t sample_cnt = 0;
+    uint32_t previous   = 0;
+
+    while (offset < buflen)
+    {
+        uint32_t value;
+        uint16_t len = varint_decode(&p_buf[offset], buflen - offset, &value);
+
+        if (len == 0 || sample_cnt == sample_max)
+        {
+            return 0;
+        }
+
+        previous                = previous + (uint32_t)zigzag_decode(value);
+        p_samples[sample_cnt++] = (int32_t)previous;
+        offset                 += len;
+    }
+
+    return sample_cnt;
+}
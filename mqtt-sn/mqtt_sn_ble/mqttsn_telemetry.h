@@ -0,0 +1,153 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/**@file mqttsn_telemetry.h
+ *
+ * @brief Compact binary encoding of telemetry records published over MQTT-SN.
+ *
+ * @details A record is a sequence of fields laid out as described by a schema shared by the
+ *          device and the backend. No field names, separators or type tags are sent. Fields are
+ *          encoded as:
+ *          - @ref MQTTSN_TELEMETRY_FIELD_UVARINT: unsigned LEB128 varint, 1 to 5 bytes.
+ *          - @ref MQTTSN_TELEMETRY_FIELD_SVARINT: zig-zag mapped, then as an unsigned varint, so
+ *            that values close to zero stay short whatever their sign.
+ *          - @ref MQTTSN_TELEMETRY_FIELD_FIXED16: value scaled by 2^frac_bits, rounded, saturated
+ *            to a signed 16-bit integer and sent in network byte order.
+ *
+ *          Slowly varying values can be thinned out with a deadband before they are encoded, and
+ *          batches of samples of a single value sent as a series: the first sample as a signed
+ *          varint, each following one as a signed varint of its difference to the previous one.
+ *
+ *          The module has no SDK dependencies, so the decoder can be built on the backend host.
+ */
+
+#ifndef MQTTSN_TELEMETRY_H
+#define MQTTSN_TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**@brief Longest encoding of a single field. */
+#define MQTTSN_TELEMETRY_FIELD_MAX_LENGTH 5
+
+/**@brief Field encodings. */
+typedef enum mqttsn_telemetry_field_type_t
+{
+    MQTTSN_TELEMETRY_FIELD_UVARINT, /**< Unsigned integer, varint. */
+    MQTTSN_TELEMETRY_FIELD_SVARINT, /**< Signed integer, zig-zag varint. */
+    MQTTSN_TELEMETRY_FIELD_FIXED16  /**< Real number, signed 16-bit fixed-point. */
+} mqttsn_telemetry_field_type_t;
+
+/**@brief Field of a telemetry record. */
+typedef struct mqttsn_telemetry_field_t
+{
+    mqttsn_telemetry_field_type_t type;      /**< Field encoding. */
+    uint8_t                       frac_bits; /**< Fractional bits of a fixed-point field, ignored otherwise. */
+} mqttsn_telemetry_field_t;
+
+/**@brief Layout of a telemetry record. */
+typedef struct mqttsn_telemetry_schema_t
+{
+    const mqttsn_telemetry_field_t * p_fields;  /**< Fields in order of appearance. */
+    uint8_t                          field_cnt; /**< Number of fields. */
+} mqttsn_telemetry_schema_t;
+
+/**@brief Value of a single field, the member used depending on the field encoding. */
+typedef union mqttsn_telemetry_value_t
+{
+    uint32_t u; /**< Value of @ref MQTTSN_TELEMETRY_FIELD_UVARINT field. */
+    int32_t  s; /**< Value of @ref MQTTSN_TELEMETRY_FIELD_SVARINT field. */
+    float    f; /**< Value of @ref MQTTSN_TELEMETRY_FIELD_FIXED16 field. */
+} mqttsn_telemetry_value_t;
+
+/**@brief Report-by-exception state of a single value. */
+typedef struct mqttsn_telemetry_deadband_t
+{
+    uint32_t deadband;       /**< Largest change from the last reported value which is suppressed. */
+    uint16_t max_suppressed; /**< Number of suppressed samples after which one is reported anyway, 0 for no limit. */
+    uint16_t suppressed;     /**< Number of samples suppressed since the last report. */
+    int32_t  last;           /**< Last reported value. */
+    bool     reported;       /**< True once a value has been reported. */
+} mqttsn_telemetry_deadband_t;
+
+/**@brief Encodes a telemetry record.
+ *
+ * @param[in]    p_schema    Record layout.
+ * @param[in]    p_values    Values, one per field of the schema.
+ * @param[out]   p_buf       Buffer, typically the payload handed to the client.
+ * @param[in]    buflen      Length of the buffer.
+ *
+ * @return       Length of the record, or 0 if it does not fit the buffer.
+ */
+uint16_t mqttsn_telemetry_encode(const mqttsn_telemetry_schema_t * p_schema,
+                                 const mqttsn_telemetry_value_t  * p_values,
+                                 uint8_t                         * p_buf,
+                                 uint16_t                          buflen);
+
+/**@brief Decodes a telemetry record.
+ *
+ * @param[in]    p_schema    Record layout.
+ * @param[in]    p_buf       Received record.
+ * @param[in]    buflen      Length of the received data.
+ * @param[out]   p_values    Values, one per field of the schema.
+ *
+ * @return       Length of the record, or 0 if it is truncated or malformed.
+ */
+uint16_t mqttsn_telemetry_decode(const mqttsn_telemetry_schema_t * p_schema,
+                                 const uint8_t                   * p_buf,
+                                 uint16_t                          buflen,
+                                 mqttsn_telemetry_value_t        * p_values);
+
+/**@brief Checks if a sample differs enough from the last reported one to be published.
+ *
+ * @details The first sample is always reported. A reported sample becomes the reference for the
+ *          following ones.
+ *
+ * @param[inout] p_deadband  Deadband state, with deadband and max_suppressed set and the rest
+ *                           zeroed before the first sample.
+ * @param[in]    value       Sample.
+ *
+ * @retval       true        If the sample should be published.
+ * @retval       false       If it is within the deadband of the last reported one.
+ */
+bool mqttsn_telemetry_deadband_check(mqttsn_telemetry_deadband_t * p_deadband, int32_t value);
+
+/**@brief Encodes a series of samples of a single value as deltas.
+ *
+ * @param[in]    p_samples   Samples, oldest first.
+ * @param[in]    sample_cnt  Number of samples.
+ * @param[out]   p_buf       Buffer.
+ * @param[in]    buflen      Length of the buffer.
+ *
+ * @return       Length of the series, or 0 if it does not fit the buffer.
+ */
+uint16_t mqttsn_telemetry_series_encode(const int32_t * p_samples,
+                                        uint16_t        sample_cnt,
+                                        uint8_t       * p_buf,
+                                        uint16_t        buflen);
+
+/**@brief Decodes a series of samples filling the whole buffer.
+ *
+ * @param[in]    p_buf       Received series.
+ * @param[in]    buflen      Length of the received series.
+ * @param[out]   p_samples   Samples, oldest first.
+ * @param[in]    sample_max  Number of samples p_samples has room for.
+ *
+ * @return       Number of samples, or 0 if the series is malformed or has more than sample_max
+ *               samples.
+ */
+uint16_t mqttsn_telemetry_series_decode(const uint8_t * p_buf,
+                                        uint16_t        buflen,
+                                        int32_t       * p_samples,
+                                        uint16_t        sample_max);
+
+#endif // MQTTSN_TELEMETRY_H
@@ -0,0 +1,197 @@
+/* Copyright (c) 2017 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "mqttsn_packet_internal.h"
+#include "app_util.h"
+
+STATIC_ASSERT(MQTTSN_TOPIC_PUBLISH_TEMPLATE_LENGTH == MQTTSN_CODEC_PUBLISH_TEMPLATE_LENGTH);
+
+/**@brief Flags of PUBLISH messages sent by the client, which publishes with QoS 1 only. */
+#define PUBLISH_TEMPLATE_FLAGS ((1 << MQTTSN_FLAG_QOS_POS) | MQTTSN_TOPIC_TYPE_NORMAL)
+
+void mqttsn_topic_table_init(mqttsn_client_t * p_client)
+{
+    memset(&(p_client->topic_table), 0, sizeof(mqttsn_topic_table_t));
+    mqttsn_retained_changed(p_client, MQTTSN_RETAINED_SESSION);
+}
+
+/**@brief Finds the entry of a topic, or a free one.
+ *
+ * @param[in]    p_client       Pointer to initialized client.
+ * @param[in]    p_topic_name   Topic name.
+ * @param[in]    topic_name_len Length of the topic name.
+ *
+ * @return       Index of the entry holding the topic, otherwise of the first free entry, or
+ *               MQTTSN_TOPIC_TABLE_MAX_LENGTH if the table is full.
+ */
+static uint8_t entry_find(const mqttsn_client_t * p_client, const uint8_t * p_topic_name, uint16_t topic_name_len)
+{
+    uint8_t index = MQTTSN_TOPIC_TABLE_MAX_LENGTH;
+
+    for (uint8_t i = 0; i < MQTTSN_TOPIC_TABLE_MAX_LENGTH; i++)
+    {
+        const mqttsn_topic_entry_t * p_candidate = &(p_client->topic_table.topic[i]);
+
+        if (p_candidate->topic_name_len == topic_name_len &&
+            memcmp(p_candidate->p_topic_name, p_topic_name, topic_name_len) == 0)
+        {
+            return i;
+        }
+
+        if (index == MQTTSN_TOPIC_TABLE_MAX_LENGTH && p_candidate->topic_name_len == 0)
+        {
+            index = i;
+        }
+    }
+
+    return index;
+}
+
+void mqttsn_topic_table_add(mqttsn_client_t * p_client,
+                            const uint8_t   * p_topic_name,
+                            uint16_t          topic_name_len,
+                            uint16_t          topic_id)
+{
+    if (topic_name_len == 0 || topic_name_len > MQTTSN_TOPIC_NAME_MAX_LENGTH)
+    {
+        NRF_LOG_ERROR("Topic name too long to be remembered\r\n");
+        return;
+    }
+
+    uint8_t index = entry_find(p_client, p_topic_name, topic_name_len);
+
+    if (index == MQTTSN_TOPIC_TABLE_MAX_LENGTH)
+    {
+        NRF_LOG_ERROR("Topic table capacity exceeded\r\n");
+        return;
+    }
+
+    mqttsn_topic_entry_t * p_entry = &(p_client->topic_table.topic[index]);
+
+    if (p_entry->topic_name_len == 0)
+    {
+        memcpy(p_entry->p_topic_name, p_topic_name, topic_name_len);
+        p_entry->topic_name_len = topic_name_len;
+        p_entry->app_id         = topic_id;
+    }
+
+    mqttsn_topic_table_gateway_id_set(p_client, index, topic_id);
+}
+
+uint32_t mqttsn_topic_table_local_add(mqttsn_client_t * p_client,
+                                      const uint8_t   * p_topic_name,
+                                      uint16_t          topic_name_len,
+                                      uint16_t        * p_app_id)
+{
+    if (topic_name_len == 0 || topic_name_len > MQTTSN_TOPIC_NAME_MAX_LENGTH)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    uint8_t index = entry_find(p_client, p_topic_name, topic_name_len);
+
+    if (index == MQTTSN_TOPIC_TABLE_MAX_LENGTH)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    mqttsn_topic_entry_t * p_entry = &(p_client->topic_table.topic[index]);
+
+    if (p_entry->topic_name_len == 0)
+    {
+        memcpy(p_entry->p_topic_name, p_topic_name, topic_name_len);
+        p_entry->topic_name_len = topic_name_len;
+        p_entry->app_id         = MQTTSN_TOPIC_LOCAL_ID_FIRST - index;
+        mqttsn_topic_table_gateway_id_set(p_client, index, 0);
+    }
+
+    *p_app_id = p_entry->app_id;
+
+    return NRF_SUCCESS;
+}
+
+void mqttsn_topic_table_gateway_id_set(mqttsn_client_t * p_client, uint8_t index, uint16_t gateway_id)
+{
+    mqttsn_topic_entry_t * p_entry = &(p_client->topic_table.topic[index]);
+
+    p_entry->gateway_id = gateway_id;
+    mqttsn_codec_publish_template_build(p_entry->publish_template, PUBLISH_TEMPLATE_FLAGS, gateway_id);
+    mqttsn_retained_changed(p_client, MQTTSN_RETAINED_SESSION);
+}
+
+void mqttsn_topic_table_registrations_clear(mqttsn_client_t * p_client)
+{
+    for (int i = 0; i < MQTTSN_TOPIC_TABLE_MAX_LENGTH; i++)
+    {
+        mqttsn_topic_table_gateway_id_set(p_client, i, 0);
+    }
+}
+
+bool mqttsn_topic_table_is_registered(const mqttsn_client_t * p_client, uint16_t app_id)
+{
+    for (int i = 0; i < MQTTSN_TOPIC_TABLE_MAX_LENGTH; i++)
+    {
+        const mqttsn_topic_entry_t * p_entry = &(p_client->topic_table.topic[i]);
+
+        if (p_entry->topic_name_len != 0 && p_entry->app_id == app_id)
+        {
+            return p_entry->gateway_id != 0;
+        }
+    }
+
+    return true;
+}
+
+const uint8_t * mqttsn_topic_table_publish_template_get(const mqttsn_client_t * p_client, uint16_t gateway_id)
+{
+    for (int i = 0; i < MQTTSN_TOPIC_TABLE_MAX_LENGTH; i++)
+    {
+        const mqttsn_topic_entry_t * p_entry = &(p_client->topic_table.topic[i]);
+
+        if (p_entry->topic_name_len != 0 && p_entry->gateway_id != 0 && p_entry->gateway_id == gateway_id)
+        {
+            return p_entry->publish_template;
+        }
+    }
+
+    return NULL;
+}
+
+uint16_t mqttsn_topic_table_gateway_id_get(const mqttsn_client_t * p_client, uint16_t app_id)
+{
+    for (int i = 0; i < MQTTSN_TOPIC_TABLE_MAX_LENGTH; i++)
+    {
+        const mqttsn_topic_entry_t * p_entry = &(p_client->topic_table.topic[i]);
+
+        if (p_entry->topic_name_len != 0 && p_entry->gateway_id != 0 && p_entry->app_id == app_id)
+        {
+            return p_entry->gateway_id;
+        }
+    }
+
+    return app_id;
+}
+
+uint16_t mqttsn_topic_table_app_id_get(const mqttsn_client_t * p_client, uint16_t gateway_id)
+{
+    for (int i = 0; i < MQTTSN_TOPIC_TABLE_MAX_LENGTH; i++)
+    {
+        const mqttsn_topic_entry_t * p_entry = &(p_client->topic_table.topic[i]);
+
+        if (p_entry->topic_name_len != 0 && p_entry->gateway_id == gateway_id)
+        {
+            return p_entry->app_id;
+        }
+    }
+
+    return gateway_id;
+}
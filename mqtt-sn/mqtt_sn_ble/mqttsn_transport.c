@@ -46,6 +46,24 @@ uint32_t mqttsn_transport_write(mqttsn_client_t       * p_client,
     return NRF_ERROR_INTERNAL;
 }
 
+uint32_t mqttsn_transport_writev(mqttsn_client_t       * p_client,
+                                 const mqttsn_remote_t * p_remote,
+                                 const mqttsn_iovec_t  * p_iov,
+                                 uint8_t                 iovcnt)
+{
+    NULL_PARAM_CHECK(p_remote);
+    NULL_PARAM_CHECK(p_iov);
+
+    switch(p_client->transport.type)
+    {
+        case MQTTSN_CLIENT_TRANSPORT_THREAD:
+            break;
+        case MQTTSN_CLIENT_TRANSPORT_BLE:
+            return mqttsn_transport_writev_ble(p_client, p_iov, iovcnt);
+    }
+    return NRF_ERROR_INTERNAL;
+}
+
 uint32_t mqttsn_transport_read(void                   * p_context,
                                const mqttsn_port_t    * p_port,
                                const mqttsn_remote_t  * p_remote,
@@ -72,10 +90,29 @@ uint32_t mqttsn_transport_init(mqttsn_client_t * p_client, uint16_t port, const
 }
 
 
+uint32_t mqttsn_transport_caps_get(const mqttsn_client_t * p_client)
+{
+    switch(p_client->transport.type)
+    {
+        case MQTTSN_CLIENT_TRANSPORT_THREAD:
+            break;
+        case MQTTSN_CLIENT_TRANSPORT_BLE:
+            /* Nordic UART Service carries traffic to the connected central only. */
+            return MQTTSN_TRANSPORT_CAP_POINT_TO_POINT;
+    }
+    return 0;
+}
 
 
 uint32_t mqttsn_transport_uninit(mqttsn_client_t * p_client)
 {
-
+    switch(p_client->transport.type)
+    {
+        case MQTTSN_CLIENT_TRANSPORT_THREAD:
+            break;
+        case MQTTSN_CLIENT_TRANSPORT_BLE:
+            return mqttsn_transport_ble_uninit(p_client);
+    }
+    return NRF_ERROR_INTERNAL;
 }
 
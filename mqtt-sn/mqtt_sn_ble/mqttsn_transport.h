@@ -15,6 +15,17 @@
 
 #include "mqttsn_client.h"
 
+/**@brief Transport capability: the link has a single peer, which is the gateway or forwards
+ *        all traffic to it. The client needs no gateway discovery. */
+#define MQTTSN_TRANSPORT_CAP_POINT_TO_POINT 0x01
+
+/**@brief Segment of a message sent with @ref mqttsn_transport_writev. */
+typedef struct mqttsn_iovec_t
+{
+    const uint8_t * p_data; /**< Segment data. */
+    uint16_t        len;    /**< Length of the segment data. */
+} mqttsn_iovec_t;
+
 
 /**@brief Initializes the MQTT-SN client's transport.  
  *
@@ -44,6 +55,25 @@ uint32_t mqttsn_transport_write(mqttsn_client_t       * p_client,
                                 uint16_t                datalen);
 
 
+/**@brief Sends message gathered from several segments.
+ *
+ * @details The segments are sent as a single datagram, in order. The transport reads them while
+ *          this function runs only, so they can be released as soon as it returns.
+ *
+ * @param[inout] p_client    Pointer to initialized and connected client.
+ * @param[in]    p_remote    Pointer to remote endpoint.
+ * @param[in]    p_iov       Segments of the message.
+ * @param[in]    iovcnt      Number of segments.
+ *
+ * @return       NRF_SUCCESS if the message has been sent successfully.
+ *               Otherwise error code is returned.
+ */
+uint32_t mqttsn_transport_writev(mqttsn_client_t       * p_client,
+                                 const mqttsn_remote_t * p_remote,
+                                 const mqttsn_iovec_t  * p_iov,
+                                 uint8_t                 iovcnt);
+
+
 /**@brief Receives message.  
  *
  * @param[inout] p_context          Pointer to transport layer specific context. 
@@ -62,6 +92,15 @@ uint32_t mqttsn_transport_read(void                   * p_context,
                                uint16_t                 datalen);
 
 
+/**@brief Gets capabilities of the MQTT-SN client's transport.
+ *
+ * @param[in]    p_client    Pointer to the client, with the transport type set.
+ *
+ * @return       Bitmask of MQTTSN_TRANSPORT_CAP_* flags.
+ */
+uint32_t mqttsn_transport_caps_get(const mqttsn_client_t * p_client);
+
+
 /**@brief Unitializes the MQTT-SN client's transport.  
  *
  * @param[inout] p_client        Pointer to initialized and connected client.
@@ -16,8 +16,11 @@
 #include "nrf_log.h"
 #include "nrf_error.h"
 #include "ble_nus.h"
+#include "app_scheduler.h"
 
 #include <stdint.h>
+#include <stddef.h>
+#include <string.h>
 
 #define NULL_PARAM_CHECK(PARAM)                                                                    \
     if ((PARAM) == NULL)                                                                           \
@@ -25,7 +28,27 @@
         return (NRF_ERROR_NULL);                                                                   \
     }
 
-mqttsn_client_t * ptr_client;
+/**@brief Clients bound to a Nordic UART Service instance. */
+static mqttsn_client_t * mp_clients[MQTTSN_TRANSPORT_BLE_MAX_INSTANCES];
+
+/**@brief Finds the client bound to a Nordic UART Service instance.
+ *
+ * @param[in]    p_nus       Nordic UART Service instance.
+ *
+ * @return       Pointer to the client, or NULL if no client uses the service.
+ */
+static mqttsn_client_t * client_find(const ble_nus_t * p_nus)
+{
+    for (uint32_t i = 0; i < MQTTSN_TRANSPORT_BLE_MAX_INSTANCES; i++)
+    {
+        if (mp_clients[i] != NULL && mp_clients[i]->transport.p_handle == p_nus)
+        {
+            return mp_clients[i];
+        }
+    }
+
+    return NULL;
+}
 
 uint32_t mqttsn_transport_write_ble(  mqttsn_client_t     * p_client,
                                       uint8_t             * p_data,
@@ -34,22 +57,114 @@ uint32_t mqttsn_transport_write_ble(  mqttsn_client_t     * p_client,
     return ble_nus_string_send(p_client->transport.p_handle, p_data, &datalen);
 }
 
+uint32_t mqttsn_transport_writev_ble(mqttsn_client_t      * p_client,
+                                     const mqttsn_iovec_t * p_iov,
+                                     uint8_t                iovcnt)
+{
+    uint8_t  data[BLE_NUS_MAX_DATA_LEN];
+    uint16_t datalen = 0;
+
+    for (uint8_t i = 0; i < iovcnt; i++)
+    {
+        if (p_iov[i].len > sizeof(data) - datalen)
+        {
+            NRF_LOG_ERROR("Message does not fit a single notification\r\n");
+            return NRF_ERROR_DATA_SIZE;
+        }
+
+        memcpy(&data[datalen], p_iov[i].p_data, p_iov[i].len);
+        datalen += p_iov[i].len;
+    }
+
+    return ble_nus_string_send(p_client->transport.p_handle, data, &datalen);
+}
+
+
+/**@brief Passes data received over BLE to the client, in thread mode.
+ *
+ * @param[in] p_event_data   Queued @ref mqttsn_transport_ble_rx_evt_t.
+ * @param[in] event_size     Size of the queued event.
+ */
+static void ble_data_process(void * p_event_data, uint16_t event_size)
+{
+    const mqttsn_transport_ble_rx_evt_t * p_rx = (const mqttsn_transport_ble_rx_evt_t *)p_event_data;
+
+    UNUSED_PARAMETER(event_size);
+
+    /* The client may have been uninitialized while the data was queued. */
+    mqttsn_client_t * p_client = client_find(p_rx->p_nus);
+    if (p_client == NULL)
+    {
+        return;
+    }
+
+    mqttsn_packet_receiver(p_client, NULL, NULL, p_rx->data, p_rx->len);
+}
+
+/**@brief Looks for the gateway once the peer can receive notifications, in thread mode.
+ *
+ * @details The link is point-to-point, so the gateway is found at once and CONNECT message can go
+ *          out without waiting for the application to start the search.
+ *
+ * @param[in] p_event_data   Queued pointer to the Nordic UART Service instance.
+ * @param[in] event_size     Size of the queued event.
+ */
+static void ble_link_up_process(void * p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(event_size);
+
+    mqttsn_client_t * p_client = client_find(*(const ble_nus_t **)p_event_data);
+    if (p_client == NULL)
+    {
+        return;
+    }
+
+    if (p_client->client_state == MQTTSN_CLIENT_DISCONNECTED ||
+        p_client->client_state == MQTTSN_CLIENT_SEARCHING_GATEWAY)
+    {
+        (void)mqttsn_client_search_gateway(p_client);
+    }
+}
 
 /**@brief Function for handling the data from the Nordic UART Service.
  *
- * @details This function will process the data received from the Nordic UART BLE Service and send
- *          it to the UART module.
+ * @details Runs in SoftDevice event context. Received data is copied to the scheduler queue and
+ *          processed in thread mode by @ref ble_data_process. Notifications being enabled are
+ *          handled by @ref ble_link_up_process the same way.
  *
- * @param[in] p_nus    Nordic UART Service structure.
- * @param[in] p_data   Data to be send to UART module.
- * @param[in] length   Length of the data.
+ * @param[in] p_evt    Nordic UART Service event.
  */
 /**@snippet [Handling the data received over BLE] */
 static void ble_data_handler(ble_nus_evt_t * p_evt)
 {
     if (p_evt->type == BLE_NUS_EVT_RX_DATA)
     {
-        mqttsn_packet_receiver(ptr_client, NULL, NULL, p_evt->params.rx_data.p_data, p_evt->params.rx_data.length);
+        mqttsn_transport_ble_rx_evt_t rx;
+
+        if (p_evt->params.rx_data.length > sizeof(rx.data))
+        {
+            NRF_LOG_ERROR("Received data does not fit the scheduler event\r\n");
+            return;
+        }
+
+        rx.p_nus = p_evt->p_nus;
+        rx.len   = p_evt->params.rx_data.length;
+        memcpy(rx.data, p_evt->params.rx_data.p_data, rx.len);
+
+        /* Only the used part of the data buffer is queued. */
+        if (app_sched_event_put(&rx, offsetof(mqttsn_transport_ble_rx_evt_t, data) + rx.len,
+                                ble_data_process) != NRF_SUCCESS)
+        {
+            NRF_LOG_ERROR("Scheduler queue full, received data dropped\r\n");
+        }
+    }
+    else if (p_evt->type == BLE_NUS_EVT_COMM_STARTED)
+    {
+        /* The application's periodic search still runs if the event cannot be queued. */
+        if (app_sched_event_put(&(p_evt->p_nus), sizeof(p_evt->p_nus), ble_link_up_process) != NRF_SUCCESS)
+        {
+            NRF_LOG_ERROR("Scheduler queue full, link up event dropped\r\n");
+        }
     }
 }
 
@@ -59,13 +174,40 @@ static void ble_data_handler(ble_nus_evt_t * p_evt)
 uint32_t mqttsn_transport_ble_init(mqttsn_client_t * p_client) 
 {
     NULL_PARAM_CHECK(p_client);
-
-    ptr_client = p_client;
+    NULL_PARAM_CHECK(p_client->transport.p_handle);
 
     ble_nus_t * p_nus_temp = (ble_nus_t *)p_client->transport.p_handle;
 
-    p_nus_temp->data_handler = ble_data_handler;
+    if (client_find(p_nus_temp) != NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    for (uint32_t i = 0; i < MQTTSN_TRANSPORT_BLE_MAX_INSTANCES; i++)
+    {
+        if (mp_clients[i] == NULL)
+        {
+            mp_clients[i]            = p_client;
+            p_nus_temp->data_handler = ble_data_handler;
+            return NRF_SUCCESS;
+        }
+    }
 
-    return NRF_SUCCESS;
+    return NRF_ERROR_NO_MEM;
 }
 
+uint32_t mqttsn_transport_ble_uninit(mqttsn_client_t * p_client)
+{
+    NULL_PARAM_CHECK(p_client);
+
+    for (uint32_t i = 0; i < MQTTSN_TRANSPORT_BLE_MAX_INSTANCES; i++)
+    {
+        if (mp_clients[i] == p_client)
+        {
+            mp_clients[i] = NULL;
+            return NRF_SUCCESS;
+        }
+    }
+
+    return NRF_ERROR_NOT_FOUND;
+}
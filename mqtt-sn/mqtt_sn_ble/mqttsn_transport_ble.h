@@ -14,7 +14,25 @@
 #define MQTTSN_TRANSPORT_BLE_H
 
 #include "mqttsn_client.h"
+#include "mqttsn_transport.h"
+#include "ble_nus.h"
 
+/**@brief Maximum number of clients, each bound to its own Nordic UART Service instance. */
+#ifndef MQTTSN_TRANSPORT_BLE_MAX_INSTANCES
+#define MQTTSN_TRANSPORT_BLE_MAX_INSTANCES 1
+#endif
+
+/**@brief Data received over BLE, queued for processing in thread mode. For internal use only */
+typedef struct mqttsn_transport_ble_rx_evt_t
+{
+    const ble_nus_t * p_nus;                      /**< Nordic UART Service instance the data came from. */
+    uint16_t          len;                        /**< Length of the received data. */
+    uint8_t           data[BLE_NUS_MAX_DATA_LEN]; /**< Received data. */
+} mqttsn_transport_ble_rx_evt_t;
+
+/**@brief Largest app_scheduler event put by the MQTT-SN client. The application's scheduler
+ *        queue must be initialized with an event size of at least this value. */
+#define MQTTSN_SCHED_EVENT_DATA_SIZE sizeof(mqttsn_transport_ble_rx_evt_t)
 
 /**@brief Sends MQTT-SN message over BLE.  
  *
@@ -30,6 +48,40 @@ uint32_t mqttsn_transport_write_ble(  mqttsn_client_t     * p_client,
                                       uint8_t             * p_data,
                                       uint16_t              datalen);
 
+/**@brief Sends MQTT-SN message gathered from several segments over BLE.
+ *
+ * @details A notification must be contiguous, so the segments are gathered on the stack. The
+ *          SoftDevice copies the notification anyway, so no copy is added on the way.
+ *
+ * @param[inout] p_client    Pointer to initialized and connected client.
+ * @param[in]    p_iov       Segments of the message.
+ * @param[in]    iovcnt      Number of segments.
+ *
+ * @return       NRF_SUCCESS if the message has been sent successfully.
+ *               NRF_ERROR_DATA_SIZE if the message does not fit a single notification.
+ *               Otherwise error code is returned.
+ */
+uint32_t mqttsn_transport_writev_ble(mqttsn_client_t      * p_client,
+                                     const mqttsn_iovec_t * p_iov,
+                                     uint8_t                iovcnt);
+
+/**@brief Binds a client to the Nordic UART Service instance given as its transport handle.
+ *
+ * @param[inout] p_client    Pointer to the client.
+ *
+ * @return       NRF_SUCCESS if the client has been bound.
+ *               NRF_ERROR_INVALID_STATE if another client already uses the service instance.
+ *               NRF_ERROR_NO_MEM if @ref MQTTSN_TRANSPORT_BLE_MAX_INSTANCES clients are bound.
+ */
 uint32_t mqttsn_transport_ble_init(mqttsn_client_t * p_client);
 
+/**@brief Unbinds a client from its Nordic UART Service instance.
+ *
+ * @param[inout] p_client    Pointer to the client.
+ *
+ * @return       NRF_SUCCESS if the client has been unbound.
+ *               NRF_ERROR_NOT_FOUND if the client was not bound.
+ */
+uint32_t mqttsn_transport_ble_uninit(mqttsn_client_t * p_client);
+
 #endif // MQTTSN_TRANSPORT_BLE_H
@@ -27,41 +27,60 @@
         return (NRF_ERROR_NULL);                                                                   \
     }
 
+/**@brief Size of the stack buffer received datagrams are read into. Longer datagrams are read
+ *        into a buffer allocated from the memory pool. */
+#ifndef MQTTSN_TRANSPORT_OT_SCRATCH_SIZE
+#define MQTTSN_TRANSPORT_OT_SCRATCH_SIZE 128
+#endif
+
 /**@brief OpenThread transport instance. */
 static otInstance * m_p_instance;
 /**@brief OpenThread UDP socket. */
 static otUdpSocket  m_socket;
 
-/**@brief Callback from the OpenThread port. */
+/**@brief Callback from the OpenThread port.
+ *
+ * @details Datagrams are read into a scratch buffer on the stack, so the usual case needs no
+ *          allocation. Only datagrams longer than @ref MQTTSN_TRANSPORT_OT_SCRATCH_SIZE, such as
+ *          large PUBLISH messages, are read into a buffer from the memory pool.
+ */
 static void port_data_callback(void                * p_context,
                                otMessage           * p_message,
                                const otMessageInfo * p_message_info)
 {
     const mqttsn_port_t port = p_message_info->mSockPort;
     mqttsn_remote_t     remote_endpoint;
+    uint8_t             scratch[MQTTSN_TRANSPORT_OT_SCRATCH_SIZE];
 
     memcpy(remote_endpoint.addr,  p_message_info->mPeerAddr.mFields.m8, OT_IP6_ADDRESS_SIZE);
     remote_endpoint.port_number = MQTTSN_DEFAULT_GATEWAY_PORT;
 
-    uint16_t  payload_size = otMessageGetLength(p_message) - otMessageGetOffset(p_message);
-	uint8_t * p_msg        = nrf_malloc(payload_size);
+    uint16_t  offset       = otMessageGetOffset(p_message);
+    uint16_t  payload_size = otMessageGetLength(p_message) - offset;
+    uint8_t * p_msg        = scratch;
 
-    if (p_msg)
-	{
-	    if (otMessageRead(p_message, otMessageGetOffset(p_message), p_msg, payload_size) == payload_size)
-	    {
-            mqttsn_transport_read(p_context, &port, &remote_endpoint, p_msg, payload_size);
-        }
-        else
+    if (payload_size > sizeof(scratch))
+    {
+        p_msg = nrf_malloc(payload_size);
+        if (p_msg == NULL)
         {
-            NRF_LOG_ERROR("Openthread message cannot be read.\r\n");
+            NRF_LOG_ERROR("Openthread message buffer cannot be allocated (receive_data_callback)\r\n");
+            return;
         }
+    }
 
-	    nrf_free(p_msg);
-	}
+    if (otMessageRead(p_message, offset, p_msg, payload_size) == payload_size)
+    {
+        mqttsn_transport_read(p_context, &port, &remote_endpoint, p_msg, payload_size);
+    }
     else
     {
-        NRF_LOG_ERROR("Openthread message buffer cannot be allocated (receive_data_callback)\r\n");
+        NRF_LOG_ERROR("Openthread message cannot be read.\r\n");
+    }
+
+    if (p_msg != scratch)
+    {
+        nrf_free(p_msg);
     }
 }
 
@@ -93,13 +112,13 @@ uint32_t mqttsn_transport_init(mqttsn_client_t * p_client, uint16_t port, const
     return port_create(p_client, port);
 }
 
-uint32_t mqttsn_transport_write(mqttsn_client_t       * p_client,
-                                const mqttsn_remote_t * p_remote,
-                                const uint8_t         * p_data,
-                                uint16_t                datalen)
+uint32_t mqttsn_transport_writev(mqttsn_client_t       * p_client,
+                                 const mqttsn_remote_t * p_remote,
+                                 const mqttsn_iovec_t  * p_iov,
+                                 uint8_t                 iovcnt)
 {
     NULL_PARAM_CHECK(p_remote);
-    NULL_PARAM_CHECK(p_data);
+    NULL_PARAM_CHECK(p_iov);
 
     uint32_t      err_code = NRF_ERROR_INVALID_STATE;
     otMessage   * p_msg    = NULL;
@@ -115,10 +134,21 @@ uint32_t mqttsn_transport_write(mqttsn_client_t       * p_client,
             break;
         }
 
-        if (otMessageAppend(p_msg, p_data, datalen) != OT_ERROR_NONE)
+        err_code = NRF_SUCCESS;
+
+        /* Segments are appended straight into the OpenThread message buffers. */
+        for (uint8_t i = 0; i < iovcnt; i++)
+        {
+            if (otMessageAppend(p_msg, p_iov[i].p_data, p_iov[i].len) != OT_ERROR_NONE)
+            {
+                NRF_LOG_ERROR("Failed to append message payload\r\n");
+                err_code = NRF_ERROR_INTERNAL;
+                break;
+            }
+        }
+
+        if (err_code != NRF_SUCCESS)
         {
-            NRF_LOG_ERROR("Failed to append message payload\r\n");
-            err_code = NRF_ERROR_INTERNAL;
             break;
         }
 
@@ -150,6 +180,18 @@ uint32_t mqttsn_transport_write(mqttsn_client_t       * p_client,
     return err_code;
 }
 
+uint32_t mqttsn_transport_write(mqttsn_client_t       * p_client,
+                                const mqttsn_remote_t * p_remote,
+                                const uint8_t         * p_data,
+                                uint16_t                datalen)
+{
+    NULL_PARAM_CHECK(p_data);
+
+    const mqttsn_iovec_t iov = { .p_data = p_data, .len = datalen };
+
+    return mqttsn_transport_writev(p_client, p_remote, &iov, 1);
+}
+
 uint32_t mqttsn_transport_read(void                   * p_context,
                                const mqttsn_port_t    * p_port,
                                const mqttsn_remote_t  * p_remote,